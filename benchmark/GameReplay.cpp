@@ -0,0 +1,224 @@
+// GameReplay.cpp
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+
+#include "platform/Platform.h"
+#include "platform/TraceRecorder.h"
+#include "platform/ReplayLog.h"
+#include "platform/headless/HeadlessPlatformManager.h"
+#include "platform/headless/SoftwareVisualizer.h"
+#include "Game.h"
+
+using namespace Platformer;
+
+
+namespace
+{
+
+
+struct Options
+{
+    std::string _logFileName;
+    size_t _frameCount = 0;
+    std::string _traceFileName;
+    bool _isRendered = false;
+    size_t _width = 640;
+    size_t _height = 480;
+    std::string _dumpPrefix;
+    SoftwareVisualizer::ImageFormat _dumpFormat = SoftwareVisualizer::PngFormat;
+};
+
+
+const char *USAGE =
+        "usage: GameReplay LOG [options]\n"
+        "  replays a log recorded by the game (PLATFORMER_RECORD or 'r' key)\n"
+        "  without a window as fast as possible\n"
+        "  --frames N            replay only the first frames, 0 is all (0)\n"
+        "  --trace FILE          write the last frames timeline as trace event JSON\n"
+        "  --render              draw frames by the software visualizer & print\n"
+        "                        the hash of all frames to compare versions\n"
+        "  --size WxH            framebuffer size of --render (640x480)\n"
+        "  --dump PREFIX         write rendered frames to PREFIX000000.png and so on\n"
+        "  --dump-format FORMAT  png or ppm (png)\n";
+
+
+Options parseOptions(int argc, char *argv[])
+{
+    Options options;
+
+    for (int argNum = 1; argNum < argc; ++argNum)
+    {
+        const std::string arg = argv[argNum];
+        const bool hasValue = argNum + 1 < argc;
+
+        if (arg == "--help")
+            throw std::invalid_argument("");
+        else if (arg == "--render")
+            options._isRendered = true;
+        else if (arg.compare(0, 2, "--") != 0 && options._logFileName.empty())
+            options._logFileName = arg;
+        else if (!hasValue)
+            throw std::invalid_argument("missing value of " + arg);
+        else if (arg == "--frames")
+            options._frameCount = std::stoul(argv[++argNum]);
+        else if (arg == "--trace")
+            options._traceFileName = argv[++argNum];
+        else if (arg == "--size")
+        {
+            const std::string size = argv[++argNum];
+            const size_t separatorPos = size.find('x');
+
+            if (separatorPos == std::string::npos)
+                throw std::invalid_argument("wrong size " + size);
+
+            options._width = std::stoul(size.substr(0, separatorPos));
+            options._height = std::stoul(size.substr(separatorPos + 1));
+        }
+        else if (arg == "--dump")
+        {
+            options._dumpPrefix = argv[++argNum];
+            options._isRendered = true;
+        }
+        else if (arg == "--dump-format")
+        {
+            const std::string format = argv[++argNum];
+
+            if (format != "png" && format != "ppm")
+                throw std::invalid_argument("unknown image format " + format);
+
+            options._dumpFormat = format == "png" ? SoftwareVisualizer::PngFormat : SoftwareVisualizer::PpmFormat;
+        }
+        else
+            throw std::invalid_argument("unknown option " + arg);
+    }
+
+    if (options._logFileName.empty())
+        throw std::invalid_argument("missing log file");
+
+    return options;
+}
+
+
+double getPercentile(std::vector<double> values, double percent)
+{
+    if (values.empty())
+        return 0;
+
+    size_t num = static_cast<size_t>(percent / 100 * (values.size() - 1) + 0.5);
+    std::nth_element(values.begin(), values.begin() + num, values.end());
+    return values[num];
+}
+
+
+}  // namespace
+
+
+int main(int argc, char *argv[])
+try
+{
+    Options options;
+
+    try
+    {
+        options = parseOptions(argc, argv);
+    }
+    catch (const std::invalid_argument &error)
+    {
+        if (*error.what() != 0)
+            std::cerr << error.what() << std::endl;
+
+        std::cerr << USAGE;
+        return 1;
+    }
+
+    ReplayLogPointer logPtr = std::make_shared<ReplayLog>();
+    logPtr->read(options._logFileName);
+
+    std::shared_ptr<HeadlessPlatformManager> managerPtr(new HeadlessPlatformManager(argc, argv));
+    managerPtr->setFrameCount(options._frameCount);
+    managerPtr->setReplayLogPtr(logPtr);
+
+    std::shared_ptr<SoftwareVisualizer> visualizerPtr;
+
+    if (options._isRendered)
+    {
+        visualizerPtr = std::make_shared<SoftwareVisualizer>(options._width, options._height);
+        visualizerPtr->setFrameDump(options._dumpPrefix, options._dumpFormat);
+        managerPtr->setVisualizer(visualizerPtr);
+    }
+
+    Platform::instance()->initialize(managerPtr);
+
+    std::vector<double> frameTimes;
+    double sessionTime = 0;
+
+    // frame hashes are chained, so equal hashes mean equal frames
+    uint64_t framesHash = 0;
+
+    {
+        Game game;
+
+        // game frames are timed around its own frame handler
+        Platform::FrameHandler gameFrameHandler = Platform::instance()->frameHandler;
+        Platform::instance()->frameHandler = [&gameFrameHandler, &frameTimes, &sessionTime,
+                                              &visualizerPtr, &framesHash]()
+        {
+            std::chrono::steady_clock::time_point startPoint = std::chrono::steady_clock::now();
+            gameFrameHandler();
+            std::chrono::duration<double> frameTime = std::chrono::steady_clock::now() - startPoint;
+
+            frameTimes.push_back(frameTime.count());
+            sessionTime += Platform::instance()->getActualFrameTime();
+
+            if (visualizerPtr != nullptr)
+                framesHash = (framesHash ^ visualizerPtr->getFrameHash()) * 1099511628211ULL;
+        };
+
+        if (!options._traceFileName.empty())
+            TraceRecorder::instance()->setEnabled(true);
+
+        Platform::instance()->runMainLoop();
+        Platform::instance()->frameHandler = nullptr;
+
+        // recording toggled by replayed keys mustn't overwrite the log
+        Platform::instance()->setRecordingLogPtr(nullptr);
+    }
+
+    if (!options._traceFileName.empty())
+    {
+        TraceRecorder::instance()->setEnabled(false);
+        TraceRecorder::instance()->writeJson(options._traceFileName);
+    }
+
+    double replayTime = 0;
+
+    for (double frameTime : frameTimes)
+        replayTime += frameTime;
+
+    std::cout << "frames " << frameTimes.size() << " of " << logPtr->getFrameCount()
+              << std::fixed << std::setprecision(3)
+              << ", session " << sessionTime << " s, replay " << replayTime << " s ("
+              << std::setprecision(1) << sessionTime / std::max(replayTime, 1e-9) << "x real time)" << std::endl;
+    std::cout << "  frame, ms" << std::setprecision(3)
+              << "  p50 " << getPercentile(frameTimes, 50)  * 1000
+              << "  p90 " << getPercentile(frameTimes, 90)  * 1000
+              << "  p99 " << getPercentile(frameTimes, 99)  * 1000
+              << "  max " << getPercentile(frameTimes, 100) * 1000 << std::endl;
+
+    if (visualizerPtr != nullptr)
+        std::cout << "  frames hash " << std::hex << std::setw(16) << std::setfill('0') << framesHash << std::endl;
+
+    return 0;
+}
+catch (const std::exception &error)
+{
+    std::cerr << error.what() << std::endl;
+    return 1;
+}
@@ -0,0 +1,428 @@
+// PhysicsBenchmark.cpp
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+
+#include "platform/Platform.h"
+#include "platform/TraceRecorder.h"
+#include "platform/headless/HeadlessPlatformManager.h"
+#include "physics/PhysicalWorld.h"
+#include "physics/PhysicalEngine.h"
+#include "physics/PhysicsProfiler.h"
+#include "physics/BodyStore.h"
+#include "physics/TestObject.h"
+#include "physics/MapPlatform.h"
+#include "physics/StrictCollisionProcessor.h"
+#include "physics/KineticCollisionProcessor.h"
+#include "physics/SweepAndPruneBroadPhase.h"
+#include "physics/UniformGridBroadPhase.h"
+
+using namespace Platformer;
+
+
+namespace
+{
+
+
+struct Options
+{
+    std::vector<size_t> _objectCounts = {100, 1000, 10000};
+    size_t _frameCount = 300;
+    double _frameTimeSec = 1.0 / 60;
+    double _dynamicShare = 0.2;
+    size_t _threadCount = 1;
+    unsigned _seed = 1;
+    std::string _processorName = "strict";
+    std::string _broadPhaseName = "sap";
+    bool _isSleepingEnabled = true;
+    size_t _maxIterationCount = 0;
+    double _collisionTimeBudget = 0;
+    size_t _contactIterationCount = 0;
+    double _maxSubStepDistance = 0;
+    bool _isProfilingEnabled = false;
+    std::string _traceFileName;
+};
+
+
+struct FrameTimes
+{
+    std::vector<double> _stageTimes[PhysicalEngine::FrameStageCount];
+    std::vector<double> _totalTimes;
+};
+
+
+const char *USAGE =
+        "usage: PhysicsBenchmark [options]\n"
+        "  --objects N[,N...]    object counts of generated scenes (100,1000,10000)\n"
+        "  --frames N            frames per scene (300)\n"
+        "  --dt SEC              fixed frame time (0.0166...)\n"
+        "  --dynamic-share X     share of moving boxes among objects (0.2)\n"
+        "  --threads N           narrow phase threads (1)\n"
+        "  --seed N              scene generator seed (1)\n"
+        "  --processor NAME      strict, kinetic or none, none only moves bodies (strict)\n"
+        "  --broad-phase NAME    sap or grid, for the strict processor (sap)\n"
+        "  --max-iterations N    collision iterations per frame, 0 is unlimited (0)\n"
+        "  --collision-budget SEC  collision time per frame, 0 is unlimited (0)\n"
+        "  --contact-iterations N  resting contact solver iterations, 0 is off (0)\n"
+        "  --sub-step-distance D   max body shift of a collision sub-step, 0 is off (0)\n"
+        "  --no-sleep            disable sleeping of resting objects\n"
+        "  --profile             print engine profiler phases & counters\n"
+        "  --trace FILE          write the last frames timeline as trace event JSON\n";
+
+
+std::vector<size_t> parseCounts(const std::string &text)
+{
+    std::vector<size_t> counts;
+    std::istringstream stream(text);
+
+    for (std::string item; std::getline(stream, item, ','); )
+        counts.push_back(std::stoul(item));
+
+    return counts;
+}
+
+
+Options parseOptions(int argc, char *argv[])
+{
+    Options options;
+
+    for (int argNum = 1; argNum < argc; ++argNum)
+    {
+        const std::string arg = argv[argNum];
+        const bool hasValue = argNum + 1 < argc;
+
+        if (arg == "--no-sleep")
+            options._isSleepingEnabled = false;
+        else if (arg == "--profile")
+            options._isProfilingEnabled = true;
+        else if (arg == "--help" || !hasValue)
+            throw std::invalid_argument(arg == "--help" ? "" : "missing value of " + arg);
+        else if (arg == "--objects")
+            options._objectCounts = parseCounts(argv[++argNum]);
+        else if (arg == "--frames")
+            options._frameCount = std::stoul(argv[++argNum]);
+        else if (arg == "--dt")
+            options._frameTimeSec = std::stod(argv[++argNum]);
+        else if (arg == "--dynamic-share")
+            options._dynamicShare = std::stod(argv[++argNum]);
+        else if (arg == "--threads")
+            options._threadCount = std::stoul(argv[++argNum]);
+        else if (arg == "--seed")
+            options._seed = static_cast<unsigned>(std::stoul(argv[++argNum]));
+        else if (arg == "--processor")
+            options._processorName = argv[++argNum];
+        else if (arg == "--broad-phase")
+            options._broadPhaseName = argv[++argNum];
+        else if (arg == "--max-iterations")
+            options._maxIterationCount = std::stoul(argv[++argNum]);
+        else if (arg == "--collision-budget")
+            options._collisionTimeBudget = std::stod(argv[++argNum]);
+        else if (arg == "--contact-iterations")
+            options._contactIterationCount = std::stoul(argv[++argNum]);
+        else if (arg == "--sub-step-distance")
+            options._maxSubStepDistance = std::stod(argv[++argNum]);
+        else if (arg == "--trace")
+            options._traceFileName = argv[++argNum];
+        else
+            throw std::invalid_argument("unknown option " + arg);
+    }
+
+    return options;
+}
+
+
+// Shelves of floor tiles with walls on their ends and boxes falling on them.
+// Boxes are returned to check the final state.
+std::vector<TestObjectPointer> createScene(PhysicalWorldPointer worldPtr, const Options &options,
+                                           size_t objectCount)
+{
+    static const size_t SHELF_TILE_COUNT = 200;
+    static const double TILE_SIZE = 30;
+    static const double SHELF_HEIGHT = 600;
+    static const double BOX_SIZE = 20;
+
+    const size_t boxCount = static_cast<size_t>(objectCount * options._dynamicShare);
+    const size_t tileCount = objectCount - boxCount;
+    const size_t shelfCount = std::max<size_t>(1, (tileCount + SHELF_TILE_COUNT - 1) / SHELF_TILE_COUNT);
+
+    std::mt19937 random(options._seed);
+    std::vector<double> shelfWidths;
+    std::vector<TestObjectPointer> boxes;
+
+    // tiles are split between shelves evenly, two tiles of a shelf are its walls
+    for (size_t shelfNum = 0; shelfNum < shelfCount; ++shelfNum)
+    {
+        const size_t shelfTileCount = (shelfNum + 1) * tileCount / shelfCount - shelfNum * tileCount / shelfCount;
+        const size_t floorTileCount = shelfTileCount > 2 ? shelfTileCount - 2 : 0;
+        const double floorY = (shelfNum + 1) * SHELF_HEIGHT;
+        const double shelfWidth = floorTileCount * TILE_SIZE;
+
+        for (size_t tileNum = 0; tileNum < shelfTileCount; ++tileNum)
+        {
+            Rectangle rect = tileNum == 0 ? Rectangle(-TILE_SIZE, floorY - SHELF_HEIGHT, TILE_SIZE, SHELF_HEIGHT)
+                           : tileNum == 1 ? Rectangle(shelfWidth, floorY - SHELF_HEIGHT, TILE_SIZE, SHELF_HEIGHT)
+                           : Rectangle((tileNum - 2) * TILE_SIZE, floorY, TILE_SIZE, TILE_SIZE);
+
+            worldPtr->addSubObject(std::make_shared<MapPlatform>(rect));
+        }
+
+        shelfWidths.push_back(shelfWidth);
+    }
+
+    std::uniform_real_distribution<double> yDistribution(50, SHELF_HEIGHT - BOX_SIZE - 50);
+    std::uniform_real_distribution<double> speedDistribution(-300, 300);
+
+    for (size_t boxNum = 0; boxNum < boxCount; ++boxNum)
+    {
+        const size_t shelfNum = boxNum % shelfCount;
+        std::uniform_real_distribution<double> xDistribution(0, std::max(0.0, shelfWidths[shelfNum] - BOX_SIZE));
+        TestObjectPointer boxPtr = std::make_shared<TestObject>();
+
+        boxPtr->setPosition(Point(xDistribution(random), shelfNum * SHELF_HEIGHT + yDistribution(random)));
+        boxPtr->setSize(Point(BOX_SIZE, BOX_SIZE));
+        boxPtr->setSpeed(Point(speedDistribution(random), speedDistribution(random)));
+        worldPtr->addSubObject(boxPtr);
+        boxes.push_back(boxPtr);
+    }
+
+    return boxes;
+}
+
+
+// Moves awake bodies by their speeds without collisions, the engine stages
+// around the collision one are measured alone with it.
+class MotionOnlyProcessor : public CollisionProcessor
+{
+public:
+    MotionOnlyProcessor(SimplePhysicalEnginePointer enginePtr)
+        : CollisionProcessor(enginePtr)
+    {
+    }
+
+    virtual void updateMetadata() override
+    {
+    }
+
+    virtual void processSubStep(double frameTimeSec) override
+    {
+        BodyStore &bodyStore = getEnginePtr()->getBodyStore();
+
+        for (size_t bodyNum = 0; bodyNum < bodyStore.getBodyCount(); ++bodyNum)
+            if (bodyStore.isMovable(bodyNum) && !bodyStore.isSleeping(bodyNum))
+                bodyStore.setPosition(bodyNum, bodyStore.getX(bodyNum) + bodyStore.getSpeedX(bodyNum) * frameTimeSec,
+                                               bodyStore.getY(bodyNum) + bodyStore.getSpeedY(bodyNum) * frameTimeSec);
+    }
+};
+
+
+CollisionProcessorPointer createProcessor(const Options &options, SimplePhysicalEnginePointer enginePtr)
+{
+    if (options._processorName == "none")
+        return std::make_shared<MotionOnlyProcessor>(enginePtr);
+
+    if (options._processorName == "kinetic")
+        return std::make_shared<KineticCollisionProcessor>(enginePtr);
+
+    if (options._processorName != "strict")
+        throw std::invalid_argument("unknown processor " + options._processorName);
+
+    StrictCollisionProcessorPointer processorPtr = std::make_shared<StrictCollisionProcessor>(enginePtr);
+
+    if (options._broadPhaseName == "grid")
+        processorPtr->setBroadPhasePtr(std::make_shared<UniformGridBroadPhase>());
+    else if (options._broadPhaseName != "sap")
+        throw std::invalid_argument("unknown broad phase " + options._broadPhaseName);
+
+    return processorPtr;
+}
+
+
+double getPercentile(std::vector<double> values, double percent)
+{
+    if (values.empty())
+        return 0;
+
+    size_t num = static_cast<size_t>(percent / 100 * (values.size() - 1) + 0.5);
+    std::nth_element(values.begin(), values.begin() + num, values.end());
+    return values[num];
+}
+
+
+void printTimes(const std::string &name, const std::vector<double> &times)
+{
+    std::cout << "  " << std::left << std::setw(16) << name << std::right << std::fixed << std::setprecision(3)
+              << std::setw(10) << getPercentile(times, 50)  * 1000
+              << std::setw(10) << getPercentile(times, 90)  * 1000
+              << std::setw(10) << getPercentile(times, 99)  * 1000
+              << std::setw(10) << getPercentile(times, 100) * 1000 << std::endl;
+}
+
+
+// phases & average counters of the frames kept by the profiler
+void printProfile(const PhysicsProfiler &profiler)
+{
+    std::vector<double> phaseTimes[PhysicsProfiler::PhaseCount];
+    double counts[PhysicsProfiler::CounterCount] = {};
+
+    for (size_t frameNum = 0; frameNum < profiler.getFrameCount(); ++frameNum)
+    {
+        const PhysicsProfiler::FrameRecord &frame = profiler.getFrame(frameNum);
+
+        for (size_t phase = 0; phase < PhysicsProfiler::PhaseCount; ++phase)
+            phaseTimes[phase].push_back(frame._phaseTimes[phase]);
+
+        for (size_t counter = 0; counter < PhysicsProfiler::CounterCount; ++counter)
+            counts[counter] += frame._counts[counter];
+    }
+
+    std::cout << "  profiler phase, ms" << std::endl;
+
+    for (size_t phase = 0; phase < PhysicsProfiler::PhaseCount; ++phase)
+        printTimes(PhysicsProfiler::getPhaseName(static_cast<PhysicsProfiler::Phase>(phase)), phaseTimes[phase]);
+
+    std::cout << "  per frame";
+
+    for (size_t counter = 0; counter < PhysicsProfiler::CounterCount; ++counter)
+        std::cout << (counter == 0 ? " " : ", ")
+                  << PhysicsProfiler::getCounterName(static_cast<PhysicsProfiler::Counter>(counter)) << " "
+                  << std::setprecision(1) << counts[counter] / std::max<size_t>(1, profiler.getFrameCount());
+
+    std::cout << std::endl;
+}
+
+
+void runScene(const Options &options, size_t objectCount)
+{
+    static const char *STAGE_NAMES[PhysicalEngine::FrameStageCount]
+            = {"pre-process", "physical rules", "collisions", "post-process"};
+
+    PhysicalWorldPointer worldPtr = std::make_shared<PhysicalWorld>();
+    std::vector<TestObjectPointer> boxes = createScene(worldPtr, options, objectCount);
+
+    // the world is collected once, without rebuilds on every added object
+    PhysicalEnginePointer enginePtr = std::make_shared<PhysicalEngine>();
+    enginePtr->setWorldPtr(worldPtr);
+    enginePtr->setCollisionProcessorPtr(createProcessor(options, enginePtr.get()));
+    enginePtr->setThreadCount(options._threadCount);
+    enginePtr->setMaxCollisionIterationCount(options._maxIterationCount);
+    enginePtr->setCollisionTimeBudget(options._collisionTimeBudget);
+    enginePtr->setContactIterationCount(options._contactIterationCount);
+    enginePtr->setMaxSubStepDistance(options._maxSubStepDistance);
+    worldPtr->setEnginePtr(enginePtr);
+
+    if (!options._isSleepingEnabled)
+        enginePtr->setSleepFrameCount(0);
+
+    if (options._isProfilingEnabled)
+    {
+        enginePtr->getProfiler().setFrameCapacity(std::max<size_t>(1, options._frameCount));
+        enginePtr->getProfiler().setEnabled(true);
+    }
+
+    FrameTimes frameTimes;
+
+    Platform::instance()->frameHandler = [&enginePtr, &frameTimes]()
+    {
+        TraceRecorder::Scope scope("PhysicalEngine::processWorld", "benchmark");
+        std::chrono::steady_clock::time_point startPoint = std::chrono::steady_clock::now();
+        enginePtr->processWorld();
+        std::chrono::duration<double> frameTime = std::chrono::steady_clock::now() - startPoint;
+
+        for (size_t stage = 0; stage < PhysicalEngine::FrameStageCount; ++stage)
+            frameTimes._stageTimes[stage].push_back(
+                        enginePtr->getFrameStageTime(static_cast<PhysicalEngine::FrameStage>(stage)));
+
+        frameTimes._totalTimes.push_back(frameTime.count());
+    };
+
+    Platform::instance()->startFrameLoop();
+    Platform::instance()->runMainLoop();
+    Platform::instance()->frameHandler = nullptr;
+
+    // final state for comparison of runs
+    double checksum = 0;
+    size_t sleepingCount = 0;
+
+    for (size_t boxNum = 0; boxNum < boxes.size(); ++boxNum)
+    {
+        checksum += boxes[boxNum]->getPosition().getX() * (boxNum + 1)
+                  + boxes[boxNum]->getPosition().getY() * (boxNum + 7);
+        sleepingCount += boxes[boxNum]->isSleeping() ? 1 : 0;
+    }
+
+    std::cout << "objects " << objectCount << " (" << boxes.size() << " boxes), "
+              << options._frameCount << " frames" << std::endl;
+    std::cout << "  " << std::left << std::setw(16) << "stage, ms" << std::right
+              << std::setw(10) << "p50" << std::setw(10) << "p90"
+              << std::setw(10) << "p99" << std::setw(10) << "max" << std::endl;
+
+    for (size_t stage = 0; stage < PhysicalEngine::FrameStageCount; ++stage)
+        printTimes(STAGE_NAMES[stage], frameTimes._stageTimes[stage]);
+
+    printTimes("frame", frameTimes._totalTimes);
+
+    if (options._isProfilingEnabled)
+        printProfile(enginePtr->getProfiler());
+
+    std::cout << "  sleeping boxes " << sleepingCount << ", checksum "
+              << std::setprecision(17) << std::defaultfloat << checksum
+              << ", budget hits " << enginePtr->getCollisionBudgetHitCount() << std::endl;
+}
+
+
+}  // namespace
+
+
+int main(int argc, char *argv[])
+try
+{
+    Options options;
+
+    try
+    {
+        options = parseOptions(argc, argv);
+    }
+    catch (const std::invalid_argument &error)
+    {
+        if (*error.what() != 0)
+            std::cerr << error.what() << std::endl;
+
+        std::cerr << USAGE;
+        return 1;
+    }
+
+    std::shared_ptr<HeadlessPlatformManager> managerPtr(new HeadlessPlatformManager(argc, argv));
+    managerPtr->setFrameCount(options._frameCount);
+    Platform::instance()->initialize(managerPtr);
+    Platform::instance()->setFPS(1 / options._frameTimeSec);
+
+    std::cout << "processor " << options._processorName << ", broad phase " << options._broadPhaseName
+              << ", threads " << options._threadCount << ", dt " << options._frameTimeSec
+              << ", sleeping " << (options._isSleepingEnabled ? "on" : "off") << std::endl;
+
+    if (!options._traceFileName.empty())
+        TraceRecorder::instance()->setEnabled(true);
+
+    for (size_t objectCount : options._objectCounts)
+        runScene(options, objectCount);
+
+    if (!options._traceFileName.empty())
+    {
+        TraceRecorder::instance()->setEnabled(false);
+        TraceRecorder::instance()->writeJson(options._traceFileName);
+    }
+
+    return 0;
+}
+catch (const std::exception &error)
+{
+    std::cerr << error.what() << std::endl;
+    return 1;
+}
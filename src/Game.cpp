@@ -1,16 +1,21 @@
 // Game.cpp
 
 #include <iostream>
+#include <cstdlib>
 
 #include "platform/Platform.h"
 #include "platform/PlatformManager.h"
 #include "platform/Key.h"
+#include "platform/TraceRecorder.h"
+#include "platform/ReplayLog.h"
 #include "physics/TestObject.h"
 #include "physics/PhysicalWorld.h"
 #include "physics/PhysicalEngine.h"
+#include "physics/PhysicsProfiler.h"
 #include "physics/MapPlatform.h"
 #include "visitor/GamePainter.h"
 #include "visualizer/Visualizer.h"
+#include "visualizer/Camera.h"
 #include "Game.h"
 
 
@@ -24,16 +29,31 @@ struct Game::Impl
     {
     }
 
+    ~Impl()
+    {
+        if (Platform::instance()->getRecordingLogPtr() != nullptr)
+            stopRecording();
+    }
+
     void createDemoscene();
+    void stopRecording();
     void addPlatform(const Rectangle &rect);
     void addObject(const Rectangle &rect);
 
     KeyPointer _rightKeyPtr, _leftKeyPtr, _upKeyPtr, _downKeyPtr;
+    KeyPointer _profilerKeyPtr, _traceKeyPtr, _recordKeyPtr;
     PhysicalWorldPointer _worldPtr;
     GamePainterPointer _painterPtr;
+    CameraPointer _cameraPtr;
     GameObjectIteratorPtr _worldIteratorPtr;
     PhysicalEnginePointer _enginePtr;
     TestObjectPointer _playerPtr;
+
+    // trace file written when recording is stopped
+    std::string _traceFileName = "platformer_trace.json";
+
+    // replay log written when recording is stopped or the game is closed
+    std::string _replayFileName = "platformer_replay.log";
 };
 
 
@@ -53,9 +73,13 @@ Game::Game()
     _pimpl->_leftKeyPtr.reset(  new Key('a', Key::Left));
     _pimpl->_upKeyPtr.reset(    new Key('w', Key::Up));
     _pimpl->_downKeyPtr.reset(  new Key('s', Key::Down));
+    _pimpl->_profilerKeyPtr.reset(new Key('p'));
+    _pimpl->_traceKeyPtr.reset(new Key('t'));
+    _pimpl->_recordKeyPtr.reset(new Key('r'));
 
     // create world
     _pimpl->_painterPtr.reset(new GamePainter());
+    _pimpl->_cameraPtr.reset(new Camera());
     _pimpl->_worldPtr.reset(new PhysicalWorld());
 
     _pimpl->createDemoscene();
@@ -66,20 +90,55 @@ Game::Game()
     _pimpl->_enginePtr->setWorldPtr(_pimpl->_worldPtr);
     _pimpl->_worldPtr->setEnginePtr(_pimpl->_enginePtr);
 
+    // simulate with fixed steps, draw states interpolated between them
+    _pimpl->_enginePtr->setFixedStepTime(1.0 / 60);
+    _pimpl->_enginePtr->setMaxStepCount(5);
+
+    // a stalled step is finished approximately instead of freezing the frame,
+    // the iteration cap doesn't depend on the machine speed, so recorded
+    // sessions are replayed exactly
+    _pimpl->_enginePtr->setMaxCollisionIterationCount(256);
+
+    // fast bodies are processed by sub-steps not longer than the border thickness
+    _pimpl->_enginePtr->setMaxSubStepDistance(20);
+    _pimpl->_painterPtr->setEnginePtr(_pimpl->_enginePtr);
+
+    // the camera follows the player, the painter resizes its viewport to
+    // the window before every frame, so this size lasts till the first one
+    _pimpl->_cameraPtr->setViewport(Rectangle(0, 0, 640, 480));
+    _pimpl->_cameraPtr->setTargetPtr(_pimpl->_playerPtr);
+    _pimpl->_painterPtr->setCameraPtr(_pimpl->_cameraPtr);
+
     // frame handler
     Platform::instance()->frameHandler = [this]()
     {
-        int dirH = (_pimpl->_rightKeyPtr->isPressed() ? 1 : 0) + (_pimpl->_leftKeyPtr->isPressed() ? -1 : 0);
-        int dirV = 0; //(_pimpl->_upKeyPtr->isPressed() ?   -1 : 0) + (_pimpl->_downKeyPtr->isPressed() ?  1 : 0);
+        TraceRecorder::Scope frameScope("frame");
+
+        {
+            TraceRecorder::Scope scope("input");
 
-        Point dir(dirH, dirV);
+            int dirH = (_pimpl->_rightKeyPtr->isPressed() ? 1 : 0) + (_pimpl->_leftKeyPtr->isPressed() ? -1 : 0);
+            int dirV = 0; //(_pimpl->_upKeyPtr->isPressed() ?   -1 : 0) + (_pimpl->_downKeyPtr->isPressed() ?  1 : 0);
 
-        static const double ACCELERATION = 1000;
+            Point dir(dirH, dirV);
 
-        _pimpl->_playerPtr->setSpeed(_pimpl->_playerPtr->getSpeed()
-                                     + dir * ACCELERATION * Platform::instance()->getActualFrameTime());
-        _pimpl->_enginePtr->processWorld();
-        _pimpl->_painterPtr->visit(_pimpl->_worldIteratorPtr);
+            static const double ACCELERATION = 1000;
+
+            _pimpl->_playerPtr->setSpeed(_pimpl->_playerPtr->getSpeed()
+                                         + dir * ACCELERATION * Platform::instance()->getActualFrameTime());
+        }
+
+        {
+            TraceRecorder::Scope scope("PhysicalEngine::processWorld");
+            _pimpl->_enginePtr->processWorld();
+        }
+
+        {
+            TraceRecorder::Scope scope("GamePainter::paint");
+            _pimpl->_painterPtr->paint(_pimpl->_worldIteratorPtr);
+        }
+
+        TraceRecorder::Scope scope("Visualizer::refresh");
         Platform::visualizer()->refresh();
     };
 
@@ -89,6 +148,69 @@ Game::Game()
             _pimpl->_playerPtr->setSpeed(_pimpl->_playerPtr->getSpeed() + Point(0, -780));
     };
 
+    // the profiler is enabled with its overlay, frames of the last run are dropped
+    _pimpl->_profilerKeyPtr->onPress = [this]()
+    {
+        PhysicsProfiler &profiler = _pimpl->_enginePtr->getProfiler();
+        profiler.setEnabled(!profiler.isEnabled());
+        profiler.clear();
+        _pimpl->_painterPtr->setProfilerOverlayVisible(profiler.isEnabled());
+    };
+
+    // PLATFORMER_TRACE records the timeline from the start, the file name
+    // can be given by its value, 't' key starts recording or stops it and
+    // writes the last events, so a hitch is caught by pressing it after
+    if (const char *traceFileName = std::getenv("PLATFORMER_TRACE"))
+    {
+        if (*traceFileName != 0)
+            _pimpl->_traceFileName = traceFileName;
+
+        TraceRecorder::instance()->setEnabled(true);
+    }
+
+    _pimpl->_traceKeyPtr->onPress = [this]()
+    {
+        TraceRecorder *recorderPtr = TraceRecorder::instance();
+
+        if (!recorderPtr->isEnabled())
+        {
+            recorderPtr->clear();
+            recorderPtr->setEnabled(true);
+            return;
+        }
+
+        recorderPtr->setEnabled(false);
+
+        try
+        {
+            recorderPtr->writeJson(_pimpl->_traceFileName);
+            std::cout << "trace is written to " << _pimpl->_traceFileName << std::endl;
+        }
+        catch (const std::exception &error)
+        {
+            Platform::instance()->showWarning(error.what());
+        }
+    };
+
+    // PLATFORMER_RECORD records frame times & keys from the start, the file
+    // name can be given by its value, 'r' key starts recording or stops it
+    // and writes the log, it's replayed by GameReplay
+    if (const char *replayFileName = std::getenv("PLATFORMER_RECORD"))
+    {
+        if (*replayFileName != 0)
+            _pimpl->_replayFileName = replayFileName;
+
+        Platform::instance()->setRecordingLogPtr(std::make_shared<ReplayLog>());
+    }
+
+    _pimpl->_recordKeyPtr->onPress = [this]()
+    {
+        if (Platform::instance()->getRecordingLogPtr() == nullptr)
+            Platform::instance()->setRecordingLogPtr(std::make_shared<ReplayLog>());
+        else
+            _pimpl->stopRecording();
+    };
+
     // start
     Platform::instance()->setFPS(60);
     Platform::instance()->startFrameLoop();
@@ -109,6 +231,7 @@ void Game::Impl::createDemoscene()
 
     Point sizeH(rect.getWidth(), H);
     Point sizeV(H, rect.getHeight());
+    _cameraPtr->setBounds(Rectangle(-H, -H, rect.getWidth() + 2 * H, rect.getHeight() + 2 * H));
     addPlatform(Rectangle(Point(0, -H), sizeH));
     addPlatform(Rectangle(Point(0, rect.getHeight()), sizeH));
     addPlatform(Rectangle(Point(-H, 0), sizeV));
@@ -135,6 +258,23 @@ void Game::Impl::createDemoscene()
 }
 
 
+void Game::Impl::stopRecording()
+{
+    ReplayLogPointer logPtr = Platform::instance()->getRecordingLogPtr();
+    Platform::instance()->setRecordingLogPtr(nullptr);
+
+    try
+    {
+        logPtr->write(_replayFileName);
+        std::cout << "replay log is written to " << _replayFileName << std::endl;
+    }
+    catch (const std::exception &error)
+    {
+        Platform::instance()->showWarning(error.what());
+    }
+}
+
+
 void Game::Impl::addPlatform(const Rectangle &rect)
 {
     _worldPtr->addSubObject(std::make_shared<MapPlatform>(rect));
@@ -30,6 +30,18 @@ class HierarchicalVisitor;
 class MapPlatform;
 class CollisionProcessor;
 class StrictCollisionProcessor;
+class KineticCollisionProcessor;
+class BoundingBox;
+class BroadPhase;
+class UniformGridBroadPhase;
+class SweepAndPruneBroadPhase;
+class BodyStore;
+class ContactCache;
+class PhysicsProfiler;
+class ReplayLog;
+class DrawCommandBuffer;
+class Camera;
+class StaticLayer;
 
 template <class ValueType> using Pointer = std::shared_ptr<ValueType>;
 template <class BaseNodeType> class VisitorBase;
@@ -56,10 +68,17 @@ using HierarchicalVisitorPointer = Pointer<HierarchicalVisitor>;
 using MapPlatformPointer = Pointer<MapPlatform>;
 using CollisionProcessorPointer = Pointer<CollisionProcessor>;
 using StrictCollisionProcessorPointer = Pointer<StrictCollisionProcessor>;
+using KineticCollisionProcessorPointer = Pointer<KineticCollisionProcessor>;
+using BroadPhasePointer = Pointer<BroadPhase>;
+using UniformGridBroadPhasePointer = Pointer<UniformGridBroadPhase>;
+using SweepAndPruneBroadPhasePointer = Pointer<SweepAndPruneBroadPhase>;
+using ReplayLogPointer = Pointer<ReplayLog>;
+using CameraPointer = Pointer<Camera>;
 
 using SimpleKeyPointer = Key*;
 using SimpleGameObjectPointer = GameObject*;
 using SimplePhysicalObjectPointer = PhysicalObject*;
+using ConstSimplePhysicalObjectPointer = PhysicalObject const *;
 
 using GameObjectIteratorPtr = IteratorPointer<GameObjectPointer>;
 using RectangleIteratorPtr = IteratorPointer<Rectangle>;
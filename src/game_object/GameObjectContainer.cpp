@@ -72,7 +72,7 @@ void GameObjectContainer::removeSubObject(GameObjectPointer subObjPtr)
     if (it == _pimpl->_subObjects.end())
         throw std::logic_error("GameObjectContainer::removeSubObject: object isn't in container");
 
-    (*it)->setParentPointer(this);
+    (*it)->setParentPointer(nullptr);
     _pimpl->_subObjects.erase(it);
 
     doRemoveSubObject(subObjPtr);
@@ -0,0 +1,43 @@
+// BoundingBox.cpp
+
+#include <limits>
+
+#include "BoundingBox.h"
+
+
+namespace Platformer
+{
+
+
+BoundingBox::BoundingBox()
+    : BoundingBox( std::numeric_limits<double>::max(),  std::numeric_limits<double>::max(),
+                  -std::numeric_limits<double>::max(), -std::numeric_limits<double>::max())
+{
+}
+
+BoundingBox::BoundingBox(double left, double top, double right, double bottom)
+    : _left(left)
+    , _top(top)
+    , _right(right)
+    , _bottom(bottom)
+{
+}
+
+BoundingBox::BoundingBox(const Rectangle &rect)
+    : BoundingBox(rect.getLeft(), rect.getTop(), rect.getRight(), rect.getBottom())
+{
+}
+
+
+Rectangle BoundingBox::toRectangle() const
+{
+    return Rectangle(_left, _top, getWidth(), getHeight());
+}
+
+void BoundingBox::print(std::ostream &stream) const
+{
+    stream << "[" << _left << ", " << _top << ", " << _right << ", " << _bottom << "]";
+}
+
+
+}  // namespace Platformer
@@ -0,0 +1,79 @@
+// BoundingBox.h
+
+#ifndef BOUNDINGBOX_H
+#define BOUNDINGBOX_H
+
+#include <ostream>
+
+#include "Point.h"
+#include "Rectangle.h"
+
+
+namespace Platformer
+{
+
+
+// Axis-aligned box stored by its edges. Unlike Rectangle it is meant for
+// hot loops, so all accessors are inline.
+class BoundingBox
+{
+public:
+    BoundingBox();
+    BoundingBox(double left, double top, double right, double bottom);
+    explicit BoundingBox(const Rectangle &rect);
+
+    inline double getLeft()   const { return _left; }
+    inline double getTop()    const { return _top; }
+    inline double getRight()  const { return _right; }
+    inline double getBottom() const { return _bottom; }
+    inline double getWidth()  const { return _right - _left; }
+    inline double getHeight() const { return _bottom - _top; }
+
+    inline bool isEmpty() const
+    {
+        return _left > _right || _top > _bottom;
+    }
+
+    inline bool isCollided(const BoundingBox &box) const
+    {
+        return !(box._left   > _right  ||
+                 box._right  < _left   ||
+                 box._top    > _bottom ||
+                 box._bottom < _top);
+    }
+
+    inline void unite(const BoundingBox &box)
+    {
+        _left   = box._left   < _left   ? box._left   : _left;
+        _top    = box._top    < _top    ? box._top    : _top;
+        _right  = box._right  > _right  ? box._right  : _right;
+        _bottom = box._bottom > _bottom ? box._bottom : _bottom;
+    }
+
+    inline void move(double dx, double dy)
+    {
+        _left += dx;
+        _right += dx;
+        _top += dy;
+        _bottom += dy;
+    }
+
+    inline void expand(double value)
+    {
+        _left -= value;
+        _top -= value;
+        _right += value;
+        _bottom += value;
+    }
+
+    Rectangle toRectangle() const;
+    void print(std::ostream &stream) const;
+
+private:
+    double _left, _top, _right, _bottom;
+};
+
+
+}  // namespace Platformer
+
+#endif  // BOUNDINGBOX_H
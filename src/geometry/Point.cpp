@@ -1,6 +1,7 @@
 // Point.cpp
 
 #include <cmath>
+#include <stdexcept>
 
 #include "Point.h"
 
@@ -20,13 +21,6 @@ namespace Platformer
 
 
 
-Point::Point(double x, double y)
-//    : _pimpl(new Impl())
-{
-    setX(x);
-    setY(y);
-}
-
 Point::Point(Direction dir)
     : Point(0, 0)
 {
@@ -34,19 +28,6 @@ Point::Point(Direction dir)
     setX((dir == Up)   ? -1 : ((dir = Down)  ? 1 : 0));
 }
 
-Point::Point(const Point &other)
-    : Point(other.getX(), other.getY())
-{
-}
-
-Point &Point::operator=(const Point &other)
-{
-    setX(other.getX());
-    setY(other.getY());
-
-    return *this;
-}
-
 double Point::getLength() const
 {
     return std::sqrt(_x * _x + _y * _y);
@@ -67,25 +48,24 @@ void Point::setProjection(double value, bool isHorisontal)
     else setY(value);
 }
 
-Point::~Point() = default;
 
 
-Point Point::operator+(const Point &pt)
+Point Point::operator+(const Point &pt) const
 {
     return Point(getX() + pt.getX(), getY() + pt.getY());
 }
 
-Point Point::operator+(double val)
+Point Point::operator+(double val) const
 {
     return Point(getX() + val, getY() + val);
 }
 
-Point Point::operator*(double val)
+Point Point::operator*(double val) const
 {
     return Point(getX() * val, getY() * val);
 }
 
-Point Point::operator/(double val)
+Point Point::operator/(double val) const
 {
     return Point(getX() / val, getY() / val);
 }
@@ -18,11 +18,11 @@ Direction getOppositeDirrection(Direction dir);
 class Point
 {
 public:
-    Point(double x = 0, double y = 0);
+    inline Point(double x = 0, double y = 0) : _x(x), _y(y) {}
     Point(Direction dir);
-    Point(const Point &other);
-    Point& operator=(const Point& other);
-    ~Point();
+    Point(const Point &other) = default;
+    Point& operator=(const Point& other) = default;
+    ~Point() = default;
 
     inline double getX() const { return _x; }
     inline double getY() const { return _y; }
@@ -33,10 +33,10 @@ public:
     inline void setY(double y) { _y = y; }
     void setProjection(double value, bool isHorisontal);
 
-    Point operator+(const Point &pt);
-    Point operator+(double val);
-    Point operator*(double val);
-    Point operator/(double val);
+    Point operator+(const Point &pt) const;
+    Point operator+(double val) const;
+    Point operator*(double val) const;
+    Point operator/(double val) const;
     Point& operator+=(const Point &pt);
     Point& operator+=(double val);
     Point& operator*=(double val);
@@ -14,40 +14,39 @@ namespace Platformer
 {
 
 
+// Plain position and size, the class is trivially copyable and packs
+// into four doubles.
 class Rectangle
 {
 public:
-    Rectangle();
-    Rectangle(Point position, Point size);
-    Rectangle(double x, double y, double w, double h);
-    Rectangle(const Rectangle& other);
-    Rectangle& operator=(const Rectangle& other);
-    ~Rectangle();
-
-    Point getPosition() const;
-    Point getSize() const;
-    double getHeight() const;
-    double getWidth() const;
-    double getTop() const;
-    double getBottom() const;
-    double getX() const;
-    double getY() const;
-    double getRight() const;
-    double getLeft() const;
+    inline Rectangle() {}
+    inline Rectangle(Point position, Point size) : _position(position), _size(size) {}
+    inline Rectangle(double x, double y, double w, double h) : _position(x, y), _size(w, h) {}
+    Rectangle(const Rectangle& other) = default;
+    Rectangle& operator=(const Rectangle& other) = default;
+    ~Rectangle() = default;
+
+    inline Point getPosition() const { return _position; }
+    inline Point getSize() const     { return _size; }
+    inline double getHeight() const  { return _size.getY(); }
+    inline double getWidth() const   { return _size.getX(); }
+    inline double getTop() const     { return _position.getY(); }
+    inline double getBottom() const  { return _position.getY() + getHeight(); }
+    inline double getX() const       { return getLeft(); }
+    inline double getY() const       { return getTop(); }
+    inline double getRight() const   { return _position.getX() + getWidth(); }
+    inline double getLeft() const    { return _position.getX(); }
     bool isPointInside(const Point &point) const;
     bool isCollided(const Rectangle& rect) const;
     bool isStrongCollided(const Rectangle& rect) const;
 
-    void setPosition(const Point &position);
-    void setSize(const Point &size);
+    inline void setPosition(const Point &position) { _position = position; }
+    inline void setSize(const Point &size)         { _size = size; }
 
     void print(std::ostream &stream) const;
 
 private:
     Point _position, _size;
-
-//    struct Impl;
-//    std::unique_ptr<Impl> _pimpl;
 };
 
 
@@ -0,0 +1,38 @@
+// RectangleSpan.h
+
+#ifndef RECTANGLESPAN_H
+#define RECTANGLESPAN_H
+
+#include <cstddef>
+
+#include "Rectangle.h"
+
+
+namespace Platformer
+{
+
+
+// Non-owning view of contiguous rectangles, it's valid while the storage
+// isn't changed
+class RectangleSpan
+{
+public:
+    inline RectangleSpan() {}
+    inline RectangleSpan(const Rectangle *data, size_t count) : _data(data), _count(count) {}
+
+    inline const Rectangle *begin() const { return _data; }
+    inline const Rectangle *end() const   { return _data + _count; }
+    inline size_t getCount() const        { return _count; }
+    inline bool isEmpty() const           { return _count == 0; }
+
+    inline const Rectangle &operator[](size_t num) const { return _data[num]; }
+
+private:
+    const Rectangle *_data = nullptr;
+    size_t _count = 0;
+};
+
+
+}  // namespace Platformer
+
+#endif  // RECTANGLESPAN_H
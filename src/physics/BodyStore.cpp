@@ -0,0 +1,377 @@
+// BodyStore.cpp
+
+#include <algorithm>
+
+#include "geometry/Rectangle.h"
+#include "PhysicalObject.h"
+#include "BodyStore.h"
+
+
+namespace Platformer
+{
+
+
+const size_t BodyStore::NO_BODY;
+
+
+BodyStore::BodyStore()
+{
+}
+
+
+BodyStore::~BodyStore()
+{
+    clear();
+}
+
+
+size_t BodyStore::getBodyNum(ConstSimplePhysicalObjectPointer objectPtr) const
+{
+    if (objectPtr == nullptr || objectPtr->getBodyStorePtr() != this)
+        return NO_BODY;
+
+    return objectPtr->getBodyNum();
+}
+
+
+size_t BodyStore::getBodyNum(Handle handle) const
+{
+    if (   handle._slotNum >= _slotBodyNums.size()
+        || _slotGenerations[handle._slotNum] != handle._generation)
+        return NO_BODY;
+
+    return _slotBodyNums[handle._slotNum];
+}
+
+
+size_t BodyStore::attach(SimplePhysicalObjectPointer objectPtr)
+{
+    if (objectPtr == nullptr)
+        throw std::logic_error("BodyStore::attach: object is null");
+
+    if (objectPtr->getBodyStorePtr() != nullptr)
+        objectPtr->getBodyStorePtr()->remove(objectPtr->getBodyNum());
+
+    const size_t num = _objectPtrs.size();
+    Point position = objectPtr->getPosition();
+    Point speed = objectPtr->getSpeed();
+
+    Handle handle;
+
+    if (_freeSlotNums.empty())
+    {
+        handle._slotNum = static_cast<uint32_t>(_slotBodyNums.size());
+        _slotBodyNums.push_back(num);
+        _slotGenerations.push_back(0);
+    }
+    else
+    {
+        handle._slotNum = _freeSlotNums.back();
+        _freeSlotNums.pop_back();
+        _slotBodyNums[handle._slotNum] = num;
+    }
+
+    handle._generation = _slotGenerations[handle._slotNum];
+
+    // the nearest physical ancestor of the store moves the body with it
+    Handle parentHandle;
+
+    for (SimpleGameObjectPointer parentPtr = objectPtr->getParentPointer();
+         parentPtr != nullptr; parentPtr = parentPtr->getParentPointer())
+    {
+        const size_t parentNum = getBodyNum(dynamic_cast<SimplePhysicalObjectPointer>(parentPtr));
+
+        if (parentNum != NO_BODY)
+        {
+            parentHandle = _handles[parentNum];
+            break;
+        }
+    }
+
+    _objectPtrs.push_back(objectPtr);
+    _xs.push_back(position.getX());
+    _ys.push_back(position.getY());
+    _speedXs.push_back(speed.getX());
+    _speedYs.push_back(speed.getY());
+    _masses.push_back(0);
+    _frictionFactors.push_back(0);
+    _flags.push_back(objectPtr->isSleeping() ? SleepingBody : 0);
+    _localBoxes.emplace_back();
+    _boxes.emplace_back();
+    _sweptBoxes.emplace_back();
+    _handles.push_back(handle);
+    _parentHandles.push_back(parentHandle);
+    _linkHandles.insert(_linkHandles.end(), DIRECTION_COUNT, Handle());
+    _firstRectNums.push_back(_localRects.getCount());
+    _rectCounts.push_back(0);
+    _moveStamps.push_back(++_lastMoveStamp);
+    _geometryStamps.push_back(0);
+
+    objectPtr->setBody(this, num);
+    updateBody(num);
+
+    return num;
+}
+
+
+void BodyStore::detach(size_t num)
+{
+    SimplePhysicalObjectPointer objectPtr = _objectPtrs[num];
+
+    // the body stays in the store till clear()
+    if (objectPtr != nullptr)
+        objectPtr->setBody(nullptr, 0);
+
+    _objectPtrs[num] = nullptr;
+}
+
+
+void BodyStore::remove(size_t num)
+{
+    if (num >= _objectPtrs.size())
+        throw std::logic_error("BodyStore::remove: wrong body number");
+
+    detach(num);
+    _garbageRectCount += _rectCounts[num];
+
+    // release the handle
+    const uint32_t slotNum = _handles[num]._slotNum;
+    _slotBodyNums[slotNum] = NO_BODY;
+    ++_slotGenerations[slotNum];
+    _freeSlotNums.push_back(slotNum);
+
+    // move the last body to the freed number
+    const size_t lastNum = _objectPtrs.size() - 1;
+
+    if (num != lastNum)
+    {
+        _objectPtrs[num] = _objectPtrs[lastNum];
+        _xs[num]         = _xs[lastNum];
+        _ys[num]         = _ys[lastNum];
+        _speedXs[num]    = _speedXs[lastNum];
+        _speedYs[num]    = _speedYs[lastNum];
+        _masses[num]     = _masses[lastNum];
+        _flags[num]      = _flags[lastNum];
+        _localBoxes[num] = _localBoxes[lastNum];
+        _boxes[num]      = _boxes[lastNum];
+        _sweptBoxes[num] = _sweptBoxes[lastNum];
+        _handles[num]    = _handles[lastNum];
+
+        _frictionFactors[num] = _frictionFactors[lastNum];
+        _parentHandles[num]   = _parentHandles[lastNum];
+        _firstRectNums[num]   = _firstRectNums[lastNum];
+        _rectCounts[num]      = _rectCounts[lastNum];
+        _moveStamps[num]      = _moveStamps[lastNum];
+        _geometryStamps[num]  = _geometryStamps[lastNum];
+
+        std::copy_n(_linkHandles.begin() + lastNum * DIRECTION_COUNT, DIRECTION_COUNT,
+                    _linkHandles.begin() + num * DIRECTION_COUNT);
+
+        _slotBodyNums[_handles[num]._slotNum] = num;
+
+        if (_objectPtrs[num] != nullptr)
+            _objectPtrs[num]->setBody(this, num);
+    }
+
+    _objectPtrs.pop_back();
+    _xs.pop_back();
+    _ys.pop_back();
+    _speedXs.pop_back();
+    _speedYs.pop_back();
+    _masses.pop_back();
+    _frictionFactors.pop_back();
+    _flags.pop_back();
+    _localBoxes.pop_back();
+    _boxes.pop_back();
+    _sweptBoxes.pop_back();
+    _handles.pop_back();
+    _parentHandles.pop_back();
+    _linkHandles.resize(_linkHandles.size() - DIRECTION_COUNT);
+    _firstRectNums.pop_back();
+    _rectCounts.pop_back();
+    _moveStamps.pop_back();
+    _geometryStamps.pop_back();
+
+    if (_garbageRectCount > _localRects.getCount() / 2)
+        compactRects();
+}
+
+
+void BodyStore::clear()
+{
+    for (size_t num = 0; num < _objectPtrs.size(); ++num)
+    {
+        detach(num);
+
+        const uint32_t slotNum = _handles[num]._slotNum;
+        _slotBodyNums[slotNum] = NO_BODY;
+        ++_slotGenerations[slotNum];
+        _freeSlotNums.push_back(slotNum);
+    }
+
+    _objectPtrs.clear();
+    _xs.clear();
+    _ys.clear();
+    _speedXs.clear();
+    _speedYs.clear();
+    _masses.clear();
+    _frictionFactors.clear();
+    _flags.clear();
+    _localBoxes.clear();
+    _boxes.clear();
+    _sweptBoxes.clear();
+    _handles.clear();
+    _parentHandles.clear();
+    _linkHandles.clear();
+    _localRects.clear();
+    _worldRects.clear();
+    _firstRectNums.clear();
+    _rectCounts.clear();
+    _garbageRectCount = 0;
+    _moveStamps.clear();
+    _geometryStamps.clear();
+}
+
+
+void BodyStore::updateBody(size_t num)
+{
+    SimplePhysicalObjectPointer objectPtr = _objectPtrs[num];
+    BoundingBox &localBox = _localBoxes[num];
+
+    _masses[num] = objectPtr->getMass();
+    _frictionFactors[num] = objectPtr->getFrictionFactor();
+    _flags[num] = objectPtr->isMovable() ? (_flags[num] | MovableBody) : (_flags[num] & ~MovableBody);
+
+    // geometry and its bounds in the object coordinates
+    const RectangleSpan geometry = objectPtr->getGeometrySpan();
+    localBox = BoundingBox();
+
+    for (const Rectangle &rect : geometry)
+        localBox.unite(BoundingBox(rect));
+
+    // the range is moved to the end if the rectangle count is changed
+    if (geometry.getCount() != _rectCounts[num])
+    {
+        _garbageRectCount += _rectCounts[num];
+        _firstRectNums[num] = _localRects.getCount();
+        _rectCounts[num] = geometry.getCount();
+
+        for (size_t rectNum = 0; rectNum < geometry.getCount(); ++rectNum)
+        {
+            _localRects.addRectangle(geometry[rectNum]);
+            _worldRects.addRectangle(geometry[rectNum]);
+        }
+    }
+    else
+    {
+        for (size_t rectNum = 0; rectNum < geometry.getCount(); ++rectNum)
+            _localRects.setRectangle(_firstRectNums[num] + rectNum, geometry[rectNum]);
+    }
+
+    // consumers of move stamps see the new geometry as a move
+    _moveStamps[num] = ++_lastMoveStamp;
+    _geometryStamps[num] = 0;
+
+    if (_garbageRectCount > _localRects.getCount() / 2)
+        compactRects();
+}
+
+
+bool BodyStore::updateGeometry(size_t num)
+{
+    if (!isMovedSince(num, _geometryStamps[num]))
+        return false;
+
+    // positions are summed in the order of GameObject::mapToGlobal
+    for (size_t rectNum = _firstRectNums[num]; rectNum < _firstRectNums[num] + _rectCounts[num]; ++rectNum)
+    {
+        Rectangle rect = _localRects.getRectangle(rectNum);
+        Point position = rect.getPosition() + getPosition(num);
+
+        for (size_t parentNum = getParentNum(num); parentNum != NO_BODY; parentNum = getParentNum(parentNum))
+            position += getPosition(parentNum);
+
+        rect.setPosition(position);
+        _worldRects.setRectangle(rectNum, rect);
+    }
+
+    Point offset;
+
+    for (size_t parentNum = getParentNum(num); parentNum != NO_BODY; parentNum = getParentNum(parentNum))
+        offset += getPosition(parentNum);
+
+    _boxes[num] = _localBoxes[num];
+
+    if (!_boxes[num].isEmpty())
+        _boxes[num].move(offset.getX() + _xs[num], offset.getY() + _ys[num]);
+
+    _geometryStamps[num] = _lastMoveStamp;
+    return true;
+}
+
+
+bool BodyStore::isMovedSince(size_t num, uint64_t stamp) const
+{
+    bool isMoved = _moveStamps[num] > stamp;
+
+    for (size_t parentNum = getParentNum(num); parentNum != NO_BODY && !isMoved; parentNum = getParentNum(parentNum))
+        isMoved = _moveStamps[parentNum] > stamp;
+
+    return isMoved;
+}
+
+
+void BodyStore::updateSweptBox(size_t num, const Point &shift, double timeErrorRate, double margin)
+{
+    updateGeometry(num);
+
+    BoundingBox &box = _sweptBoxes[num];
+    box = _boxes[num];
+
+    if (box.isEmpty())
+        return;
+
+    BoundingBox endBox = box;
+    box.move(-shift.getX() * timeErrorRate, -shift.getY() * timeErrorRate);
+    endBox.move(shift.getX(), shift.getY());
+    box.unite(endBox);
+    box.expand(margin);
+}
+
+
+size_t BodyStore::getParentNum(size_t num) const
+{
+    return getBodyNum(_parentHandles[num]);
+}
+
+
+void BodyStore::resetLinks(size_t num)
+{
+    std::fill_n(_linkHandles.begin() + num * DIRECTION_COUNT, DIRECTION_COUNT, Handle());
+}
+
+
+void BodyStore::compactRects()
+{
+    PackedRectangles localRects;
+    PackedRectangles worldRects;
+
+    for (size_t num = 0; num < _objectPtrs.size(); ++num)
+    {
+        const size_t firstRectNum = _firstRectNums[num];
+        _firstRectNums[num] = localRects.getCount();
+
+        for (size_t rectNum = firstRectNum; rectNum < firstRectNum + _rectCounts[num]; ++rectNum)
+        {
+            localRects.addRectangle(_localRects.getRectangle(rectNum));
+            worldRects.addRectangle(_worldRects.getRectangle(rectNum));
+        }
+    }
+
+    _localRects = std::move(localRects);
+    _worldRects = std::move(worldRects);
+    _garbageRectCount = 0;
+}
+
+
+}  // namespace Platformer
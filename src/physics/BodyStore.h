@@ -0,0 +1,215 @@
+// BodyStore.h
+
+#ifndef BODYSTORE_H
+#define BODYSTORE_H
+
+#include <vector>
+#include <cstdint>
+
+#include "Types.h"
+#include "geometry/Point.h"
+#include "geometry/BoundingBox.h"
+#include "TimeOfImpactKernel.h"
+
+
+namespace Platformer
+{
+
+
+// Structure of arrays with the state of physical objects the engine works
+// with. Attached objects read and write their position, speed, sleeping
+// flag and contiguous links through the store, so hot loops can iterate
+// the arrays directly. Mass, friction factor, movability and geometry are
+// sampled on attach and refreshed by updateBody(), which also counts as a
+// move for isMovedSince(). Bodies are removed by moving the last body to
+// the freed number, handles stay valid while the body is in the store.
+//
+// World rectangles of the body geometry are cached contiguously. They are
+// recomputed by updateGeometry() only if setPosition() was called for the
+// body or for one of its ancestor bodies since the last update. Parents
+// have to be attached before their sub-objects.
+class BodyStore
+{
+public:
+    struct Handle
+    {
+        uint32_t _slotNum = static_cast<uint32_t>(-1);
+        uint32_t _generation = 0;
+
+        inline bool operator==(const Handle &other) const
+        {
+            return _slotNum == other._slotNum && _generation == other._generation;
+        }
+
+        inline bool operator!=(const Handle &other) const
+        {
+            return !(*this == other);
+        }
+    };
+
+    enum BodyFlag : uint8_t
+    {
+        MovableBody  = 1,
+        SleepingBody = 2
+    };
+
+    static const size_t NO_BODY = static_cast<size_t>(-1);
+
+    BodyStore();
+    ~BodyStore();
+
+    // objects keep pointers to the store, so it can't be copied or moved
+    BodyStore(const BodyStore&) = delete;
+    BodyStore& operator=(const BodyStore&) = delete;
+
+    inline size_t getBodyCount() const                            { return _objectPtrs.size(); }
+    inline SimplePhysicalObjectPointer getObjectPtr(size_t num) const { return _objectPtrs[num]; }
+
+    inline double getX(size_t num) const      { return _xs[num]; }
+    inline double getY(size_t num) const      { return _ys[num]; }
+    inline double getSpeedX(size_t num) const { return _speedXs[num]; }
+    inline double getSpeedY(size_t num) const { return _speedYs[num]; }
+    inline double getMass(size_t num) const   { return _masses[num]; }
+    inline double getFrictionFactor(size_t num) const { return _frictionFactors[num]; }
+    inline uint8_t getFlags(size_t num) const { return _flags[num]; }
+
+    inline Point getPosition(size_t num) const { return Point(_xs[num], _ys[num]); }
+    inline Point getSpeed(size_t num) const    { return Point(_speedXs[num], _speedYs[num]); }
+
+    inline bool isMovable(size_t num) const  { return (_flags[num] & MovableBody) != 0; }
+    inline bool isSleeping(size_t num) const { return (_flags[num] & SleepingBody) != 0; }
+
+    // active bodies can start a collision: they are awake and movable or
+    // moving, pairs of two inactive bodies are never tested
+    inline bool isActive(size_t num) const
+    {
+        return !isSleeping(num) && (isMovable(num) || _speedXs[num] != 0 || _speedYs[num] != 0);
+    }
+
+    // world geometry and its bounds, valid after updateGeometry()
+    inline const BoundingBox &getBox(size_t num) const { return _boxes[num]; }
+
+    // bounds of the body motion, valid after updateSweptBox()
+    inline const BoundingBox &getSweptBox(size_t num) const { return _sweptBoxes[num]; }
+
+    inline RectangleBatch getWorldRects(size_t num) const
+    {
+        return _worldRects.getBatch(_firstRectNums[num], _rectCounts[num]);
+    }
+
+    inline void setPosition(size_t num, double x, double y)
+    {
+        if (_xs[num] == x && _ys[num] == y)
+            return;
+
+        _xs[num] = x;
+        _ys[num] = y;
+        _moveStamps[num] = ++_lastMoveStamp;
+    }
+
+    inline void setSpeed(size_t num, double speedX, double speedY)
+    {
+        _speedXs[num] = speedX;
+        _speedYs[num] = speedY;
+    }
+
+    // arrays of batched passes over all bodies, positions aren't exposed,
+    // their changes have to go through setPosition() to bump move stamps
+    inline double *getSpeedXData()            { return _speedXs.data(); }
+    inline double *getSpeedYData()            { return _speedYs.data(); }
+    inline const uint8_t *getFlagData() const { return _flags.data(); }
+
+    inline void setIsSleeping(size_t num, bool isSleeping)
+    {
+        _flags[num] = isSleeping ? (_flags[num] | SleepingBody) : (_flags[num] & ~SleepingBody);
+    }
+
+    // number of the object body in this store or NO_BODY
+    size_t getBodyNum(ConstSimplePhysicalObjectPointer objectPtr) const;
+
+    // number of the body with the handle or NO_BODY if it was removed
+    size_t getBodyNum(Handle handle) const;
+    inline Handle getHandle(size_t num) const { return _handles[num]; }
+
+    size_t attach(SimplePhysicalObjectPointer objectPtr);
+    void detach(size_t num);
+
+    // the last body takes the number of the removed one
+    void remove(size_t num);
+    void clear();
+    void updateBody(size_t num);
+
+    // returns false if the cached world geometry is still valid
+    bool updateGeometry(size_t num);
+
+    // Positions of the body or its ancestors were set after the stamp was
+    // taken by getLastMoveStamp(), so the world geometry could be changed.
+    bool isMovedSince(size_t num, uint64_t stamp) const;
+    inline uint64_t getLastMoveStamp() const { return _lastMoveStamp; }
+
+    // Sweeps the world bounds by the shift of the body motion. The motion
+    // starts timeErrorRate of the shift earlier, like the time rates of
+    // collision tests, and the bounds are expanded by the margin.
+    void updateSweptBox(size_t num, const Point &shift, double timeErrorRate, double margin);
+
+    // number of the nearest physical ancestor body or NO_BODY
+    size_t getParentNum(size_t num) const;
+
+    // Contiguous bodies linked by collision processing, the number is
+    // NO_BODY if there is no link or the linked body was removed.
+    inline size_t getLinkedBodyNum(size_t num, Direction dir) const
+    {
+        return getBodyNum(_linkHandles[num * DIRECTION_COUNT + dir]);
+    }
+
+    inline void setLink(size_t num, Direction dir, Handle handle)
+    {
+        _linkHandles[num * DIRECTION_COUNT + dir] = handle;
+    }
+
+    void resetLinks(size_t num);
+
+private:
+    void compactRects();
+
+private:
+    std::vector<SimplePhysicalObjectPointer> _objectPtrs;
+    std::vector<double> _xs, _ys;
+    std::vector<double> _speedXs, _speedYs;
+    std::vector<double> _masses;
+    std::vector<double> _frictionFactors;
+    std::vector<uint8_t> _flags;
+    std::vector<BoundingBox> _localBoxes;
+    std::vector<BoundingBox> _boxes;
+    std::vector<BoundingBox> _sweptBoxes;
+    std::vector<Handle> _handles;
+    std::vector<Handle> _parentHandles;
+
+    // handles of contiguous bodies, DIRECTION_COUNT per body
+    std::vector<Handle> _linkHandles;
+    static const size_t DIRECTION_COUNT = 4;
+
+    // geometry ranges of bodies, ranges of removed bodies are garbage
+    // until the next compaction
+    PackedRectangles _localRects;
+    PackedRectangles _worldRects;
+    std::vector<size_t> _firstRectNums;
+    std::vector<size_t> _rectCounts;
+    size_t _garbageRectCount = 0;
+
+    // world geometry is valid while no move stamp of the body or its
+    // ancestors is greater than its geometry stamp
+    std::vector<uint64_t> _moveStamps;
+    std::vector<uint64_t> _geometryStamps;
+    uint64_t _lastMoveStamp = 0;
+
+    // handle slots keep body numbers, generations make old handles invalid
+    std::vector<size_t> _slotBodyNums;
+    std::vector<uint32_t> _slotGenerations;
+    std::vector<uint32_t> _freeSlotNums;
+};
+
+
+}  // namespace Platformer
+
+#endif  // BODYSTORE_H
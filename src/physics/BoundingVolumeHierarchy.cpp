@@ -0,0 +1,158 @@
+// BoundingVolumeHierarchy.cpp
+
+#include <algorithm>
+
+#include "BoundingVolumeHierarchy.h"
+
+
+namespace Platformer
+{
+
+
+struct BoundingVolumeHierarchy::Impl
+{
+    Impl()
+    {
+    }
+
+    struct Node
+    {
+        BoundingBox _box;
+
+        // leaf nodes refer to items, inner nodes to the second child,
+        // the first child of an inner node always follows it
+        size_t _firstItemNum = 0;
+        size_t _itemCount = 0;
+        size_t _secondChildNum = 0;
+    };
+
+    size_t buildNode(size_t firstItemNum, size_t itemCount);
+
+    std::vector<Item> _items;
+    std::vector<Node> _nodes;
+
+    // constants
+    static const size_t MAX_LEAF_ITEM_COUNT = 4;
+    static const size_t MAX_DEPTH = 64;
+};
+
+
+
+BoundingVolumeHierarchy::BoundingVolumeHierarchy()
+    : _pimpl(new Impl())
+{
+}
+
+BoundingVolumeHierarchy::BoundingVolumeHierarchy(BoundingVolumeHierarchy&& /*other*/) = default;
+BoundingVolumeHierarchy& BoundingVolumeHierarchy::operator=(BoundingVolumeHierarchy&& /*other*/) = default;
+BoundingVolumeHierarchy::~BoundingVolumeHierarchy() = default;
+
+
+size_t BoundingVolumeHierarchy::getItemCount() const
+{
+    return _pimpl->_items.size();
+}
+
+
+BoundingBox BoundingVolumeHierarchy::getBoundingBox() const
+{
+    return _pimpl->_nodes.empty() ? BoundingBox() : _pimpl->_nodes.front()._box;
+}
+
+
+void BoundingVolumeHierarchy::query(const BoundingBox &box, std::vector<size_t> &values) const
+{
+    if (_pimpl->_nodes.empty())
+        return;
+
+    size_t nodeStack[Impl::MAX_DEPTH];
+    size_t stackSize = 0;
+    nodeStack[stackSize++] = 0;
+
+    for ( ; stackSize > 0; )
+    {
+        const Impl::Node &node = _pimpl->_nodes[nodeStack[--stackSize]];
+
+        if (!node._box.isCollided(box))
+            continue;
+
+        if (node._itemCount > 0)
+        {
+            for (size_t itemNum = node._firstItemNum; itemNum < node._firstItemNum + node._itemCount; ++itemNum)
+                if (_pimpl->_items[itemNum].first.isCollided(box))
+                    values.push_back(_pimpl->_items[itemNum].second);
+        }
+        else
+        {
+            nodeStack[stackSize++] = node._secondChildNum;
+            nodeStack[stackSize++] = (&node - &_pimpl->_nodes.front()) + 1;
+        }
+    }
+}
+
+
+void BoundingVolumeHierarchy::build(std::vector<Item> items)
+{
+    _pimpl->_items = std::move(items);
+    _pimpl->_nodes.clear();
+
+    if (_pimpl->_items.empty())
+        return;
+
+    _pimpl->_nodes.reserve(2 * _pimpl->_items.size() / Impl::MAX_LEAF_ITEM_COUNT + 1);
+    _pimpl->buildNode(0, _pimpl->_items.size());
+}
+
+
+void BoundingVolumeHierarchy::clear()
+{
+    _pimpl->_items.clear();
+    _pimpl->_nodes.clear();
+}
+
+
+size_t BoundingVolumeHierarchy::Impl::buildNode(size_t firstItemNum, size_t itemCount)
+{
+    size_t nodeNum = _nodes.size();
+    _nodes.emplace_back();
+
+    BoundingBox box;
+
+    for (size_t itemNum = firstItemNum; itemNum < firstItemNum + itemCount; ++itemNum)
+        box.unite(_items[itemNum].first);
+
+    _nodes[nodeNum]._box = box;
+
+    if (itemCount <= MAX_LEAF_ITEM_COUNT)
+    {
+        _nodes[nodeNum]._firstItemNum = firstItemNum;
+        _nodes[nodeNum]._itemCount = itemCount;
+        return nodeNum;
+    }
+
+    // split items by the median of box centers along the longest axis,
+    // so the tree depth is logarithmic
+    const bool isHorizontalSplit = box.getWidth() >= box.getHeight();
+    auto firstIt  = _items.begin() + firstItemNum;
+    auto middleIt = firstIt + itemCount / 2;
+
+    std::nth_element(firstIt, middleIt, firstIt + itemCount,
+                     [isHorizontalSplit](const Item &firstItem, const Item &secondItem)
+    {
+        if (isHorizontalSplit)
+            return   firstItem.first.getLeft() + firstItem.first.getRight()
+                   < secondItem.first.getLeft() + secondItem.first.getRight();
+        else
+            return   firstItem.first.getTop() + firstItem.first.getBottom()
+                   < secondItem.first.getTop() + secondItem.first.getBottom();
+    });
+
+    buildNode(firstItemNum, itemCount / 2);
+    size_t secondChildNum = buildNode(firstItemNum + itemCount / 2, itemCount - itemCount / 2);
+    _nodes[nodeNum]._secondChildNum = secondChildNum;
+
+    return nodeNum;
+}
+
+
+}  // namespace Platformer
@@ -0,0 +1,47 @@
+// BoundingVolumeHierarchy.h
+
+#ifndef BOUNDINGVOLUMEHIERARCHY_H
+#define BOUNDINGVOLUMEHIERARCHY_H
+
+#include <memory>
+#include <vector>
+#include <utility>
+
+#include "Types.h"
+#include "geometry/BoundingBox.h"
+
+
+namespace Platformer
+{
+
+
+// Static tree of bounding boxes. It is built once for geometry that doesn't
+// move and answers which boxes overlap the given one.
+class BoundingVolumeHierarchy
+{
+public:
+    using Item = std::pair<BoundingBox, size_t>;
+
+    BoundingVolumeHierarchy();
+    BoundingVolumeHierarchy(BoundingVolumeHierarchy&& other);
+    virtual BoundingVolumeHierarchy& operator=(BoundingVolumeHierarchy&& other);
+    virtual ~BoundingVolumeHierarchy();
+
+    size_t getItemCount() const;
+    BoundingBox getBoundingBox() const;
+
+    // appends values of items overlapping the box
+    void query(const BoundingBox &box, std::vector<size_t> &values) const;
+
+    void build(std::vector<Item> items);
+    void clear();
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> _pimpl;
+};
+
+
+}  // namespace Platformer
+
+#endif  // BOUNDINGVOLUMEHIERARCHY_H
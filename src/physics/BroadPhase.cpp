@@ -0,0 +1,42 @@
+// BroadPhase.cpp
+
+#include <algorithm>
+
+#include "BroadPhase.h"
+
+
+namespace Platformer
+{
+
+
+struct BroadPhase::Impl
+{
+    Impl()
+    {
+    }
+};
+
+
+
+BroadPhase::BroadPhase()
+    : _pimpl(new Impl())
+{
+}
+
+BroadPhase::BroadPhase(BroadPhase&& /*other*/) = default;
+BroadPhase& BroadPhase::operator=(BroadPhase&& /*other*/) = default;
+BroadPhase::~BroadPhase() = default;
+
+
+void BroadPhase::findPairs(const std::vector<Proxy> &proxies, std::vector<Pair> &pairs)
+{
+    pairs.clear();
+    doFindPairs(proxies, pairs);
+
+    // keep the order of brute force enumeration, so the earliest collision
+    // is chosen the same way regardless of the broad phase implementation
+    std::sort(pairs.begin(), pairs.end());
+}
+
+
+}  // namespace Platformer
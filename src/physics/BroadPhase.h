@@ -0,0 +1,59 @@
+// BroadPhase.h
+
+#ifndef BROADPHASE_H
+#define BROADPHASE_H
+
+#include <memory>
+#include <vector>
+#include <utility>
+
+#include "Types.h"
+#include "geometry/BoundingBox.h"
+
+
+namespace Platformer
+{
+
+
+// Culls object pairs that can't collide during a (sub)step, so the
+// collision processor only runs the exact test on overlapping swept boxes.
+class BroadPhase
+{
+public:
+    struct Proxy
+    {
+        BoundingBox _box;
+        bool _isActive = true;
+    };
+
+    using Pair = std::pair<size_t, size_t>;
+
+    BroadPhase(BroadPhase&& other);
+    virtual BroadPhase& operator=(BroadPhase&& other);
+    virtual ~BroadPhase();
+
+    // Fills pairs with (less, greater) numbers of overlapping proxies sorted
+    // in lexicographical order. Pairs of two inactive (resting or sleeping)
+    // proxies are skipped.
+    void findPairs(const std::vector<Proxy> &proxies, std::vector<Pair> &pairs);
+
+protected:
+    BroadPhase();
+
+    virtual void doFindPairs(const std::vector<Proxy> &proxies, std::vector<Pair> &pairs) = 0;
+
+    static inline bool isPairNeeded(const Proxy &firstProxy, const Proxy &secondProxy)
+    {
+        return (firstProxy._isActive || secondProxy._isActive)
+                && firstProxy._box.isCollided(secondProxy._box);
+    }
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> _pimpl;
+};
+
+
+}  // namespace Platformer
+
+#endif  // BROADPHASE_H
@@ -1,5 +1,16 @@
 // CollisionProcessor.cpp
 
+#include <cmath>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+
+#include "Iterator.h"
+#include "PhysicalObject.h"
+#include "PhysicalEngine.h"
+#include "BodyStore.h"
+#include "ContactCache.h"
 #include "CollisionProcessor.h"
 
 
@@ -9,11 +20,56 @@ namespace Platformer
 
 struct CollisionProcessor::Impl
 {
+    // contact of the cache being solved, the impulse pushes the bodies
+    // apart along the direction axis
+    struct Contact
+    {
+        size_t _firstBodyNum = 0;
+        size_t _secondBodyNum = 0;
+        Direction _direction = Down;
+        double _firstInverseMass = 0;
+        double _secondInverseMass = 0;
+        double _targetSpeed = 0;
+        double _impulse = 0;
+
+        inline bool isHorizontal() const
+        {
+            return _direction == Right;
+        }
+    };
+
     Impl()
     {
     }
 
+    void findContacts(BodyStore &bodyStore, const ContactCache &contactCache, double frameTimeSec);
+    void warmStartContacts(BodyStore &bodyStore);
+    void solveContact(BodyStore &bodyStore, Contact &contact);
+    void applyImpulse(BodyStore &bodyStore, const Contact &contact, double impulse);
+
+    inline bool isTouching(const BoundingBox &firstBox, const BoundingBox &secondBox, Direction direction) const
+    {
+        return direction == Right
+                ?    std::abs(firstBox.getRight() - secondBox.getLeft()) <= CONTACT_DISTANCE
+                  && firstBox.getTop() < secondBox.getBottom() && secondBox.getTop() < firstBox.getBottom()
+                :    std::abs(firstBox.getBottom() - secondBox.getTop()) <= CONTACT_DISTANCE
+                  && firstBox.getLeft() < secondBox.getRight() && secondBox.getLeft() < firstBox.getRight();
+    }
+
     SimplePhysicalEnginePointer _enginePtr;
+
+    // resting contacts of the current frame
+    std::vector<Contact> _contacts;
+
+    const double CONTACT_DISTANCE = 0.01;
+
+    // collision budget of the current frame
+    size_t _maxIterationCount = 0;
+    size_t _iterationCount = 0;
+    bool _isBudgetSpent = false;
+    double _timeBudget = 0;
+    std::chrono::steady_clock::time_point _startPoint;
+    size_t _budgetHitCount = 0;
 };
 
 
@@ -39,12 +95,439 @@ SimplePhysicalEnginePointer CollisionProcessor::getEnginePtr() const
 }
 
 
+size_t CollisionProcessor::getBudgetHitCount() const
+{
+    return _pimpl->_budgetHitCount;
+}
+
+
 void CollisionProcessor::setEnginePtr(SimplePhysicalEnginePointer enginePtr)
 {
     _pimpl->_enginePtr = enginePtr;
 }
 
 
+void CollisionProcessor::beginFrame(double /*frameTimeSec*/)
+{
+}
+
+
+void CollisionProcessor::processFrame(double frameTimeSec)
+{
+    beginFrame(frameTimeSec);
+    processSubStep(frameTimeSec);
+}
+
+
+void CollisionProcessor::startBudget()
+{
+    _pimpl->_maxIterationCount = getEnginePtr()->getMaxCollisionIterationCount();
+    _pimpl->_iterationCount = 0;
+    _pimpl->_isBudgetSpent = false;
+    _pimpl->_timeBudget = getEnginePtr()->getCollisionTimeBudget();
+
+    if (_pimpl->_timeBudget != 0)
+        _pimpl->_startPoint = std::chrono::steady_clock::now();
+}
+
+
+bool CollisionProcessor::isBudgetSpent()
+{
+    // later sub-steps of a spent frame are finished approximately too
+    if (_pimpl->_isBudgetSpent)
+        return true;
+
+    const size_t iterationCount = _pimpl->_iterationCount++;
+    bool isSpent = _pimpl->_maxIterationCount != 0 && iterationCount >= _pimpl->_maxIterationCount;
+
+    if (!isSpent && _pimpl->_timeBudget != 0)
+    {
+        std::chrono::duration<double> time = std::chrono::steady_clock::now() - _pimpl->_startPoint;
+        isSpent = time.count() > _pimpl->_timeBudget;
+    }
+
+    if (isSpent)
+    {
+        _pimpl->_isBudgetSpent = true;
+        ++_pimpl->_budgetHitCount;
+    }
+
+    return isSpent;
+}
+
+
+void CollisionProcessor::solveContacts(double frameTimeSec)
+{
+    const size_t iterationCount = getEnginePtr()->getContactIterationCount();
+    BodyStore &bodyStore = getEnginePtr()->getBodyStore();
+    ContactCache &contactCache = getEnginePtr()->getContactCache();
+
+    _pimpl->_contacts.clear();
+
+    if (iterationCount == 0)
+        return;
+
+    _pimpl->findContacts(bodyStore, contactCache, frameTimeSec);
+    _pimpl->warmStartContacts(bodyStore);
+
+    for (size_t iterationNum = 0; iterationNum < iterationCount; ++iterationNum)
+        for (Impl::Contact &contact : _pimpl->_contacts)
+            _pimpl->solveContact(bodyStore, contact);
+
+    // solved contacts stay in the cache without rediscovery by events
+    for (const Impl::Contact &contact : _pimpl->_contacts)
+        contactCache.refreshContact(contact._firstBodyNum, contact._secondBodyNum, contact._direction)._impulse
+                = contact._impulse;
+}
+
+
+void CollisionProcessor::linkContacts()
+{
+    BodyStore &bodyStore = getEnginePtr()->getBodyStore();
+
+    for (const Impl::Contact &contact : _pimpl->_contacts)
+    {
+        SimplePhysicalObjectPointer firstObjPtr  = bodyStore.getObjectPtr(contact._firstBodyNum);
+        SimplePhysicalObjectPointer secondObjPtr = bodyStore.getObjectPtr(contact._secondBodyNum);
+
+        firstObjPtr->setContiguousObject(contact._direction, secondObjPtr);
+        secondObjPtr->setContiguousObject(getOppositeDirrection(contact._direction), firstObjPtr);
+    }
+}
+
+
+void CollisionProcessor::addBody(size_t /*bodyNum*/)
+{
+    updateMetadata();
+}
+
+
+void CollisionProcessor::removeBody(size_t /*bodyNum*/)
+{
+    updateMetadata();
+}
+
+
+bool CollisionProcessor::findCollisionBetween(SimplePhysicalObjectPointer firstObjPtr,  const Point &firstShift,
+                                              SimplePhysicalObjectPointer secondObjPtr, const Point &secondShift,
+                                              double frameTimeSec,
+                                              double &timeRate, Direction &direction) const
+{
+    if (!firstObjPtr->isMovable() && !secondObjPtr->isMovable())
+        return false;
+
+    // world rectangles are recomputed only for moved objects
+    BodyStore &bodyStore = getEnginePtr()->getBodyStore();
+    const size_t firstBodyNum  = bodyStore.getBodyNum(firstObjPtr);
+    const size_t secondBodyNum = bodyStore.getBodyNum(secondObjPtr);
+
+    if (firstBodyNum == BodyStore::NO_BODY || secondBodyNum == BodyStore::NO_BODY)
+        throw std::logic_error("CollisionProcessor::findCollisionBetween: object is not in the body store");
+
+    bodyStore.updateGeometry(firstBodyNum);
+    bodyStore.updateGeometry(secondBodyNum);
+
+    const RectangleBatch firstRects  = bodyStore.getWorldRects(firstBodyNum);
+    const RectangleBatch secondRects = bodyStore.getWorldRects(secondBodyNum);
+    const Point firstSpeed  = firstObjPtr->getSpeed();
+    const Point secondSpeed = secondObjPtr->getSpeed();
+
+    const double ABSOLUTE_TIME_ERROR = getAbsoluteTimeError();
+    double minCollisionTime = 1;
+    bool isHorizontalCollision = false;
+
+    // rectangles of the second object are packed for the kernel by chunks
+    const size_t CHUNK_SIZE = 8;
+    double lefts[CHUNK_SIZE], tops[CHUNK_SIZE], widths[CHUNK_SIZE], heights[CHUNK_SIZE];
+    RectangleBatch batch;
+    batch._lefts   = lefts;
+    batch._tops    = tops;
+    batch._widths  = widths;
+    batch._heights = heights;
+
+    for (size_t firstRectNum = 0; firstRectNum < firstRects._count; ++firstRectNum)
+    {
+        Rectangle rect1 = firstRects.getRectangle(firstRectNum);
+        rect1.setPosition(rect1.getPosition() + firstShift);
+        batch._count = 0;
+
+        for (size_t secondRectNum = 0; secondRectNum < secondRects._count; ++secondRectNum)
+        {
+            Rectangle rect2 = secondRects.getRectangle(secondRectNum);
+            rect2.setPosition(rect2.getPosition() + secondShift);
+
+            lefts[batch._count]   = rect2.getLeft();
+            tops[batch._count]    = rect2.getTop();
+            widths[batch._count]  = rect2.getWidth();
+            heights[batch._count] = rect2.getHeight();
+
+            if (++batch._count == CHUNK_SIZE)
+            {
+                TimeOfImpactKernel::findEarliestHit(rect1, firstSpeed, batch, secondSpeed,
+                                                    frameTimeSec, ABSOLUTE_TIME_ERROR,
+                                                    minCollisionTime, isHorizontalCollision);
+                batch._count = 0;
+            }
+        }
+
+        if (batch._count != 0)
+            TimeOfImpactKernel::findEarliestHit(rect1, firstSpeed, batch, secondSpeed,
+                                                frameTimeSec, ABSOLUTE_TIME_ERROR,
+                                                minCollisionTime, isHorizontalCollision);
+    }
+
+    direction = getCollisionDirection(firstObjPtr->getPosition()  + firstShift,
+                                      secondObjPtr->getPosition() + secondShift,
+                                      isHorizontalCollision);
+    timeRate = minCollisionTime;
+    return minCollisionTime < 1;
+}
+
+
+bool CollisionProcessor::findCollisionBetween(const SweptBody &firstBody, const SweptBody &secondBody,
+                                              double frameTimeSec, double &timeRate, Direction &direction)
+{
+    double minCollisionTime = 1;
+    bool isHorizontalCollision = false;
+
+    for (size_t firstRectNum = 0; firstRectNum < firstBody._rects._count; ++firstRectNum)
+        TimeOfImpactKernel::findEarliestHit(firstBody._rects.getRectangle(firstRectNum), firstBody._speed,
+                                            secondBody._rects, secondBody._speed,
+                                            frameTimeSec, getAbsoluteTimeError(),
+                                            minCollisionTime, isHorizontalCollision);
+
+    direction = getCollisionDirection(firstBody._position, secondBody._position, isHorizontalCollision);
+    timeRate = minCollisionTime;
+    return minCollisionTime < 1;
+}
+
+
+Direction CollisionProcessor::getCollisionDirection(const Point &firstPosition, const Point &secondPosition,
+                                                    bool isHorizontalCollision)
+{
+    if (isHorizontalCollision)
+         return (firstPosition.getX() < secondPosition.getX()) ? Right : Left;
+    else return (firstPosition.getY() < secondPosition.getY()) ? Down : Up;
+}
+
+
+void CollisionProcessor::applyHitSpeeds(SimplePhysicalObjectPointer firstObjPtr,
+                                        SimplePhysicalObjectPointer secondObjPtr,
+                                        bool isHorizontalCollision) const
+{
+    const double speedRecoveryFactor = (   firstObjPtr->getHitRecoveryFactor()
+                                        + secondObjPtr->getHitRecoveryFactor()) / 2;
+
+    if (firstObjPtr->isMovable() && secondObjPtr->isMovable())
+    {
+        // hit between two objects
+        double firstObjectSpeed  = firstObjPtr->getSpeed().getProjection(isHorizontalCollision);
+        double secondObjectSpeed = secondObjPtr->getSpeed().getProjection(isHorizontalCollision);
+        double newFirstObjectSpeed  = 0;
+        double newSecondObjectSpeed = 0;
+
+        solveCentralHit(firstObjectSpeed, firstObjPtr->getMass(),
+                        secondObjectSpeed, secondObjPtr->getMass(),
+                        speedRecoveryFactor,
+                        newFirstObjectSpeed, newSecondObjectSpeed);
+
+        Point firstObjectSpeedVect = firstObjPtr->getSpeed();
+        firstObjectSpeedVect.setProjection(newFirstObjectSpeed, isHorizontalCollision);
+        firstObjPtr->setSpeed(firstObjectSpeedVect);
+
+        Point secondObjectSpeedVect = secondObjPtr->getSpeed();
+        secondObjectSpeedVect.setProjection(newSecondObjectSpeed, isHorizontalCollision);
+        secondObjPtr->setSpeed(secondObjectSpeedVect);
+    }
+    else if (firstObjPtr->isMovable() || secondObjPtr->isMovable())
+    {
+        // hit between object and platform
+        SimplePhysicalObjectPointer objectPtr   = ( firstObjPtr->isMovable() ? firstObjPtr : secondObjPtr);
+        SimplePhysicalObjectPointer platformPtr = (!firstObjPtr->isMovable() ? firstObjPtr : secondObjPtr);
+        double objectSpeed   = objectPtr->getSpeed().getProjection(isHorizontalCollision);
+        double platformSpeed = platformPtr->getSpeed().getProjection(isHorizontalCollision);
+        double newObjectSpeed   = 0;
+
+        solvePlatformHit(objectSpeed, platformSpeed, speedRecoveryFactor, newObjectSpeed);
+
+        Point objectSpeedVect = objectPtr->getSpeed();
+        objectSpeedVect.setProjection(newObjectSpeed, isHorizontalCollision);
+        objectPtr->setSpeed(objectSpeedVect);
+    }
+    else
+    {
+        // do nothing
+    }
+}
+
+
+void CollisionProcessor::applyContactSpeeds(SimplePhysicalObjectPointer firstObjPtr,
+                                            SimplePhysicalObjectPointer secondObjPtr,
+                                            bool isHorizontalCollision) const
+{
+    double firstObjectSpeed  = firstObjPtr->getSpeed().getProjection(isHorizontalCollision);
+    double secondObjectSpeed = secondObjPtr->getSpeed().getProjection(isHorizontalCollision);
+    double newSpeed = 0;
+
+    if (!firstObjPtr->isMovable())
+        newSpeed = firstObjectSpeed;
+    else if (!secondObjPtr->isMovable())
+        newSpeed = secondObjectSpeed;
+    else
+        newSpeed = 0;
+
+    Point firstObjectSpeedVect = firstObjPtr->getSpeed();
+    firstObjectSpeedVect.setProjection(newSpeed, isHorizontalCollision);
+    firstObjPtr->setSpeed(firstObjectSpeedVect);
+
+    Point secondObjectSpeedVect = secondObjPtr->getSpeed();
+    secondObjectSpeedVect.setProjection(newSpeed, isHorizontalCollision);
+    secondObjPtr->setSpeed(secondObjectSpeedVect);
+}
+
+
+void CollisionProcessor::solvePlatformHit(double objectSpeed, double platformSpeed,
+                                          double speedRecoveryFactor,
+                                          double &newObjectSpeed)
+{
+    newObjectSpeed = platformSpeed - speedRecoveryFactor * (objectSpeed - platformSpeed);
+}
+
+
+void CollisionProcessor::solveCentralHit(double firstObjectSpeed,     double firstObjectMass,
+                                         double secondObjectSpeed,    double secondObjectMass,
+                                         double speedRecoveryFactor,
+                                         double &newFirstObjectSpeed, double &newSecondObjectSpeed)
+{
+    double speedDifference = firstObjectSpeed - secondObjectSpeed;
+    newFirstObjectSpeed = (firstObjectMass  * firstObjectSpeed
+                           + secondObjectMass * secondObjectSpeed
+                           - secondObjectMass * speedRecoveryFactor * speedDifference)
+            / (firstObjectMass + secondObjectMass);
+
+    newSecondObjectSpeed = newFirstObjectSpeed + speedRecoveryFactor * speedDifference;
+}
+
+
+void CollisionProcessor::Impl::findContacts(BodyStore &bodyStore, const ContactCache &contactCache,
+                                            double frameTimeSec)
+{
+    // slow hits of resting objects don't bounce, like repeated contacts
+    // of the event processing
+    const double restingSpeed = 2 * std::abs(_enginePtr->getGravityAcceleration()) * frameTimeSec;
+
+    for (size_t cachedContactNum = 0; cachedContactNum < contactCache.getContactCount(); ++cachedContactNum)
+    {
+        const ContactCache::Contact &cachedContact = contactCache.getContact(cachedContactNum);
+
+        // sleeping objects aren't changed, they work as platforms
+        Contact contact;
+        contact._firstBodyNum  = bodyStore.getBodyNum(cachedContact._firstHandle);
+        contact._secondBodyNum = bodyStore.getBodyNum(cachedContact._secondHandle);
+        contact._direction = cachedContact._direction;
+        contact._impulse = cachedContact._impulse;
+
+        if (contact._firstBodyNum == BodyStore::NO_BODY || contact._secondBodyNum == BodyStore::NO_BODY)
+            continue;
+
+        if (bodyStore.isMovable(contact._firstBodyNum) && !bodyStore.isSleeping(contact._firstBodyNum))
+            contact._firstInverseMass = 1 / bodyStore.getMass(contact._firstBodyNum);
+
+        if (bodyStore.isMovable(contact._secondBodyNum) && !bodyStore.isSleeping(contact._secondBodyNum))
+            contact._secondInverseMass = 1 / bodyStore.getMass(contact._secondBodyNum);
+
+        if (contact._firstInverseMass == 0 && contact._secondInverseMass == 0)
+            continue;
+
+        // the objects could move apart since the contact was made
+        bodyStore.updateGeometry(contact._firstBodyNum);
+        bodyStore.updateGeometry(contact._secondBodyNum);
+
+        if (!isTouching(bodyStore.getBox(contact._firstBodyNum), bodyStore.getBox(contact._secondBodyNum),
+                        contact._direction))
+            continue;
+
+        // the bounce speed is fixed by the approach speed at the frame start
+        const bool isHorizontal = contact.isHorizontal();
+        const double approachSpeed = bodyStore.getSpeed(contact._firstBodyNum).getProjection(isHorizontal)
+                                   - bodyStore.getSpeed(contact._secondBodyNum).getProjection(isHorizontal);
+
+        if (approachSpeed > restingSpeed)
+            contact._targetSpeed = approachSpeed
+                    * (  bodyStore.getObjectPtr(contact._firstBodyNum)->getHitRecoveryFactor()
+                       + bodyStore.getObjectPtr(contact._secondBodyNum)->getHitRecoveryFactor()) / 2;
+
+        _contacts.push_back(contact);
+    }
+}
+
+
+void CollisionProcessor::Impl::warmStartContacts(BodyStore &bodyStore)
+{
+    // impulses accumulated by the last frames are applied at once
+    for (const Contact &contact : _contacts)
+        applyImpulse(bodyStore, contact, contact._impulse);
+}
+
+
+void CollisionProcessor::Impl::solveContact(BodyStore &bodyStore, Contact &contact)
+{
+    // the hit without recovery, that leaves the objects with the target
+    // speed of separation, gives the impulse of the iteration
+    const bool isHorizontal = contact.isHorizontal();
+    const double firstSpeed  = bodyStore.getSpeed(contact._firstBodyNum).getProjection(isHorizontal);
+    const double secondSpeed = bodyStore.getSpeed(contact._secondBodyNum).getProjection(isHorizontal);
+    double impulse = 0;
+
+    if (contact._firstInverseMass != 0 && contact._secondInverseMass != 0)
+    {
+        double newFirstSpeed = 0, newSecondSpeed = 0;
+        solveCentralHit(firstSpeed + contact._targetSpeed, 1 / contact._firstInverseMass,
+                        secondSpeed,                       1 / contact._secondInverseMass,
+                        0, newFirstSpeed, newSecondSpeed);
+        impulse = (firstSpeed - (newFirstSpeed - contact._targetSpeed)) / contact._firstInverseMass;
+    }
+    else if (contact._firstInverseMass != 0)
+    {
+        double newFirstSpeed = 0;
+        solvePlatformHit(firstSpeed + contact._targetSpeed, secondSpeed, 0, newFirstSpeed);
+        impulse = (firstSpeed - (newFirstSpeed - contact._targetSpeed)) / contact._firstInverseMass;
+    }
+    else
+    {
+        double newSecondSpeed = 0;
+        solvePlatformHit(secondSpeed - contact._targetSpeed, firstSpeed, 0, newSecondSpeed);
+        impulse = (newSecondSpeed + contact._targetSpeed - secondSpeed) / contact._secondInverseMass;
+    }
+
+    // the accumulated impulse only pushes the objects apart
+    const double accumulatedImpulse = std::max(0.0, contact._impulse + impulse);
+    applyImpulse(bodyStore, contact, accumulatedImpulse - contact._impulse);
+    contact._impulse = accumulatedImpulse;
+}
+
+
+void CollisionProcessor::Impl::applyImpulse(BodyStore &bodyStore, const Contact &contact, double impulse)
+{
+    const bool isHorizontal = contact.isHorizontal();
+
+    Point firstSpeed = bodyStore.getSpeed(contact._firstBodyNum);
+    firstSpeed.setProjection(firstSpeed.getProjection(isHorizontal) - impulse * contact._firstInverseMass,
+                             isHorizontal);
+    bodyStore.setSpeed(contact._firstBodyNum, firstSpeed.getX(), firstSpeed.getY());
+
+    Point secondSpeed = bodyStore.getSpeed(contact._secondBodyNum);
+    secondSpeed.setProjection(secondSpeed.getProjection(isHorizontal) + impulse * contact._secondInverseMass,
+                              isHorizontal);
+    bodyStore.setSpeed(contact._secondBodyNum, secondSpeed.getX(), secondSpeed.getY());
+}
+
+
+double CollisionProcessor::getAbsoluteTimeError()
+{
+    return 0.0001;
+}
+
 
 
 }  // namespace Platformer
@@ -6,6 +6,9 @@
 #include <memory>
 
 #include "Types.h"
+#include "geometry/Point.h"
+#include "geometry/Rectangle.h"
+#include "TimeOfImpactKernel.h"
 
 
 namespace Platformer
@@ -21,13 +24,88 @@ public:
 
     SimplePhysicalEnginePointer getEnginePtr() const;
 
+    // number of frames, that ran out of the engine collision budget
+    size_t getBudgetHitCount() const;
+
     void setEnginePtr(SimplePhysicalEnginePointer enginePtr);
     virtual void updateMetadata() = 0;
-    virtual void processFrame(double frameTimeSec) = 0;
+
+    // The body was appended to the store or removed from it, the last body
+    // took the number of the removed one. By default metadata are rebuilt.
+    virtual void addBody(size_t bodyNum);
+    virtual void removeBody(size_t bodyNum);
+
+    // The frame is processed by beginFrame() & one or more processSubStep()
+    // calls, whose times add up to the frame time. Resting contacts are
+    // solved, contiguous links are reset & the budget is started once per
+    // frame, so sub-steps of fast bodies keep the links of resting ones.
+    // By default beginFrame() does nothing.
+    virtual void beginFrame(double frameTimeSec);
+    virtual void processSubStep(double subStepTimeSec) = 0;
+
+    // the whole frame as one sub-step
+    void processFrame(double frameTimeSec);
 
 protected:
+    // rectangles in world coordinates and motion of one side of the pair test
+    struct SweptBody
+    {
+        RectangleBatch _rects;
+        Point _position;
+        Point _speed;
+    };
+
     CollisionProcessor(SimplePhysicalEnginePointer enginePtr);
 
+    // The budget is taken from the engine at the frame start & is shared by
+    // sub-steps. Every isBudgetSpent() call counts one iteration, the frame
+    // is counted as a hit once, it has to be finished approximately after it.
+    void startBudget();
+    bool isBudgetSpent();
+
+    // Contacts of the engine cache, that are still touching, are solved
+    // together by sequential impulses, if the engine contact iteration count
+    // isn't zero. Contiguous links are reset at the frame start, so
+    // linkContacts() restores the links of the solved contacts after it.
+    void solveContacts(double frameTimeSec);
+    void linkContacts();
+
+    // Finds the earliest hit of two objects of the engine body store moving
+    // with their speeds during frameTimeSec. Object positions are taken with
+    // the given shifts. The time rate of the hit is in
+    // [-getAbsoluteTimeError(), 1) range.
+    bool findCollisionBetween(SimplePhysicalObjectPointer firstObjPtr,  const Point &firstShift,
+                              SimplePhysicalObjectPointer secondObjPtr, const Point &secondShift,
+                              double frameTimeSec, double &timeRate, Direction &direction) const;
+
+    static bool findCollisionBetween(const SweptBody &firstBody, const SweptBody &secondBody,
+                                     double frameTimeSec, double &timeRate, Direction &direction);
+
+    // speed changes of a hit, the first object hits the second in the direction
+    void applyHitSpeeds(SimplePhysicalObjectPointer firstObjPtr,
+                        SimplePhysicalObjectPointer secondObjPtr,
+                        bool isHorizontalCollision) const;
+
+    // speed changes of a repeated hit between already contiguous objects
+    void applyContactSpeeds(SimplePhysicalObjectPointer firstObjPtr,
+                            SimplePhysicalObjectPointer secondObjPtr,
+                            bool isHorizontalCollision) const;
+
+    static void solvePlatformHit(double objectSpeed, double PlatformSpeed,
+                                 double speedRecoveryFactor,
+                                 double &newObjectSpeed);
+
+    static void solveCentralHit(double firstObjectSpeed,       double firstObjectMass,
+                                double secondObjectSpeed,      double secondObjectMass,
+                                double speedRecoveryFactor,
+                                double &newFirstObjectSpeed,   double &newSecondObjectSpeed);
+
+    static double getAbsoluteTimeError();
+
+private:
+    static Direction getCollisionDirection(const Point &firstPosition, const Point &secondPosition,
+                                           bool isHorizontalCollision);
+
 private:
     struct Impl;
     std::unique_ptr<Impl> _pimpl;
@@ -0,0 +1,214 @@
+// ContactCache.cpp
+
+#include <utility>
+#include <algorithm>
+
+#include "ContactCache.h"
+
+
+namespace Platformer
+{
+
+
+const size_t ContactCache::NO_CONTACT = static_cast<size_t>(-1);
+const size_t ContactCache::MIN_SLOT_COUNT = 64;
+
+
+ContactCache::ContactCache(const BodyStore &bodyStore)
+    : _bodyStorePtr(&bodyStore)
+{
+}
+
+
+ContactCache::~ContactCache()
+{
+}
+
+
+const ContactCache::Contact *ContactCache::findContact(size_t firstBodyNum, size_t secondBodyNum) const
+{
+    const BodyStore::Handle firstHandle  = _bodyStorePtr->getHandle(firstBodyNum);
+    const BodyStore::Handle secondHandle = _bodyStorePtr->getHandle(secondBodyNum);
+
+    if (_slots.empty())
+        return nullptr;
+
+    const Slot &slot = _slots[findSlot(getKey(firstHandle, secondHandle))];
+
+    if (slot._contactNum == NO_CONTACT)
+        return nullptr;
+
+    // the slots could be taken by other bodies since the contact was made
+    const Contact &contact = _contacts[slot._contactNum];
+
+    if (   (contact._firstHandle != firstHandle  || contact._secondHandle != secondHandle)
+        && (contact._firstHandle != secondHandle || contact._secondHandle != firstHandle))
+        return nullptr;
+
+    return &contact;
+}
+
+
+void ContactCache::beginFrame()
+{
+    ++_frameNum;
+}
+
+
+ContactCache::Contact &ContactCache::refreshContact(size_t firstBodyNum, size_t secondBodyNum, Direction direction)
+{
+    // contacts are kept in the down & right directions
+    if (direction == Up || direction == Left)
+    {
+        std::swap(firstBodyNum, secondBodyNum);
+        direction = getOppositeDirrection(direction);
+    }
+
+    const BodyStore::Handle firstHandle  = _bodyStorePtr->getHandle(firstBodyNum);
+    const BodyStore::Handle secondHandle = _bodyStorePtr->getHandle(secondBodyNum);
+    const uint64_t key = getKey(firstHandle, secondHandle);
+
+    // the table is grown before the lookup, so the found slot stays valid
+    if (2 * (_contacts.size() + 1) > _slots.size())
+        rehash(std::max(MIN_SLOT_COUNT, 2 * _slots.size()));
+
+    const size_t slotNum = findSlot(key);
+    const bool isNew = _slots[slotNum]._contactNum == NO_CONTACT;
+
+    if (isNew)
+    {
+        _slots[slotNum]._key = key;
+        _slots[slotNum]._contactNum = _contacts.size();
+        _contacts.push_back(Contact());
+    }
+
+    Contact &contact = _contacts[_slots[slotNum]._contactNum];
+
+    // a new contact or the contact of other bodies or sides starts again
+    if (   isNew || contact._firstHandle != firstHandle || contact._secondHandle != secondHandle
+        || contact._direction != direction || contact._frameNum + 1 < _frameNum)
+    {
+        contact = Contact();
+        contact._firstHandle = firstHandle;
+        contact._secondHandle = secondHandle;
+        contact._direction = direction;
+    }
+    else if (contact._frameNum + 1 == _frameNum)
+    {
+        ++contact._age;
+    }
+
+    contact._frameNum = _frameNum;
+    return contact;
+}
+
+
+void ContactCache::removeStaleContacts()
+{
+    for (size_t contactNum = 0; contactNum < _contacts.size(); )
+    {
+        const Contact &contact = _contacts[contactNum];
+        const size_t firstBodyNum  = _bodyStorePtr->getBodyNum(contact._firstHandle);
+        const size_t secondBodyNum = _bodyStorePtr->getBodyNum(contact._secondHandle);
+
+        // sleeping bodies aren't processed, they keep their contacts
+        const bool isStale
+                =  firstBodyNum == BodyStore::NO_BODY || secondBodyNum == BodyStore::NO_BODY
+                || (   contact._frameNum != _frameNum
+                    && !_bodyStorePtr->isSleeping(firstBodyNum) && !_bodyStorePtr->isSleeping(secondBodyNum));
+
+        if (isStale)
+            removeContact(contactNum);
+        else
+            ++contactNum;
+    }
+}
+
+
+void ContactCache::clear()
+{
+    _contacts.clear();
+    std::fill(_slots.begin(), _slots.end(), Slot());
+}
+
+
+uint64_t ContactCache::getKey(BodyStore::Handle firstHandle, BodyStore::Handle secondHandle) const
+{
+    const uint32_t lessSlotNum    = std::min(firstHandle._slotNum, secondHandle._slotNum);
+    const uint32_t greaterSlotNum = std::max(firstHandle._slotNum, secondHandle._slotNum);
+
+    return (static_cast<uint64_t>(lessSlotNum) << 32) | greaterSlotNum;
+}
+
+
+void ContactCache::removeContact(size_t num)
+{
+    // the last contact takes the number of the removed one
+    eraseSlot(findSlot(getKey(_contacts[num]._firstHandle, _contacts[num]._secondHandle)));
+
+    if (num + 1 != _contacts.size())
+    {
+        _contacts[num] = _contacts.back();
+        _slots[findSlot(getKey(_contacts[num]._firstHandle, _contacts[num]._secondHandle))]._contactNum = num;
+    }
+
+    _contacts.pop_back();
+}
+
+
+size_t ContactCache::findSlot(uint64_t key) const
+{
+    // the table is never full, so there is an empty slot on the way
+    const size_t slotMask = _slots.size() - 1;
+    size_t slotNum = getHomeSlotNum(key);
+
+    while (_slots[slotNum]._contactNum != NO_CONTACT && _slots[slotNum]._key != key)
+        slotNum = (slotNum + 1) & slotMask;
+
+    return slotNum;
+}
+
+
+size_t ContactCache::getHomeSlotNum(uint64_t key) const
+{
+    // multiplicative hashing spreads neighbor slot numbers of the handles
+    return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & (_slots.size() - 1);
+}
+
+
+void ContactCache::eraseSlot(size_t slotNum)
+{
+    // following slots of the probe sequence are shifted back, so lookups
+    // don't stop at the hole
+    const size_t slotMask = _slots.size() - 1;
+
+    for (size_t nextSlotNum = (slotNum + 1) & slotMask;
+         _slots[nextSlotNum]._contactNum != NO_CONTACT;
+         nextSlotNum = (nextSlotNum + 1) & slotMask)
+    {
+        // the slot can be moved back, if its home isn't between the hole & it
+        const size_t homeSlotNum = getHomeSlotNum(_slots[nextSlotNum]._key);
+
+        if (((nextSlotNum - homeSlotNum) & slotMask) >= ((nextSlotNum - slotNum) & slotMask))
+        {
+            _slots[slotNum] = _slots[nextSlotNum];
+            slotNum = nextSlotNum;
+        }
+    }
+
+    _slots[slotNum] = Slot();
+}
+
+
+void ContactCache::rehash(size_t slotCount)
+{
+    std::vector<Slot> slots(slotCount);
+    _slots.swap(slots);
+
+    for (const Slot &slot : slots)
+        if (slot._contactNum != NO_CONTACT)
+            _slots[findSlot(slot._key)] = slot;
+}
+
+
+}  // namespace Platformer
@@ -0,0 +1,93 @@
+// ContactCache.h
+
+#ifndef CONTACTCACHE_H
+#define CONTACTCACHE_H
+
+#include <vector>
+#include <cstdint>
+
+#include "Types.h"
+#include "geometry/Point.h"
+#include "BodyStore.h"
+
+
+namespace Platformer
+{
+
+
+// Contacts of body pairs kept across frames, keyed by the pair of body
+// handles. Collision processors refresh the contacts they find during the
+// frame, removeStaleContacts() at the frame end drops the ones, that
+// weren't refreshed, except contacts of sleeping bodies.
+class ContactCache
+{
+public:
+    // the second body lies down or right from the first one, the impulse
+    // is accumulated by the contact solver
+    struct Contact
+    {
+        BodyStore::Handle _firstHandle;
+        BodyStore::Handle _secondHandle;
+        Direction _direction = Down;
+        double _impulse = 0;
+
+        // number of consecutive frames the contact was refreshed in
+        size_t _age = 0;
+        uint64_t _frameNum = 0;
+    };
+
+    ContactCache(const BodyStore &bodyStore);
+    ~ContactCache();
+
+    // the cache keeps a reference to the store, so it can't be copied
+    ContactCache(const ContactCache&) = delete;
+    ContactCache& operator=(const ContactCache&) = delete;
+
+    inline size_t getContactCount() const                 { return _contacts.size(); }
+    inline Contact &getContact(size_t num)                { return _contacts[num]; }
+    inline const Contact &getContact(size_t num) const    { return _contacts[num]; }
+
+    // contact of the bodies in any order or nullptr
+    const Contact *findContact(size_t firstBodyNum, size_t secondBodyNum) const;
+
+    void beginFrame();
+    Contact &refreshContact(size_t firstBodyNum, size_t secondBodyNum, Direction direction);
+    void removeStaleContacts();
+    void clear();
+
+private:
+    // slot of the contact number table, the key is made by getKey()
+    struct Slot
+    {
+        uint64_t _key = 0;
+        size_t _contactNum = NO_CONTACT;
+    };
+
+    uint64_t getKey(BodyStore::Handle firstHandle, BodyStore::Handle secondHandle) const;
+    void removeContact(size_t num);
+
+    // the slot of the key or the empty slot, where the key has to be put
+    size_t findSlot(uint64_t key) const;
+    size_t getHomeSlotNum(uint64_t key) const;
+    void eraseSlot(size_t slotNum);
+    void rehash(size_t slotCount);
+
+private:
+    const BodyStore *_bodyStorePtr;
+    std::vector<Contact> _contacts;
+    uint64_t _frameNum = 0;
+
+    // Contact numbers by keys in an open addressing table with linear
+    // probing. It's at most half full & only grows, so contacts made &
+    // removed every frame don't allocate once their number settles.
+    std::vector<Slot> _slots;
+
+    // constants
+    static const size_t NO_CONTACT;
+    static const size_t MIN_SLOT_COUNT;
+};
+
+
+}  // namespace Platformer
+
+#endif  // CONTACTCACHE_H
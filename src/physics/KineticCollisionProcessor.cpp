@@ -0,0 +1,632 @@
+// KineticCollisionProcessor.cpp
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+#include "Iterator.h"
+#include "geometry/BoundingBox.h"
+#include "PhysicalObject.h"
+#include "PhysicalWorld.h"
+#include "PhysicalEngine.h"
+#include "BodyStore.h"
+#include "ContactCache.h"
+#include "PhysicsProfiler.h"
+#include "KineticCollisionProcessor.h"
+
+
+namespace Platformer
+{
+
+
+struct KineticCollisionProcessor::Impl
+{
+    struct ObjectMetadata
+    {
+        ObjectMetadata(SimplePhysicalObjectPointer objectPtr)
+            : _objectPtr(objectPtr)
+        {
+        }
+
+        SimplePhysicalObjectPointer _objectPtr = nullptr;
+        size_t _lastConnectionNum = 0;
+
+        // moment of the frame the object position belongs to
+        double _timeSec = 0;
+
+        // incremented on each speed change, makes predictions of the object stale
+        size_t _version = 0;
+
+        // cells of the swept box of the object motion till the end of the frame
+        long _firstCellX = 0, _lastCellX = -1;
+        long _firstCellY = 0, _lastCellY = -1;
+        bool _isLarge = false;
+        size_t _queryStamp = 0;
+    };
+
+    // entry of the object list of a grid bucket
+    struct CellEntry
+    {
+        size_t _objectNum = 0;
+        size_t _nextEntryNum = 0;
+    };
+
+    struct PredictedCollision
+    {
+        double _timeSec = 0;
+        size_t _lessObjectNum = 0;
+        size_t _greaterObectNum = 0;
+        size_t _lessVersion = 0;
+        size_t _greaterVersion = 0;
+        Direction _direction = Right;
+
+        bool operator>(const PredictedCollision &other) const
+        {
+            if (_timeSec != other._timeSec)
+                return _timeSec > other._timeSec;
+
+            if (_lessObjectNum != other._lessObjectNum)
+                return _lessObjectNum > other._lessObjectNum;
+
+            return _greaterObectNum > other._greaterObectNum;
+        }
+    };
+
+    // processing steps
+    void doPreProcess();
+    void startSubStep(double frameTimeSec);
+    void processCollisions();
+    void doPostProcess();
+
+    // procedures
+    void processCollision(const PredictedCollision &collision);
+    void predictCollisions(size_t objectNum, size_t skippedObjectNum, bool isGreaterOnly);
+    void moveObject(size_t objectNum, double timeSec);
+    void updateSweptBox(size_t objectNum);
+    void insertToGrid(size_t objectNum);
+    void removeFromGrid(size_t objectNum);
+    void resetGrid();
+
+    // functions
+    // predictions made before the last speed change of any object are stale
+    inline bool isActual(const PredictedCollision &collision) const
+    {
+        return collision._lessVersion    == _objectVect[collision._lessObjectNum]._version
+            && collision._greaterVersion == _objectVect[collision._greaterObectNum]._version;
+    }
+
+    inline Point getShift(size_t objectNum, double timeSec) const
+    {
+        return _bodyStorePtr->getSpeed(objectNum) * (timeSec - _objectVect[objectNum]._timeSec);
+    }
+
+    inline long getCellNum(double coordinate) const
+    {
+        return static_cast<long>(std::floor(coordinate / _cellSize));
+    }
+
+    // cells of the unbounded grid share the buckets by a hash of their numbers,
+    // the bucket keeps the number of its first entry
+    inline size_t &getCellHead(long cellX, long cellY)
+    {
+        const uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(cellX)) << 32)
+                           | static_cast<uint32_t>(cellY);
+
+        return _cellHeads[static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & (_cellHeads.size() - 1)];
+    }
+
+    // data members
+    KineticCollisionProcessor *_processorPtr = nullptr;
+    BodyStore *_bodyStorePtr = nullptr;
+    ContactCache *_contactCachePtr = nullptr;
+    PhysicsProfiler *_profilerPtr = nullptr;
+
+    // object numbers are the same as body numbers in the store
+    std::vector<ObjectMetadata> _objectVect;
+    size_t _totalConnectionCount = 0;
+
+    // time of the sub-step, objects are moved to the stop moment at its end
+    double _frameTimeSec = 0;
+    double _currentTimeSec = 0;
+    double _stopTimeSec = 0;
+
+    // min-heap of predicted collisions
+    std::vector<PredictedCollision> _eventQueue;
+
+    // Uniform grid of swept boxes hashed into buckets. Buckets are lists of
+    // entries of one buffer, removed entries are reused, so objects moving
+    // to new cells don't allocate. The bucket number depends on the object
+    // count only. Objects of other cells in the bucket are dropped by the
+    // swept box test.
+    double _cellSize = 64;
+    std::vector<size_t> _cellHeads;
+    std::vector<CellEntry> _cellEntries;
+    size_t _freeEntryNum = NO_ENTRY;
+    std::vector<size_t> _largeObjectNums;
+    size_t _queryStamp = 0;
+
+    // constants
+    const double ABSOLUTE_TIME_ERROR  = CollisionProcessor::getAbsoluteTimeError();
+    const double DOUBLE_COMPARE_ERROR = 0.0001;
+    const long MAX_OBJECT_CELL_COUNT  = 256;
+    const size_t MIN_BUCKET_COUNT     = 64;
+    const size_t OBJECT_BUCKET_COUNT  = 4;
+    static const size_t NO_ENTRY      = static_cast<size_t>(-1);
+};
+
+
+const size_t KineticCollisionProcessor::Impl::NO_ENTRY;
+
+
+
+KineticCollisionProcessor::KineticCollisionProcessor(SimplePhysicalEnginePointer enginePtr)
+    : CollisionProcessor(enginePtr)
+    , _pimpl(new Impl())
+{
+    _pimpl->_processorPtr = this;
+}
+
+KineticCollisionProcessor::KineticCollisionProcessor(KineticCollisionProcessor&& /*other*/) = default;
+KineticCollisionProcessor& KineticCollisionProcessor::operator=(KineticCollisionProcessor&& /*other*/) = default;
+KineticCollisionProcessor::~KineticCollisionProcessor() = default;
+
+
+double KineticCollisionProcessor::getCellSize() const
+{
+    return _pimpl->_cellSize;
+}
+
+
+void KineticCollisionProcessor::setCellSize(double cellSize)
+{
+    if (!(cellSize > 0))
+        throw std::logic_error("KineticCollisionProcessor::setCellSize: cell size must be positive");
+
+    _pimpl->_cellSize = cellSize;
+    _pimpl->resetGrid();
+}
+
+
+void KineticCollisionProcessor::updateMetadata()
+{
+    if (getEnginePtr()->getWorldPtr() == nullptr)
+        throw std::logic_error("KineticCollisionProcessor::updateMetadata: world is not set");
+
+    _pimpl->_bodyStorePtr = &getEnginePtr()->getBodyStore();
+    _pimpl->_contactCachePtr = &getEnginePtr()->getContactCache();
+    _pimpl->_objectVect.clear();
+
+    for (size_t bodyNum = 0; bodyNum < _pimpl->_bodyStorePtr->getBodyCount(); ++bodyNum)
+        _pimpl->_objectVect.emplace_back(_pimpl->_bodyStorePtr->getObjectPtr(bodyNum));
+}
+
+
+void KineticCollisionProcessor::addBody(size_t bodyNum)
+{
+    _pimpl->_bodyStorePtr = &getEnginePtr()->getBodyStore();
+    _pimpl->_contactCachePtr = &getEnginePtr()->getContactCache();
+
+    if (bodyNum != _pimpl->_objectVect.size())
+        throw std::logic_error("KineticCollisionProcessor::addBody: wrong body number");
+
+    _pimpl->_objectVect.emplace_back(_pimpl->_bodyStorePtr->getObjectPtr(bodyNum));
+}
+
+
+void KineticCollisionProcessor::removeBody(size_t bodyNum)
+{
+    if (bodyNum >= _pimpl->_objectVect.size())
+        throw std::logic_error("KineticCollisionProcessor::removeBody: wrong body number");
+
+    // grid and predictions are rebuilt every frame
+    _pimpl->_objectVect[bodyNum] = _pimpl->_objectVect.back();
+    _pimpl->_objectVect.pop_back();
+}
+
+
+void KineticCollisionProcessor::beginFrame(double frameTimeSec)
+{
+    _pimpl->_profilerPtr = &getEnginePtr()->getProfiler();
+
+    PhysicsProfiler::PhaseTimer timer(*_pimpl->_profilerPtr, PhysicsProfiler::ResolutionPhase);
+
+    // resting contacts of the last frame are solved together
+    solveContacts(frameTimeSec);
+
+    // reset object links, the solved contacts are linked again
+    timer.switchPhase(PhysicsProfiler::PreProcessPhase);
+    _pimpl->doPreProcess();
+    linkContacts();
+    startBudget();
+}
+
+
+void KineticCollisionProcessor::processSubStep(double subStepTimeSec)
+{
+    {
+        // predict collisions of the whole sub-step
+        PhysicsProfiler::PhaseTimer timer(*_pimpl->_profilerPtr, PhysicsProfiler::PreProcessPhase);
+        _pimpl->startSubStep(subStepTimeSec);
+        timer.switchPhase(PhysicsProfiler::NarrowPhase);
+
+        for (size_t objectNum = 0; objectNum < _pimpl->_objectVect.size(); ++objectNum)
+            _pimpl->predictCollisions(objectNum, objectNum, true);
+    }
+
+    // process predicted collisions in time order
+    _pimpl->processCollisions();
+
+    // move all objects to the end of the sub-step or to the budget stop moment
+    PhysicsProfiler::PhaseTimer timer(*_pimpl->_profilerPtr, PhysicsProfiler::PostProcessPhase);
+    _pimpl->doPostProcess();
+}
+
+
+void KineticCollisionProcessor::Impl::doPreProcess()
+{
+    _totalConnectionCount = 0;
+
+    for (size_t objectNum = 0; objectNum < _objectVect.size(); ++objectNum)
+    {
+        ObjectMetadata &metadata = _objectVect[objectNum];
+
+        // sleeping objects keep their island links
+        if (!_bodyStorePtr->isSleeping(objectNum))
+            metadata._objectPtr->resetContiguousObjects();
+
+        metadata._lastConnectionNum = 0;
+    }
+}
+
+
+void KineticCollisionProcessor::Impl::startSubStep(double frameTimeSec)
+{
+    _frameTimeSec = frameTimeSec;
+    _currentTimeSec = 0;
+    _stopTimeSec = frameTimeSec;
+    _eventQueue.clear();
+    resetGrid();
+
+    for (size_t objectNum = 0; objectNum < _objectVect.size(); ++objectNum)
+    {
+        ObjectMetadata &metadata = _objectVect[objectNum];
+
+        metadata._timeSec = 0;
+        metadata._version = 0;
+
+        updateSweptBox(objectNum);
+        insertToGrid(objectNum);
+    }
+}
+
+
+void KineticCollisionProcessor::Impl::processCollisions()
+{
+    PhysicsProfiler::PhaseTimer timer(*_profilerPtr, PhysicsProfiler::ResolutionPhase);
+
+    while (!_eventQueue.empty())
+    {
+        timer.switchPhase(PhysicsProfiler::ResolutionPhase);
+        std::pop_heap(_eventQueue.begin(), _eventQueue.end(), std::greater<PredictedCollision>());
+        PredictedCollision collision = _eventQueue.back();
+        _eventQueue.pop_back();
+        _profilerPtr->addCount(PhysicsProfiler::IterationCounter, 1);
+
+        if (!isActual(collision))
+            continue;
+
+        // objects are stopped before the first unprocessed hit, the rest
+        // of the frame is lost
+        if (_processorPtr->isBudgetSpent())
+        {
+            _stopTimeSec = std::min(_frameTimeSec, std::max(_currentTimeSec, collision._timeSec));
+            _eventQueue.push_back(collision);
+            break;
+        }
+
+        _currentTimeSec = std::max(_currentTimeSec, collision._timeSec);
+        processCollision(collision);
+        _profilerPtr->addCount(PhysicsProfiler::CollisionCounter, 1);
+
+        // predict new collisions of the hit objects only
+        timer.switchPhase(PhysicsProfiler::PairSearchPhase);
+
+        for (size_t objectNum : {collision._lessObjectNum, collision._greaterObectNum})
+        {
+            removeFromGrid(objectNum);
+            updateSweptBox(objectNum);
+            insertToGrid(objectNum);
+        }
+
+        timer.switchPhase(PhysicsProfiler::NarrowPhase);
+        predictCollisions(collision._lessObjectNum,    collision._lessObjectNum,   false);
+        predictCollisions(collision._greaterObectNum,  collision._lessObjectNum,   false);
+    }
+}
+
+
+void KineticCollisionProcessor::Impl::doPostProcess()
+{
+    for (size_t objectNum = 0; objectNum < _objectVect.size(); ++objectNum)
+        moveObject(objectNum, _stopTimeSec);
+
+    // the queue is left by the budget only, movable objects of unprocessed
+    // hits lose their speeds along the hit normal, so the speeds don't grow
+    // from frame to frame, sliding along the hit surface is kept
+    for (const PredictedCollision &collision : _eventQueue)
+    {
+        if (!isActual(collision))
+            continue;
+
+        const bool isHorizontalCollision = collision._direction == Right || collision._direction == Left;
+
+        for (size_t objectNum : {collision._lessObjectNum, collision._greaterObectNum})
+            if (_bodyStorePtr->isMovable(objectNum))
+                _bodyStorePtr->setSpeed(objectNum,
+                                        isHorizontalCollision ? 0 : _bodyStorePtr->getSpeedX(objectNum),
+                                        isHorizontalCollision ? _bodyStorePtr->getSpeedY(objectNum) : 0);
+    }
+}
+
+
+void KineticCollisionProcessor::Impl::processCollision(const PredictedCollision &collision)
+{
+    ObjectMetadata *firstMetadataPtr  = &_objectVect[collision._lessObjectNum];
+    ObjectMetadata *secondMetadataPtr = &_objectVect[collision._greaterObectNum];
+    SimplePhysicalObjectPointer firstObjPtr  = firstMetadataPtr->_objectPtr;
+    SimplePhysicalObjectPointer secondObjPtr = secondMetadataPtr->_objectPtr;
+    const bool isHorizontalCollision = collision._direction == Right || collision._direction == Left;
+
+    // move objects to collision point
+    moveObject(collision._lessObjectNum,   collision._timeSec);
+    moveObject(collision._greaterObectNum, collision._timeSec);
+
+    // set contiguous objects
+    SimplePhysicalObjectPointer lastNeighborPtr = firstObjPtr->getContiguousObject(collision._direction);
+    firstObjPtr->setContiguousObject(collision._direction, secondObjPtr);
+    secondObjPtr->setContiguousObject(getOppositeDirrection(collision._direction), firstObjPtr);
+    _contactCachePtr->refreshContact(collision._lessObjectNum, collision._greaterObectNum, collision._direction);
+
+    // set connection number
+    if (lastNeighborPtr != secondObjPtr)
+    {
+        _totalConnectionCount++;
+        firstMetadataPtr->_lastConnectionNum = _totalConnectionCount;
+    }
+
+    bool hasSameConnectionNum = firstMetadataPtr->_lastConnectionNum
+                            == secondMetadataPtr->_lastConnectionNum;
+    size_t maxConnectionNum = std::max(firstMetadataPtr->_lastConnectionNum,
+                                       secondMetadataPtr->_lastConnectionNum);
+    firstMetadataPtr->_lastConnectionNum  = maxConnectionNum;
+    secondMetadataPtr->_lastConnectionNum = maxConnectionNum;
+
+    // calculate new speeds
+    if (hasSameConnectionNum)
+        _processorPtr->applyContactSpeeds(firstObjPtr, secondObjPtr, isHorizontalCollision);
+    else
+        _processorPtr->applyHitSpeeds(firstObjPtr, secondObjPtr, isHorizontalCollision);
+
+    firstMetadataPtr->_version++;
+    secondMetadataPtr->_version++;
+}
+
+
+void KineticCollisionProcessor::Impl::predictCollisions(size_t objectNum, size_t skippedObjectNum,
+                                                        bool isGreaterOnly)
+{
+    ObjectMetadata &metadata = _objectVect[objectNum];
+    const double restFrameTimeSec = _frameTimeSec - _currentTimeSec;
+
+    const BoundingBox &sweptBox = _bodyStorePtr->getSweptBox(objectNum);
+
+    if (sweptBox.isEmpty())
+        return;
+
+    auto predict = [&](size_t otherObjectNum)
+    {
+        ObjectMetadata &otherMetadata = _objectVect[otherObjectNum];
+
+        if (otherMetadata._queryStamp == _queryStamp)
+            return;
+
+        otherMetadata._queryStamp = _queryStamp;
+
+        if (   otherObjectNum == objectNum || otherObjectNum == skippedObjectNum
+            || (isGreaterOnly && otherObjectNum < objectNum)
+            || !sweptBox.isCollided(_bodyStorePtr->getSweptBox(otherObjectNum))
+            || (!_bodyStorePtr->isActive(objectNum) && !_bodyStorePtr->isActive(otherObjectNum)))
+            return;
+
+        ObjectMetadata &lessMetadata    = (objectNum < otherObjectNum ? metadata : otherMetadata);
+        ObjectMetadata &greaterMetadata = (objectNum < otherObjectNum ? otherMetadata : metadata);
+        double timeRate = 1;
+        PredictedCollision collision;
+
+        const bool hasCollision = _processorPtr->findCollisionBetween(
+                    lessMetadata._objectPtr,    getShift(std::min(objectNum, otherObjectNum), _currentTimeSec),
+                    greaterMetadata._objectPtr, getShift(std::max(objectNum, otherObjectNum), _currentTimeSec),
+                    restFrameTimeSec, timeRate, collision._direction);
+
+        // world rectangles of the pair are updated by the test
+        if (_profilerPtr->isEnabled())
+        {
+            _profilerPtr->addCount(PhysicsProfiler::PairTestCounter, 1);
+            _profilerPtr->addCount(PhysicsProfiler::RectangleTestCounter,
+                                   _bodyStorePtr->getWorldRects(objectNum)._count
+                                   * _bodyStorePtr->getWorldRects(otherObjectNum)._count);
+        }
+
+        if (!hasCollision)
+            return;
+
+        collision._timeSec = _currentTimeSec + restFrameTimeSec * timeRate;
+        collision._lessObjectNum   = std::min(objectNum, otherObjectNum);
+        collision._greaterObectNum = std::max(objectNum, otherObjectNum);
+        collision._lessVersion     = lessMetadata._version;
+        collision._greaterVersion  = greaterMetadata._version;
+
+        _eventQueue.push_back(collision);
+        std::push_heap(_eventQueue.begin(), _eventQueue.end(), std::greater<PredictedCollision>());
+    };
+
+    ++_queryStamp;
+
+    if (metadata._isLarge)
+    {
+        for (size_t otherObjectNum = 0; otherObjectNum < _objectVect.size(); ++otherObjectNum)
+            predict(otherObjectNum);
+
+        return;
+    }
+
+    for (long cellX = metadata._firstCellX; cellX <= metadata._lastCellX; ++cellX)
+        for (long cellY = metadata._firstCellY; cellY <= metadata._lastCellY; ++cellY)
+        {
+            for (size_t entryNum = getCellHead(cellX, cellY); entryNum != NO_ENTRY; )
+            {
+                // the list isn't changed by predictions
+                const CellEntry &entry = _cellEntries[entryNum];
+                entryNum = entry._nextEntryNum;
+                predict(entry._objectNum);
+            }
+        }
+
+    for (size_t otherObjectNum : _largeObjectNums)
+        predict(otherObjectNum);
+}
+
+
+void KineticCollisionProcessor::Impl::moveObject(size_t objectNum, double timeSec)
+{
+    ObjectMetadata &metadata = _objectVect[objectNum];
+
+    if (metadata._timeSec == timeSec)
+        return;
+
+    Point shift = getShift(objectNum, timeSec);
+
+    _bodyStorePtr->setPosition(objectNum,
+                               _bodyStorePtr->getX(objectNum) + shift.getX(),
+                               _bodyStorePtr->getY(objectNum) + shift.getY());
+    metadata._timeSec = timeSec;
+}
+
+
+void KineticCollisionProcessor::Impl::updateSweptBox(size_t objectNum)
+{
+    // sweep the box till the end of the frame including the time error,
+    // that CollisionProcessor::findCollisionBetween accepts
+    _bodyStorePtr->updateSweptBox(objectNum, getShift(objectNum, _frameTimeSec),
+                                  ABSOLUTE_TIME_ERROR, DOUBLE_COMPARE_ERROR);
+}
+
+
+void KineticCollisionProcessor::Impl::insertToGrid(size_t objectNum)
+{
+    ObjectMetadata &metadata = _objectVect[objectNum];
+    const BoundingBox &box = _bodyStorePtr->getSweptBox(objectNum);
+
+    metadata._firstCellX = 0;
+    metadata._lastCellX  = -1;
+    metadata._firstCellY = 0;
+    metadata._lastCellY  = -1;
+    metadata._isLarge    = false;
+
+    if (box.isEmpty())
+        return;
+
+    long firstCellX = getCellNum(box.getLeft());
+    long lastCellX  = getCellNum(box.getRight());
+    long firstCellY = getCellNum(box.getTop());
+    long lastCellY  = getCellNum(box.getBottom());
+
+    if ((lastCellX - firstCellX + 1) * (lastCellY - firstCellY + 1) > MAX_OBJECT_CELL_COUNT)
+    {
+        metadata._isLarge = true;
+        _largeObjectNums.push_back(objectNum);
+        return;
+    }
+
+    metadata._firstCellX = firstCellX;
+    metadata._lastCellX  = lastCellX;
+    metadata._firstCellY = firstCellY;
+    metadata._lastCellY  = lastCellY;
+
+    for (long cellX = firstCellX; cellX <= lastCellX; ++cellX)
+        for (long cellY = firstCellY; cellY <= lastCellY; ++cellY)
+        {
+            size_t &headEntryNum = getCellHead(cellX, cellY);
+            size_t entryNum = _freeEntryNum;
+
+            if (entryNum != NO_ENTRY)
+            {
+                _freeEntryNum = _cellEntries[entryNum]._nextEntryNum;
+            }
+            else
+            {
+                entryNum = _cellEntries.size();
+                _cellEntries.emplace_back();
+            }
+
+            _cellEntries[entryNum]._objectNum = objectNum;
+            _cellEntries[entryNum]._nextEntryNum = headEntryNum;
+            headEntryNum = entryNum;
+        }
+}
+
+
+void KineticCollisionProcessor::Impl::removeFromGrid(size_t objectNum)
+{
+    ObjectMetadata &metadata = _objectVect[objectNum];
+
+    if (metadata._isLarge)
+    {
+        _largeObjectNums.erase(std::find(_largeObjectNums.begin(), _largeObjectNums.end(), objectNum));
+        metadata._isLarge = false;
+        return;
+    }
+
+    for (long cellX = metadata._firstCellX; cellX <= metadata._lastCellX; ++cellX)
+        for (long cellY = metadata._firstCellY; cellY <= metadata._lastCellY; ++cellY)
+        {
+            // the entry is moved to the free list
+            for (size_t *entryNumPtr = &getCellHead(cellX, cellY); *entryNumPtr != NO_ENTRY;
+                 entryNumPtr = &_cellEntries[*entryNumPtr]._nextEntryNum)
+            {
+                const size_t entryNum = *entryNumPtr;
+
+                if (_cellEntries[entryNum]._objectNum == objectNum)
+                {
+                    *entryNumPtr = _cellEntries[entryNum]._nextEntryNum;
+                    _cellEntries[entryNum]._nextEntryNum = _freeEntryNum;
+                    _freeEntryNum = entryNum;
+                    break;
+                }
+            }
+        }
+
+    metadata._lastCellX = metadata._firstCellX - 1;
+}
+
+
+void KineticCollisionProcessor::Impl::resetGrid()
+{
+    _largeObjectNums.clear();
+
+    // a power of two of buckets, a few per object
+    size_t bucketCount = MIN_BUCKET_COUNT;
+
+    while (bucketCount < OBJECT_BUCKET_COUNT * _objectVect.size())
+        bucketCount *= 2;
+
+    _cellHeads.assign(bucketCount, NO_ENTRY);
+    _cellEntries.clear();
+    _freeEntryNum = NO_ENTRY;
+}
+
+
+
+}  // namespace Platformer
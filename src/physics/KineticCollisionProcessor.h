@@ -0,0 +1,45 @@
+// KineticCollisionProcessor.h
+
+#ifndef KINETICCOLLISIONPROCESSOR_H
+#define KINETICCOLLISIONPROCESSOR_H
+
+#include <memory>
+
+#include "Types.h"
+#include "CollisionProcessor.h"
+
+
+namespace Platformer
+{
+
+
+// Event driven alternative of StrictCollisionProcessor. Predicted collisions
+// of object pairs are kept in a queue ordered by time; after a collision only
+// the pairs of the two hit objects are predicted again, and other objects
+// aren't moved until the end of the frame.
+class KineticCollisionProcessor : public CollisionProcessor
+{
+public:
+    KineticCollisionProcessor(SimplePhysicalEnginePointer enginePtr = nullptr);
+    KineticCollisionProcessor(KineticCollisionProcessor&& other);
+    virtual KineticCollisionProcessor& operator=(KineticCollisionProcessor&& other);
+    virtual ~KineticCollisionProcessor();
+
+    double getCellSize() const;
+
+    void setCellSize(double cellSize);
+    virtual void updateMetadata() override;
+    virtual void addBody(size_t bodyNum) override;
+    virtual void removeBody(size_t bodyNum) override;
+    virtual void beginFrame(double frameTimeSec) override;
+    virtual void processSubStep(double subStepTimeSec) override;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> _pimpl;
+};
+
+
+}  // namespace Platformer
+
+#endif  // KINETICCOLLISIONPROCESSOR_H
@@ -13,9 +13,6 @@ struct MapPlatform::Impl
     Impl()
     {
     }
-
-    Rectangle _rect;
-    RectangleIteratorPtr _rectIterPtr;
 };
 
 
@@ -25,8 +22,7 @@ MapPlatform::MapPlatform(Point position,
     : _pimpl(new Impl())
 {
     setPosition(position);
-    _pimpl->_rect = rect;
-    _pimpl->_rectIterPtr.reset(new SingleValueIterator<Rectangle>(_pimpl->_rect));
+    setGeometry({rect});
 }
 
 
@@ -47,12 +43,6 @@ bool MapPlatform::isMovable() const
 }
 
 
-RectangleIteratorPtr MapPlatform::getGeometry() const
-{
-    return _pimpl->_rectIterPtr;
-}
-
-
 void MapPlatform::accept(GameObjectVisitor &visitor)
 {
     visitor.visit(*this);
@@ -23,7 +23,6 @@ public:
     virtual ~MapPlatform();
 
     virtual bool isMovable() const override;
-    virtual RectangleIteratorPtr getGeometry() const override;
 
     virtual void accept(GameObjectVisitor &visitor) override;
 
@@ -1,9 +1,10 @@
 // PhysicalEngine.cpp
 
 #include <vector>
+#include <limits>
+#include <algorithm>
 #include <cmath>
-
-#include <QDebug>
+#include <chrono>
 
 #include "platform/Platform.h"
 #include "visualizer/Visualizer.h"
@@ -14,6 +15,10 @@
 #include "PhysicalWorld.h"
 #include "PhysicalObject.h"
 #include "PhysicalEngine.h"
+#include "BodyStore.h"
+#include "ContactCache.h"
+#include "PhysicsProfiler.h"
+#include "SpatialGrid.h"
 #include "StrictCollisionProcessor.h"
 
 
@@ -24,10 +29,23 @@ namespace Platformer
 
 struct PhysicalEngine::Impl
 {
+    void processStep(double frameTimeSec);
+    void addStageTime(FrameStage stage, std::chrono::steady_clock::time_point &lastTimePoint);
+    void saveFramePositions();
+    size_t getSubStepCount(double frameTimeSec) const;
     void applyPhisicalRules(double frameTimeSec);
-    void applyFrictionBetween(SimplePhysicalObjectPointer firstObjectPtr,
-                              SimplePhysicalObjectPointer secondObjectPtr,
-                              Direction connectionDir, double frameTimeSec);
+    void integrateSpeeds(double frameTimeSec);
+    void applyFrictionBetween(size_t firstBodyNum, size_t secondBodyNum, double frameTimeSec);
+    void setBodySpeed(size_t bodyNum, const Point &speed);
+    void activate(SimplePhysicalObjectPointer objectPtr);
+    void addBody(SimplePhysicalObjectPointer objectPtr);
+    void removeBody(SimplePhysicalObjectPointer objectPtr);
+    void detachNeighbors(SimplePhysicalObjectPointer objectPtr);
+    void updateSleeping(double frameTimeSec);
+    size_t findIsland(size_t objectNum);
+    void updateRenderGrid();
+    bool isStaticBody(size_t bodyNum) const;
+    Point getLastStepShift(size_t bodyNum) const;
 
     inline double sign(double value)
     {
@@ -35,13 +53,63 @@ struct PhysicalEngine::Impl
     }
 
     PhysicalWorldPointer _worldPtr;
-    std::vector<SimplePhysicalObjectPointer> _objectVect;
+    BodyStore _bodyStore;
+    ContactCache _contactCache{_bodyStore};
+    PhysicsProfiler _profiler;
     SimpleHierarchicalVisitorPointer<PhysicalObject> _objectCollectorPtr;
     CollisionProcessorPointer _collisionProcessor;
 
+    // batched updates of objects
+    size_t _updateDepth = 0;
+    bool _isMetadataDirty = false;
+
+    // positions at the start of the last step, they are used for sleep
+    // checking and render interpolation
+    std::vector<Point> _framePositions;
+
+    // bounds of bodies at both ends of the last step for render queries,
+    // moved bodies are updated by the next query, added & removed bodies
+    // renumber the store, so the grid is rebuilt
+    SpatialGrid _renderGrid;
+    uint64_t _renderGridStamp = 0;
+    bool _isRenderGridValid = false;
+    std::vector<size_t> _renderBodyNums;
+
+    // Static bodies of the render grid, they are classified by the grid
+    // rebuild. A moved static body becomes dynamic till the next rebuild,
+    // each change of the set makes a new static revision.
+    std::vector<uint8_t> _staticBodyFlags;
+    uint64_t _staticRevision = 0;
+
+    // sleeping
+    std::vector<size_t> _islandParents;
+    std::vector<size_t> _islandQuietFrameCounts;
+    std::vector<SimplePhysicalObjectPointer> _activationStack;
+
     double _gravityAcceleration = 2000.0;
     double _airFrictionDeceleration = 50;
     double _maxSpeed = 5000;
+    size_t _sleepFrameCount = 50;
+    double _sleepDistance = 0.1;
+    size_t _threadCount = 1;
+
+    // collision budget of a step, zero values mean no limit
+    size_t _maxCollisionIterationCount = 0;
+    double _collisionTimeBudget = 0;
+
+    // iterations of the resting contact solver, zero disables it
+    size_t _contactIterationCount = 0;
+
+    // collision sub-steps of fast bodies, zero distance disables them
+    double _maxSubStepDistance = 0;
+    size_t _maxSubStepCount = 8;
+
+    // fixed time step, zero step time means the step of the actual frame time
+    double _fixedStepTime = 0;
+    size_t _maxStepCount = 5;
+    double _accumulatedTime = 0;
+
+    double _frameStageTimes[FrameStageCount] = {};
 };
 
 
@@ -51,7 +119,7 @@ PhysicalEngine::PhysicalEngine()
     _pimpl->_objectCollectorPtr.reset(new SimpleHierarchicalVisitor<PhysicalObject>
                                       ([this](PhysicalObject &object)
     {
-        _pimpl->_objectVect.emplace_back(&object);
+        _pimpl->_bodyStore.attach(&object);
     }));
 
     _pimpl->_collisionProcessor = std::make_shared<StrictCollisionProcessor>(this);
@@ -68,11 +136,54 @@ void PhysicalEngine::updateMetadata()
     if (getWorldPtr() == nullptr)
         throw std::logic_error("PhysicalEngine::updateObjectCache: world is not set");
 
-    _pimpl->_objectVect.clear();
-    _pimpl->_objectCollectorPtr->visit(getWorldPtr()->getSubObjects());
+    _pimpl->_bodyStore.clear();
+    _pimpl->_contactCache.clear();
+    _pimpl->_objectCollectorPtr->visit(createTreeIterator(getWorldPtr()));
 
     // TODO: CollisionProcessor::updateMetadata
     _pimpl->_collisionProcessor->updateMetadata();
+    _pimpl->saveFramePositions();
+    _pimpl->_isMetadataDirty = false;
+    _pimpl->_isRenderGridValid = false;
+}
+
+
+void PhysicalEngine::addObject(GameObjectPointer objectPtr)
+{
+    // parents are attached before their sub-objects
+    forEach(createTreeIterator(objectPtr), [this](GameObjectPointer subObjPtr)
+    {
+        _pimpl->addBody(dynamic_cast<SimplePhysicalObjectPointer>(subObjPtr.get()));
+    });
+}
+
+
+void PhysicalEngine::removeObject(GameObjectPointer objectPtr)
+{
+    forEach(createTreeIterator<Postorder>(objectPtr), [this](GameObjectPointer subObjPtr)
+    {
+        _pimpl->removeBody(dynamic_cast<SimplePhysicalObjectPointer>(subObjPtr.get()));
+    });
+}
+
+
+void PhysicalEngine::beginUpdate()
+{
+    ++_pimpl->_updateDepth;
+}
+
+
+void PhysicalEngine::endUpdate()
+{
+    if (_pimpl->_updateDepth == 0)
+        throw std::logic_error("PhysicalEngine::endUpdate: update is not started");
+
+    if (--_pimpl->_updateDepth != 0 || !_pimpl->_isMetadataDirty)
+        return;
+
+    // one rebuild for all changes of the update
+    _pimpl->_isMetadataDirty = false;
+    _pimpl->_collisionProcessor->updateMetadata();
 }
 
 
@@ -81,66 +192,196 @@ void PhysicalEngine::processWorld()
     // get frame time
     double frameTimeSec = Platform::instance()->getActualFrameTime();
 
+    std::fill(std::begin(_pimpl->_frameStageTimes), std::end(_pimpl->_frameStageTimes), 0.0);
+    _pimpl->_profiler.beginFrame();
+
+    if (_pimpl->_fixedStepTime == 0)
+    {
+        _pimpl->processStep(frameTimeSec);
+        _pimpl->_profiler.endFrame();
+        return;
+    }
+
+    // simulate whole steps of the accumulated time
+    _pimpl->_accumulatedTime += frameTimeSec;
+
+    for (size_t stepNum = 0;
+         stepNum < _pimpl->_maxStepCount && _pimpl->_accumulatedTime >= _pimpl->_fixedStepTime;
+         ++stepNum)
+    {
+        _pimpl->processStep(_pimpl->_fixedStepTime);
+        _pimpl->_accumulatedTime -= _pimpl->_fixedStepTime;
+    }
+
+    // slow frames drop the time that can't be simulated, the world slows
+    // down instead of making longer and longer steps
+    if (_pimpl->_accumulatedTime >= _pimpl->_fixedStepTime)
+        _pimpl->_accumulatedTime = std::fmod(_pimpl->_accumulatedTime, _pimpl->_fixedStepTime);
+
+    _pimpl->_profiler.endFrame();
+}
+
+
+void PhysicalEngine::Impl::processStep(double frameTimeSec)
+{
+    std::chrono::steady_clock::time_point timePoint = std::chrono::steady_clock::now();
+    _profiler.addStep();
+
+    // remember positions for sleep checking & interpolation
+    {
+        PhysicsProfiler::PhaseTimer timer(_profiler, PhysicsProfiler::PreProcessPhase);
+        saveFramePositions();
+        _contactCache.beginFrame();
+    }
+    addStageTime(PreProcessStage, timePoint);
+
     // calculate objects speeds by physical rules
-    _pimpl->applyPhisicalRules(frameTimeSec);
+    {
+        PhysicsProfiler::PhaseTimer timer(_profiler, PhysicsProfiler::PhysicalRulesPhase);
+        applyPhisicalRules(frameTimeSec);
+    }
+    addStageTime(PhysicalRulesStage, timePoint);
+
+    // move objects & process collisions, the processor profiles its phases,
+    // fast bodies split the step, so swept boxes of every sub-step are short,
+    // resting contacts are solved once for the whole step
+    const size_t subStepCount = getSubStepCount(frameTimeSec);
+    _profiler.addCount(PhysicsProfiler::SubStepCounter, subStepCount);
+    _collisionProcessor->beginFrame(frameTimeSec);
+
+    for (size_t subStepNum = 0; subStepNum < subStepCount; ++subStepNum)
+        _collisionProcessor->processSubStep(frameTimeSec / subStepCount);
+
+    addStageTime(CollisionStage, timePoint);
+
+    // put quiet islands to sleep, contacts of sleeping bodies are kept
+    {
+        PhysicsProfiler::PhaseTimer timer(_profiler, PhysicsProfiler::PostProcessPhase);
+        updateSleeping(frameTimeSec);
+        _contactCache.removeStaleContacts();
+    }
+    addStageTime(PostProcessStage, timePoint);
+}
+
+
+void PhysicalEngine::Impl::addStageTime(FrameStage stage, std::chrono::steady_clock::time_point &lastTimePoint)
+{
+    std::chrono::steady_clock::time_point timePoint = std::chrono::steady_clock::now();
+    _frameStageTimes[stage] += std::chrono::duration<double>(timePoint - lastTimePoint).count();
+    lastTimePoint = timePoint;
+}
+
+
+void PhysicalEngine::Impl::saveFramePositions()
+{
+    _framePositions.resize(_bodyStore.getBodyCount());
 
-    // move objects & process collisions
-    _pimpl->_collisionProcessor->processFrame(frameTimeSec);
+    for (size_t bodyNum = 0; bodyNum < _bodyStore.getBodyCount(); ++bodyNum)
+        _framePositions[bodyNum] = _bodyStore.getPosition(bodyNum);
+}
+
+
+size_t PhysicalEngine::Impl::getSubStepCount(double frameTimeSec) const
+{
+    if (_maxSubStepDistance == 0)
+        return 1;
+
+    // the longest axis shift of awake bodies with the speeds of the step start,
+    // hits of the step can change them, so the distance is a soft limit
+    double maxShift = 0;
+
+    for (size_t bodyNum = 0; bodyNum < _bodyStore.getBodyCount(); ++bodyNum)
+        if (!_bodyStore.isSleeping(bodyNum))
+            maxShift = std::max(maxShift, std::max(std::abs(_bodyStore.getSpeedX(bodyNum)),
+                                                   std::abs(_bodyStore.getSpeedY(bodyNum))) * frameTimeSec);
+
+    const double subStepCount = std::min<double>(_maxSubStepCount, std::ceil(maxShift / _maxSubStepDistance));
+    return std::max<size_t>(1, static_cast<size_t>(subStepCount));
 }
 
 
 void PhysicalEngine::Impl::applyPhisicalRules(double frameTimeSec)
 {
-    for (SimplePhysicalObjectPointer objectPtr : _objectVect)
+    // contact with awake object wakes up sleeping neighbors, resting
+    // platforms don't wake up objects lying on them
+    for (size_t bodyNum = 0; bodyNum < _bodyStore.getBodyCount(); ++bodyNum)
+        if (!_bodyStore.isSleeping(bodyNum) && _bodyStore.isActive(bodyNum))
+            for (long dir : Range(4))
+            {
+                const size_t linkedNum = _bodyStore.getLinkedBodyNum(bodyNum, static_cast<Direction>(dir));
+
+                if (linkedNum != BodyStore::NO_BODY && _bodyStore.isSleeping(linkedNum))
+                    activate(_bodyStore.getObjectPtr(linkedNum));
+            }
+
+    // apply gravity, air friction & speed limit
+    integrateSpeeds(frameTimeSec);
+
+    // apply friction with another objects, neighbors are taken by the
+    // links of the store
+    for (size_t bodyNum = 0; bodyNum < _bodyStore.getBodyCount(); ++bodyNum)
     {
-        if (objectPtr->isMovable())
-        {
-            // apply gravity
-            objectPtr->setSpeed(objectPtr->getSpeed() + Point(0, _gravityAcceleration * frameTimeSec));
-
-            // apply air friction
-            double frictionValue = _airFrictionDeceleration * frameTimeSec;
-            double frictionAngle = std::atan2(-objectPtr->getSpeed().getY(),
-                                              -objectPtr->getSpeed().getX());
-            Point frictionVect(frictionValue * std::cos(frictionAngle),
-                               frictionValue * std::sin(frictionAngle));
-
-            if (objectPtr->getSpeed().getLength() < frictionVect.getLength())
-                objectPtr->setSpeed(0);
-            else
-                objectPtr->setSpeed(objectPtr->getSpeed() + frictionVect);
-        }
+        if (_bodyStore.isSleeping(bodyNum))
+            continue;
 
-        // apply friction with another objects
-        SimplePhysicalObjectPointer downObjectPtr  = objectPtr->getContiguousObject(Down);
-        SimplePhysicalObjectPointer rightObjectPtr = objectPtr->getContiguousObject(Right);
+        applyFrictionBetween(bodyNum, _bodyStore.getLinkedBodyNum(bodyNum, Down),  frameTimeSec);
+        applyFrictionBetween(bodyNum, _bodyStore.getLinkedBodyNum(bodyNum, Right), frameTimeSec);
+    }
+}
 
-        applyFrictionBetween(objectPtr, downObjectPtr,  Down,  frameTimeSec);
-        applyFrictionBetween(objectPtr, rightObjectPtr, Right, frameTimeSec);
+
+void PhysicalEngine::Impl::integrateSpeeds(double frameTimeSec)
+{
+    const double gravitySpeed  = _gravityAcceleration * frameTimeSec;
+    const double frictionSpeed = _airFrictionDeceleration * frameTimeSec;
+    const double maxSpeed = _maxSpeed;
+    const size_t bodyCount = _bodyStore.getBodyCount();
+    double *speedXs = _bodyStore.getSpeedXData();
+    double *speedYs = _bodyStore.getSpeedYData();
+    const uint8_t *flags = _bodyStore.getFlagData();
+
+    // one pass over the speed arrays without branches, so it can be
+    // vectorized, air friction slows the body down along its speed
+    // without turning it, bodies slower than the friction stop
+    for (size_t bodyNum = 0; bodyNum < bodyCount; ++bodyNum)
+    {
+        const bool isIntegrated = (flags[bodyNum] & (BodyStore::MovableBody | BodyStore::SleepingBody))
+                               == BodyStore::MovableBody;
+        const double speedX = speedXs[bodyNum];
+        const double speedY = speedYs[bodyNum] + gravitySpeed;
+        const double speed = std::sqrt(speedX * speedX + speedY * speedY);
+        const double newSpeed = std::min(speed - frictionSpeed, maxSpeed);
+        const double factor = newSpeed > 0 ? newSpeed / speed : 0;
+
+        speedXs[bodyNum] = isIntegrated ? speedX * factor : speedX;
+        speedYs[bodyNum] = isIntegrated ? speedY * factor : speedYs[bodyNum];
     }
 }
 
 
-void PhysicalEngine::Impl::applyFrictionBetween(SimplePhysicalObjectPointer firstObjectPtr,
-                                                SimplePhysicalObjectPointer secondObjectPtr,
-                                                Direction connectionDir,
-                                                double frameTimeSec)
+void PhysicalEngine::Impl::applyFrictionBetween(size_t firstBodyNum, size_t secondBodyNum, double frameTimeSec)
 {
-    if (firstObjectPtr == nullptr || secondObjectPtr == nullptr)
+    if (secondBodyNum == BodyStore::NO_BODY)
+        return;
+
+    // the side of the contact is taken from the cache
+    const ContactCache::Contact *contactPtr = _contactCache.findContact(firstBodyNum, secondBodyNum);
+
+    if (contactPtr == nullptr)
         return;
 
-    const double frictionFactor = (firstObjectPtr->getFrictionFactor()
-                             + secondObjectPtr->getFrictionFactor()) / 2;
+    const double frictionFactor = (_bodyStore.getFrictionFactor(firstBodyNum)
+                             + _bodyStore.getFrictionFactor(secondBodyNum)) / 2;
     const double frictionValue = frictionFactor * frameTimeSec;
-    const bool isHorizontalFriction = !(connectionDir == Right || connectionDir == Left);
+    const bool isHorizontalFriction = contactPtr->_direction == Down;
 
-    double firstObjectSpeed = firstObjectPtr->getSpeed().getProjection(isHorizontalFriction);
-    double secondObjectSpeed = secondObjectPtr->getSpeed().getProjection(isHorizontalFriction);
+    double firstObjectSpeed = _bodyStore.getSpeed(firstBodyNum).getProjection(isHorizontalFriction);
+    double secondObjectSpeed = _bodyStore.getSpeed(secondBodyNum).getProjection(isHorizontalFriction);
 
-    if (firstObjectPtr->isMovable())
+    if (_bodyStore.isMovable(firstBodyNum))
     {
         double firstRelativeSpeed  = firstObjectSpeed - secondObjectSpeed;
-        Point firstSpeedVect  = firstObjectPtr->getSpeed();
+        Point firstSpeedVect  = _bodyStore.getSpeed(firstBodyNum);
 
         if (std::abs(firstRelativeSpeed) > frictionValue)
             firstSpeedVect.setProjection(firstObjectSpeed
@@ -148,13 +389,13 @@ void PhysicalEngine::Impl::applyFrictionBetween(SimplePhysicalObjectPointer firs
         else
             firstSpeedVect.setProjection(secondObjectSpeed, isHorizontalFriction);
 
-        firstObjectPtr->setSpeed(firstSpeedVect);
+        setBodySpeed(firstBodyNum, firstSpeedVect);
     }
 
-    if (secondObjectPtr->isMovable())
+    if (_bodyStore.isMovable(secondBodyNum))
     {
         double secondRelativeSpeed = secondObjectSpeed - firstObjectSpeed;
-        Point secondSpeedVect = secondObjectPtr->getSpeed();
+        Point secondSpeedVect = _bodyStore.getSpeed(secondBodyNum);
 
         if (std::abs(secondRelativeSpeed) > frictionValue)
             secondSpeedVect.setProjection(secondObjectSpeed
@@ -162,11 +403,260 @@ void PhysicalEngine::Impl::applyFrictionBetween(SimplePhysicalObjectPointer firs
         else
             secondSpeedVect.setProjection(firstObjectSpeed, isHorizontalFriction);
 
-        secondObjectPtr->setSpeed(secondSpeedVect);
+        setBodySpeed(secondBodyNum, secondSpeedVect);
     }
 }
 
 
+void PhysicalEngine::Impl::setBodySpeed(size_t bodyNum, const Point &speed)
+{
+    // a sleeping body is woken up by its object on a speed change
+    SimplePhysicalObjectPointer objectPtr = _bodyStore.getObjectPtr(bodyNum);
+
+    if (_bodyStore.isSleeping(bodyNum) && objectPtr != nullptr)
+        objectPtr->setSpeed(speed);
+    else
+        _bodyStore.setSpeed(bodyNum, speed.getX(), speed.getY());
+}
+
+
+
+void PhysicalEngine::Impl::activate(SimplePhysicalObjectPointer objectPtr)
+{
+    // wake up the whole island through contiguous objects
+    _activationStack.clear();
+    _activationStack.push_back(objectPtr);
+
+    while (!_activationStack.empty())
+    {
+        SimplePhysicalObjectPointer currentPtr = _activationStack.back();
+        _activationStack.pop_back();
+
+        if (currentPtr == nullptr || !currentPtr->isSleeping())
+            continue;
+
+        currentPtr->setIsSleeping(false);
+
+        for (long dir : Range(4))
+            _activationStack.push_back(currentPtr->getContiguousObject(static_cast<Direction>(dir)));
+    }
+}
+
+
+void PhysicalEngine::Impl::addBody(SimplePhysicalObjectPointer objectPtr)
+{
+    if (objectPtr == nullptr || _bodyStore.getBodyNum(objectPtr) != BodyStore::NO_BODY)
+        return;
+
+    const size_t bodyNum = _bodyStore.attach(objectPtr);
+    _framePositions.resize(bodyNum);
+    _framePositions.push_back(_bodyStore.getPosition(bodyNum));
+    _isRenderGridValid = false;
+
+    if (_updateDepth != 0)
+        _isMetadataDirty = true;
+    else
+        _collisionProcessor->addBody(bodyNum);
+}
+
+
+void PhysicalEngine::Impl::removeBody(SimplePhysicalObjectPointer objectPtr)
+{
+    const size_t bodyNum = _bodyStore.getBodyNum(objectPtr);
+
+    if (bodyNum == BodyStore::NO_BODY)
+        return;
+
+    detachNeighbors(objectPtr);
+
+    // the last body takes the number of the removed one
+    _bodyStore.remove(bodyNum);
+    _isRenderGridValid = false;
+
+    if (bodyNum < _framePositions.size())
+    {
+        _framePositions[bodyNum] = _framePositions.back();
+        _framePositions.pop_back();
+    }
+
+    if (_updateDepth != 0)
+        _isMetadataDirty = true;
+    else
+        _collisionProcessor->removeBody(bodyNum);
+}
+
+
+void PhysicalEngine::Impl::detachNeighbors(SimplePhysicalObjectPointer objectPtr)
+{
+    // neighbors of removed object lose their support and wake up
+    for (long dir : Range(4))
+    {
+        const Direction direction = static_cast<Direction>(dir);
+        SimplePhysicalObjectPointer neighborPtr = objectPtr->getContiguousObject(direction);
+
+        if (neighborPtr == nullptr)
+            continue;
+
+        activate(neighborPtr);
+
+        if (neighborPtr->getContiguousObject(getOppositeDirrection(direction)) == objectPtr)
+            neighborPtr->setContiguousObject(getOppositeDirrection(direction), nullptr);
+    }
+
+    objectPtr->resetContiguousObjects();
+}
+
+
+void PhysicalEngine::Impl::updateSleeping(double frameTimeSec)
+{
+    if (_sleepFrameCount == 0)
+        return;
+
+    const size_t bodyCount = _bodyStore.getBodyCount();
+
+    // islands are sets of movable objects connected by contiguous objects
+    _islandParents.resize(bodyCount);
+    _islandQuietFrameCounts.assign(bodyCount, std::numeric_limits<size_t>::max());
+
+    for (size_t bodyNum = 0; bodyNum < bodyCount; ++bodyNum)
+        _islandParents[bodyNum] = bodyNum;
+
+    for (size_t bodyNum = 0; bodyNum < bodyCount; ++bodyNum)
+    {
+        if (!_bodyStore.isMovable(bodyNum) || _bodyStore.isSleeping(bodyNum))
+            continue;
+
+        SimplePhysicalObjectPointer objectPtr = _bodyStore.getObjectPtr(bodyNum);
+
+        for (long dir : Range(4))
+        {
+            size_t neighborNum = _bodyStore.getBodyNum(objectPtr->getContiguousObject(static_cast<Direction>(dir)));
+
+            if (neighborNum != BodyStore::NO_BODY && _bodyStore.isMovable(neighborNum))
+                _islandParents[findIsland(bodyNum)] = findIsland(neighborNum);
+        }
+    }
+
+    // count quiet frames, an island is as quiet as its least quiet object
+    for (size_t bodyNum = 0; bodyNum < bodyCount; ++bodyNum)
+    {
+        if (!_bodyStore.isMovable(bodyNum) || _bodyStore.isSleeping(bodyNum))
+            continue;
+
+        SimplePhysicalObjectPointer objectPtr = _bodyStore.getObjectPtr(bodyNum);
+        Point shift = _bodyStore.getPosition(bodyNum) + _framePositions[bodyNum] * -1;
+        bool isQuiet = shift.getLength() < _sleepDistance
+                    && _bodyStore.getSpeed(bodyNum).getLength() * frameTimeSec < _sleepDistance;
+
+        objectPtr->setQuietFrameCount(isQuiet ? objectPtr->getQuietFrameCount() + 1 : 0);
+
+        size_t &islandCount = _islandQuietFrameCounts[findIsland(bodyNum)];
+        islandCount = std::min(islandCount, objectPtr->getQuietFrameCount());
+    }
+
+    for (size_t bodyNum = 0; bodyNum < bodyCount; ++bodyNum)
+    {
+        if (   !_bodyStore.isMovable(bodyNum) || _bodyStore.isSleeping(bodyNum)
+            || _islandQuietFrameCounts[findIsland(bodyNum)] < _sleepFrameCount)
+            continue;
+
+        _bodyStore.setSpeed(bodyNum, 0, 0);
+        _bodyStore.setIsSleeping(bodyNum, true);
+    }
+}
+
+
+size_t PhysicalEngine::Impl::findIsland(size_t objectNum)
+{
+    while (_islandParents[objectNum] != objectNum)
+    {
+        _islandParents[objectNum] = _islandParents[_islandParents[objectNum]];
+        objectNum = _islandParents[objectNum];
+    }
+
+    return objectNum;
+}
+
+
+void PhysicalEngine::Impl::updateRenderGrid()
+{
+    const bool isRebuilt = !_isRenderGridValid;
+
+    if (isRebuilt)
+    {
+        _renderGrid.clear();
+        _staticBodyFlags.resize(_bodyStore.getBodyCount());
+
+        for (size_t bodyNum = 0; bodyNum < _bodyStore.getBodyCount(); ++bodyNum)
+            _staticBodyFlags[bodyNum] = isStaticBody(bodyNum);
+
+        ++_staticRevision;
+    }
+
+    // resting bodies are skipped by their move stamps
+    for (size_t bodyNum = 0; bodyNum < _bodyStore.getBodyCount(); ++bodyNum)
+    {
+        if (!isRebuilt && !_bodyStore.isMovedSince(bodyNum, _renderGridStamp))
+            continue;
+
+        if (!isRebuilt && _staticBodyFlags[bodyNum])
+        {
+            _staticBodyFlags[bodyNum] = false;
+            ++_staticRevision;
+        }
+
+        _bodyStore.updateGeometry(bodyNum);
+        BoundingBox box = _bodyStore.getBox(bodyNum);
+
+        // render positions are interpolated from the last step start
+        if (!box.isEmpty())
+        {
+            const Point shift = getLastStepShift(bodyNum);
+            BoundingBox startBox = box;
+            startBox.move(shift.getX(), shift.getY());
+            box.unite(startBox);
+        }
+
+        _renderGrid.setBox(bodyNum, box);
+    }
+
+    _renderGridStamp = _bodyStore.getLastMoveStamp();
+    _isRenderGridValid = true;
+}
+
+
+bool PhysicalEngine::Impl::isStaticBody(size_t bodyNum) const
+{
+    // bodies moved by their speed or by parents can't be cached
+    for (size_t nodeNum = bodyNum; nodeNum != BodyStore::NO_BODY; nodeNum = _bodyStore.getParentNum(nodeNum))
+    {
+        if (_bodyStore.isMovable(nodeNum) || _bodyStore.getSpeedX(nodeNum) != 0 || _bodyStore.getSpeedY(nodeNum) != 0)
+            return false;
+    }
+
+    return true;
+}
+
+
+Point PhysicalEngine::Impl::getLastStepShift(size_t bodyNum) const
+{
+    Point shift;
+
+    // ancestor bodies move their sub-objects
+    for (ConstSimpleGameObjectPointer nodePtr = _bodyStore.getObjectPtr(bodyNum);
+         nodePtr != nullptr; nodePtr = nodePtr->getParentPointer())
+    {
+        const size_t nodeBodyNum
+                = _bodyStore.getBodyNum(dynamic_cast<ConstSimplePhysicalObjectPointer>(nodePtr));
+
+        if (nodeBodyNum != BodyStore::NO_BODY && nodeBodyNum < _framePositions.size())
+            shift += _framePositions[nodeBodyNum] + _bodyStore.getPosition(nodeBodyNum) * -1;
+    }
+
+    return shift;
+}
+
+
 
 /*
 void PhysicalEngine::Impl::applyFrictionBetween(SimplePhysicalObjectPointer obj1Ptr,
@@ -214,6 +704,41 @@ PhysicalWorldPointer PhysicalEngine::getWorldPtr() const
     return _pimpl->_worldPtr;
 }
 
+CollisionProcessorPointer PhysicalEngine::getCollisionProcessorPtr() const
+{
+    return _pimpl->_collisionProcessor;
+}
+
+BodyStore &PhysicalEngine::getBodyStore()
+{
+    return _pimpl->_bodyStore;
+}
+
+const BodyStore &PhysicalEngine::getBodyStore() const
+{
+    return _pimpl->_bodyStore;
+}
+
+ContactCache &PhysicalEngine::getContactCache()
+{
+    return _pimpl->_contactCache;
+}
+
+const ContactCache &PhysicalEngine::getContactCache() const
+{
+    return _pimpl->_contactCache;
+}
+
+PhysicsProfiler &PhysicalEngine::getProfiler()
+{
+    return _pimpl->_profiler;
+}
+
+const PhysicsProfiler &PhysicalEngine::getProfiler() const
+{
+    return _pimpl->_profiler;
+}
+
 double PhysicalEngine::getGravityAcceleration() const
 {
     return _pimpl->_gravityAcceleration;
@@ -229,6 +754,139 @@ double PhysicalEngine::getMaxSpeed() const
     return _pimpl->_maxSpeed;
 }
 
+size_t PhysicalEngine::getSleepFrameCount() const
+{
+    return _pimpl->_sleepFrameCount;
+}
+
+double PhysicalEngine::getSleepDistance() const
+{
+    return _pimpl->_sleepDistance;
+}
+
+size_t PhysicalEngine::getThreadCount() const
+{
+    return _pimpl->_threadCount;
+}
+
+double PhysicalEngine::getFixedStepTime() const
+{
+    return _pimpl->_fixedStepTime;
+}
+
+size_t PhysicalEngine::getMaxStepCount() const
+{
+    return _pimpl->_maxStepCount;
+}
+
+size_t PhysicalEngine::getMaxCollisionIterationCount() const
+{
+    return _pimpl->_maxCollisionIterationCount;
+}
+
+double PhysicalEngine::getCollisionTimeBudget() const
+{
+    return _pimpl->_collisionTimeBudget;
+}
+
+size_t PhysicalEngine::getContactIterationCount() const
+{
+    return _pimpl->_contactIterationCount;
+}
+
+double PhysicalEngine::getMaxSubStepDistance() const
+{
+    return _pimpl->_maxSubStepDistance;
+}
+
+size_t PhysicalEngine::getMaxSubStepCount() const
+{
+    return _pimpl->_maxSubStepCount;
+}
+
+size_t PhysicalEngine::getCollisionBudgetHitCount() const
+{
+    return _pimpl->_collisionProcessor->getBudgetHitCount();
+}
+
+double PhysicalEngine::getInterpolationFactor() const
+{
+    if (_pimpl->_fixedStepTime == 0)
+        return 1;
+
+    return _pimpl->_accumulatedTime / _pimpl->_fixedStepTime;
+}
+
+double PhysicalEngine::getFrameStageTime(FrameStage stage) const
+{
+    if (stage >= FrameStageCount)
+        throw std::logic_error("PhysicalEngine::getFrameStageTime: wrong stage");
+
+    return _pimpl->_frameStageTimes[stage];
+}
+
+Point PhysicalEngine::getRenderPosition(ConstSimplePhysicalObjectPointer objectPtr) const
+{
+    const size_t bodyNum = _pimpl->_bodyStore.getBodyNum(objectPtr);
+    const double factor = getInterpolationFactor();
+
+    if (bodyNum == BodyStore::NO_BODY || bodyNum >= _pimpl->_framePositions.size() || factor == 1)
+        return objectPtr->getPosition();
+
+    // between the states before and after the last step
+    const Point &lastPosition = _pimpl->_framePositions[bodyNum];
+    return lastPosition + (_pimpl->_bodyStore.getPosition(bodyNum) + lastPosition * -1) * factor;
+}
+
+Rectangle PhysicalEngine::mapToRender(ConstSimplePhysicalObjectPointer objectPtr, const Rectangle &rect) const
+{
+    Point position = rect.getPosition();
+    ConstSimpleGameObjectPointer nodePtr = objectPtr;
+
+    for ( ; nodePtr != nullptr; nodePtr = nodePtr->getParentPointer())
+    {
+        ConstSimplePhysicalObjectPointer physicalNodePtr = dynamic_cast<ConstSimplePhysicalObjectPointer>(nodePtr);
+        position += physicalNodePtr != nullptr ? getRenderPosition(physicalNodePtr) : nodePtr->getPosition();
+    }
+
+    return Rectangle(position, rect.getSize());
+}
+
+
+void PhysicalEngine::findRenderedObjects(const Rectangle &rect, std::vector<SimplePhysicalObjectPointer> &objectPtrs,
+                                         bool isStaticSkipped)
+{
+    objectPtrs.clear();
+    _pimpl->updateRenderGrid();
+    _pimpl->_renderGrid.findBodies(BoundingBox(rect), _pimpl->_renderBodyNums);
+
+    for (size_t bodyNum : _pimpl->_renderBodyNums)
+    {
+        if (!isStaticSkipped || !_pimpl->_staticBodyFlags[bodyNum])
+            objectPtrs.push_back(_pimpl->_bodyStore.getObjectPtr(bodyNum));
+    }
+}
+
+
+uint64_t PhysicalEngine::getStaticRevision()
+{
+    _pimpl->updateRenderGrid();
+    return _pimpl->_staticRevision;
+}
+
+
+void PhysicalEngine::findStaticObjects(std::vector<SimplePhysicalObjectPointer> &objectPtrs)
+{
+    objectPtrs.clear();
+    _pimpl->updateRenderGrid();
+
+    for (size_t bodyNum = 0; bodyNum < _pimpl->_bodyStore.getBodyCount(); ++bodyNum)
+    {
+        if (_pimpl->_staticBodyFlags[bodyNum])
+            objectPtrs.push_back(_pimpl->_bodyStore.getObjectPtr(bodyNum));
+    }
+}
+
 double PhysicalEngine::getDefaultFirictionFactor()
 {
     return 100;
@@ -246,6 +904,18 @@ void PhysicalEngine::setWorldPtr(PhysicalWorldPointer worldPtr)
     updateMetadata();
 }
 
+void PhysicalEngine::setCollisionProcessorPtr(CollisionProcessorPointer processorPtr)
+{
+    if (processorPtr == nullptr)
+        throw std::logic_error("PhysicalEngine::setCollisionProcessorPtr: processor is null");
+
+    processorPtr->setEnginePtr(this);
+    _pimpl->_collisionProcessor = processorPtr;
+
+    if (getWorldPtr() != nullptr)
+        _pimpl->_collisionProcessor->updateMetadata();
+}
+
 void PhysicalEngine::setGravityAcceleration(double gravityAcceleration)
 {
     _pimpl->_gravityAcceleration = gravityAcceleration;
@@ -258,9 +928,87 @@ void PhysicalEngine::setAirFrictionDeceleration(double factor)
 
 void PhysicalEngine::setMaxSpeed(double speed)
 {
+    if (speed < 0)
+        throw std::logic_error("PhysicalEngine::setMaxSpeed: speed is negative");
+
     _pimpl->_maxSpeed = speed;
 }
 
+void PhysicalEngine::setSleepFrameCount(size_t count)
+{
+    _pimpl->_sleepFrameCount = count;
+
+    // zero count disables sleeping
+    if (count == 0)
+        for (size_t bodyNum = 0; bodyNum < _pimpl->_bodyStore.getBodyCount(); ++bodyNum)
+            _pimpl->_bodyStore.getObjectPtr(bodyNum)->setIsSleeping(false);
+}
+
+void PhysicalEngine::setSleepDistance(double distance)
+{
+    _pimpl->_sleepDistance = distance;
+}
+
+void PhysicalEngine::setThreadCount(size_t threadCount)
+{
+    if (threadCount == 0)
+        throw std::logic_error("PhysicalEngine::setThreadCount: thread count is zero");
+
+    // results don't depend on the thread count
+    _pimpl->_threadCount = threadCount;
+}
+
+void PhysicalEngine::setFixedStepTime(double stepTimeSec)
+{
+    if (stepTimeSec < 0)
+        throw std::logic_error("PhysicalEngine::setFixedStepTime: step time is negative");
+
+    _pimpl->_fixedStepTime = stepTimeSec;
+    _pimpl->_accumulatedTime = 0;
+}
+
+void PhysicalEngine::setMaxStepCount(size_t count)
+{
+    if (count == 0)
+        throw std::logic_error("PhysicalEngine::setMaxStepCount: step count is zero");
+
+    _pimpl->_maxStepCount = count;
+}
+
+void PhysicalEngine::setMaxCollisionIterationCount(size_t count)
+{
+    _pimpl->_maxCollisionIterationCount = count;
+}
+
+void PhysicalEngine::setCollisionTimeBudget(double timeSec)
+{
+    if (timeSec < 0)
+        throw std::logic_error("PhysicalEngine::setCollisionTimeBudget: time budget is negative");
+
+    _pimpl->_collisionTimeBudget = timeSec;
+}
+
+void PhysicalEngine::setContactIterationCount(size_t count)
+{
+    _pimpl->_contactIterationCount = count;
+}
+
+void PhysicalEngine::setMaxSubStepDistance(double distance)
+{
+    if (distance < 0)
+        throw std::logic_error("PhysicalEngine::setMaxSubStepDistance: distance is negative");
+
+    _pimpl->_maxSubStepDistance = distance;
+}
+
+void PhysicalEngine::setMaxSubStepCount(size_t count)
+{
+    if (count == 0)
+        throw std::logic_error("PhysicalEngine::setMaxSubStepCount: sub-step count is zero");
+
+    _pimpl->_maxSubStepCount = count;
+}
+
 
 
 }  // namespace Platformer
@@ -4,8 +4,12 @@
 #define PHYSICALENGINE_H
 
 #include <memory>
+#include <vector>
+#include <cstdint>
 
 #include "Types.h"
+#include "geometry/Point.h"
+#include "geometry/Rectangle.h"
 
 
 namespace Platformer
@@ -15,25 +19,116 @@ namespace Platformer
 class PhysicalEngine
 {
 public:
+    enum FrameStage
+    {
+        PreProcessStage,
+        PhysicalRulesStage,
+        CollisionStage,
+        PostProcessStage,
+        FrameStageCount
+    };
+
     PhysicalEngine();
     PhysicalEngine(PhysicalEngine&& other);
     virtual PhysicalEngine& operator=(PhysicalEngine&& other);
     virtual ~PhysicalEngine();
 
     PhysicalWorldPointer getWorldPtr() const;
+    CollisionProcessorPointer getCollisionProcessorPtr() const;
+    BodyStore &getBodyStore();
+    const BodyStore &getBodyStore() const;
+    ContactCache &getContactCache();
+    const ContactCache &getContactCache() const;
+
+    // frame phases & counters, the profiler is disabled by default
+    PhysicsProfiler &getProfiler();
+    const PhysicsProfiler &getProfiler() const;
+
     double getGravityAcceleration() const;
     double getAirFrictionDeceleration() const;
     double getMaxSpeed() const;
+    size_t getSleepFrameCount() const;
+    double getSleepDistance() const;
+    size_t getThreadCount() const;
+    double getFixedStepTime() const;
+    size_t getMaxStepCount() const;
+    size_t getMaxCollisionIterationCount() const;
+    double getCollisionTimeBudget() const;
+    size_t getContactIterationCount() const;
+    double getMaxSubStepDistance() const;
+    size_t getMaxSubStepCount() const;
+
+    // number of steps, that ran out of the collision budget
+    size_t getCollisionBudgetHitCount() const;
+
+    // part of the fixed step passed since the last step, 1 in variable step mode
+    double getInterpolationFactor() const;
+
+    // time the last processWorld() call spent in the stage of its steps
+    double getFrameStageTime(FrameStage stage) const;
+
+    // positions interpolated between the last two steps for drawing
+    Point getRenderPosition(ConstSimplePhysicalObjectPointer objectPtr) const;
+    Rectangle mapToRender(ConstSimplePhysicalObjectPointer objectPtr, const Rectangle &rect) const;
+
+    // Objects, whose render rectangles can overlap the rectangle, taken from
+    // a grid of body bounds. Only bodies moved since the last call are
+    // updated in the grid, so the cost follows the moving & found objects.
+    // Static objects can be skipped, when they are drawn from a cache.
+    void findRenderedObjects(const Rectangle &rect, std::vector<SimplePhysicalObjectPointer> &objectPtrs,
+                             bool isStaticSkipped = false);
+
+    // Objects, that can't move by the physical rules with their physical
+    // parents. The revision changes, when static objects are added, removed
+    // or moved, a moved one stays dynamic till objects are added or removed.
+    uint64_t getStaticRevision();
+    void findStaticObjects(std::vector<SimplePhysicalObjectPointer> &objectPtrs);
 
     static double getDefaultFirictionFactor();
     static double getDefaultHitRecoveryFactor();
 
     void updateMetadata();
+
+    // Registers the world object with its physical sub-objects in the engine
+    // or removes them. Changes made between beginUpdate() and endUpdate() are
+    // passed to the collision processor by one rebuild, updates can be nested.
+    void addObject(GameObjectPointer objectPtr);
+    void removeObject(GameObjectPointer objectPtr);
+    void beginUpdate();
+    void endUpdate();
+
     void processWorld();
     void setWorldPtr(PhysicalWorldPointer worldPtr);
+    void setCollisionProcessorPtr(CollisionProcessorPointer processorPtr);
     void setGravityAcceleration(double gravityAcceleration);
     void setAirFrictionDeceleration(double factor);
+
+    // movable bodies are slowed down to the speed by the physical rules
     void setMaxSpeed(double speed);
+    void setSleepFrameCount(size_t count);
+    void setSleepDistance(double distance);
+    void setThreadCount(size_t threadCount);
+
+    // zero step time makes one step of the actual frame time per frame
+    void setFixedStepTime(double stepTimeSec);
+    void setMaxStepCount(size_t count);
+
+    // Collision processing budget of one step, zero means no limit. When the
+    // budget is spent, the rest of the step is resolved approximately. Cut
+    // points of the time budget depend on the machine speed, so simulations
+    // using it can't be reproduced by replays.
+    void setMaxCollisionIterationCount(size_t count);
+    void setCollisionTimeBudget(double timeSec);
+
+    // Resting contacts are solved together by sequential impulse iterations
+    // before collision events, zero count processes them as events.
+    void setContactIterationCount(size_t count);
+
+    // Collisions of a step are processed by several sub-steps, when an awake
+    // body moves farther than the distance along an axis during the step,
+    // so swept bounds of fast bodies stay short. Zero distance disables it.
+    void setMaxSubStepDistance(double distance);
+    void setMaxSubStepCount(size_t count);
 
 private:
     struct Impl;
@@ -3,6 +3,7 @@
 #include "visitor/GameObjectVisitor.h"
 #include "PhysicalObject.h"
 #include "PhysicalEngine.h"
+#include "BodyStore.h"
 
 
 namespace Platformer
@@ -18,10 +19,14 @@ struct PhysicalObject::Impl
     Point _position;
     Point _speed;
     SimplePhysicalObjectPointer _contiguousObjects[4] = {nullptr, nullptr, nullptr, nullptr};
-    bool _isStatic = false;
+    bool _isSleeping = false;
     bool _isStand = false;
-    size_t _staticFrameCount = 0;
+    size_t _quietFrameCount = 0;
     Point _lastPosition;
+    std::vector<Rectangle> _geometry;
+
+    BodyStore *_bodyStorePtr = nullptr;
+    size_t _bodyNum = 0;
 };
 
 
@@ -36,7 +41,12 @@ PhysicalObject::PhysicalObject(const std::string &name)
 
 PhysicalObject::PhysicalObject(PhysicalObject&& /*other*/) = default;
 PhysicalObject& PhysicalObject::operator=(PhysicalObject&& /*other*/) = default;
-PhysicalObject::~PhysicalObject() = default;
+
+PhysicalObject::~PhysicalObject()
+{
+    if (_pimpl != nullptr && _pimpl->_bodyStorePtr != nullptr)
+        _pimpl->_bodyStorePtr->detach(_pimpl->_bodyNum);
+}
 
 
 double PhysicalObject::getMass() const
@@ -59,10 +69,18 @@ bool PhysicalObject::isMovable() const
     return true;
 }
 
-//bool PhysicalObject::isStatic() const
-//{
-//    return _pimpl->_isStatic;
-//}
+bool PhysicalObject::isSleeping() const
+{
+    if (_pimpl->_bodyStorePtr != nullptr)
+        return _pimpl->_bodyStorePtr->isSleeping(_pimpl->_bodyNum);
+
+    return _pimpl->_isSleeping;
+}
+
+size_t PhysicalObject::getQuietFrameCount() const
+{
+    return _pimpl->_quietFrameCount;
+}
 
 //bool PhysicalObject::isStand() const
 //{
@@ -71,29 +89,43 @@ bool PhysicalObject::isMovable() const
 
 Point PhysicalObject::getPosition() const
 {
+    if (_pimpl->_bodyStorePtr != nullptr)
+        return _pimpl->_bodyStorePtr->getPosition(_pimpl->_bodyNum);
+
     return _pimpl->_position;
 }
 
 Point PhysicalObject::getSpeed() const
 {
+    if (_pimpl->_bodyStorePtr != nullptr)
+        return _pimpl->_bodyStorePtr->getSpeed(_pimpl->_bodyNum);
+
     return _pimpl->_speed;
 }
 
 RectangleIteratorPtr PhysicalObject::getGeometry() const
 {
-    return IteratorPointer<Rectangle>(new EmptyIterator<Rectangle>());
+    return createContainerIterator(_pimpl->_geometry);
+}
+
+RectangleSpan PhysicalObject::getGeometrySpan() const
+{
+    return RectangleSpan(_pimpl->_geometry.data(), _pimpl->_geometry.size());
 }
 
 SimplePhysicalObjectPointer PhysicalObject::getContiguousObject(Direction dir) const
 {
+    // links of attached objects are kept by handles, so the neighbour
+    // could be removed from the store since the contact
+    if (_pimpl->_bodyStorePtr != nullptr)
+    {
+        const size_t linkedNum = _pimpl->_bodyStorePtr->getLinkedBodyNum(_pimpl->_bodyNum, dir);
+        return linkedNum != BodyStore::NO_BODY ? _pimpl->_bodyStorePtr->getObjectPtr(linkedNum) : nullptr;
+    }
+
     return _pimpl->_contiguousObjects[dir];
 }
 
-//size_t PhysicalObject::getStaticFrameCount() const
-//{
-//    return _pimpl->_staticFrameCount;
-//}
-
 //Point PhysicalObject::getLastPosition() const
 //{
 //    return _pimpl->_lastPosition;
@@ -124,39 +156,72 @@ void PhysicalObject::accept(GameObjectVisitor &visitor)
 
 void PhysicalObject::setPosition(Point posotion)
 {
-    _pimpl->_position = posotion;
+    if (_pimpl->_bodyStorePtr != nullptr)
+        _pimpl->_bodyStorePtr->setPosition(_pimpl->_bodyNum, posotion.getX(), posotion.getY());
+    else
+        _pimpl->_position = posotion;
 }
 
 void PhysicalObject::setSpeed(const Point &speed)
 {
-    _pimpl->_speed = speed;
+    Point oldSpeed = getSpeed();
+
+    // sleeping object wakes up on any speed change
+    if (isSleeping() && (speed.getX() != oldSpeed.getX() || speed.getY() != oldSpeed.getY()))
+        setIsSleeping(false);
+
+    if (_pimpl->_bodyStorePtr != nullptr)
+        _pimpl->_bodyStorePtr->setSpeed(_pimpl->_bodyNum, speed.getX(), speed.getY());
+    else
+        _pimpl->_speed = speed;
 }
 
 void PhysicalObject::setContiguousObject(Direction dir, SimplePhysicalObjectPointer objectPtr)
 {
-    _pimpl->_contiguousObjects[dir] = objectPtr;
+    if (_pimpl->_bodyStorePtr == nullptr)
+    {
+        _pimpl->_contiguousObjects[dir] = objectPtr;
+        return;
+    }
+
+    // objects of other stores can't be linked
+    BodyStore::Handle handle;
+
+    if (objectPtr != nullptr && objectPtr->getBodyStorePtr() == _pimpl->_bodyStorePtr)
+        handle = _pimpl->_bodyStorePtr->getHandle(objectPtr->getBodyNum());
+
+    _pimpl->_bodyStorePtr->setLink(_pimpl->_bodyNum, dir, handle);
 }
 
 void PhysicalObject::resetContiguousObjects()
 {
+    if (_pimpl->_bodyStorePtr != nullptr)
+        _pimpl->_bodyStorePtr->resetLinks(_pimpl->_bodyNum);
+
     for (long num : Range(4))
         _pimpl->_contiguousObjects[num] = nullptr;
 }
 
-//void PhysicalObject::setIsStatic(bool isStatic)
-//{
-//    _pimpl->_isStatic = isStatic;
-//}
+void PhysicalObject::setIsSleeping(bool isSleeping)
+{
+    if (_pimpl->_bodyStorePtr != nullptr)
+        _pimpl->_bodyStorePtr->setIsSleeping(_pimpl->_bodyNum, isSleeping);
+    else
+        _pimpl->_isSleeping = isSleeping;
+
+    if (!isSleeping)
+        _pimpl->_quietFrameCount = 0;
+}
 
 //void PhysicalObject::setIsStand(bool isStand)
 //{
 //    _pimpl->_isStand = isStand;
 //}
 
-//void PhysicalObject::setStaticFrameCount(size_t count)
-//{
-//    _pimpl->_staticFrameCount = count;
-//}
+void PhysicalObject::setQuietFrameCount(size_t count)
+{
+    _pimpl->_quietFrameCount = count;
+}
 
 //void PhysicalObject::setLastPosition(const Point &position)
 //{
@@ -164,4 +229,44 @@ void PhysicalObject::resetContiguousObjects()
 //}
 
 
+void PhysicalObject::setGeometry(std::vector<Rectangle> geometry)
+{
+    _pimpl->_geometry = std::move(geometry);
+
+    // the store keeps its own copy of the geometry
+    if (_pimpl->_bodyStorePtr != nullptr)
+        _pimpl->_bodyStorePtr->updateBody(_pimpl->_bodyNum);
+}
+
+
+void PhysicalObject::setBody(BodyStore *bodyStorePtr, size_t bodyNum)
+{
+    // take the state back from the previous store
+    if (_pimpl->_bodyStorePtr != nullptr)
+    {
+        _pimpl->_position   = _pimpl->_bodyStorePtr->getPosition(_pimpl->_bodyNum);
+        _pimpl->_speed      = _pimpl->_bodyStorePtr->getSpeed(_pimpl->_bodyNum);
+        _pimpl->_isSleeping = _pimpl->_bodyStorePtr->isSleeping(_pimpl->_bodyNum);
+    }
+
+    // links of attached objects are kept by the store
+    if (_pimpl->_bodyStorePtr != bodyStorePtr)
+        for (long num : Range(4))
+            _pimpl->_contiguousObjects[num] = nullptr;
+
+    _pimpl->_bodyStorePtr = bodyStorePtr;
+    _pimpl->_bodyNum = bodyNum;
+}
+
+BodyStore *PhysicalObject::getBodyStorePtr() const
+{
+    return _pimpl->_bodyStorePtr;
+}
+
+size_t PhysicalObject::getBodyNum() const
+{
+    return _pimpl->_bodyNum;
+}
+
+
 }  // namespace Platformer
@@ -3,7 +3,10 @@
 #ifndef PHYSICALOBJECT_H
 #define PHYSICALOBJECT_H
 
+#include <vector>
+
 #include "geometry/Rectangle.h"
+#include "geometry/RectangleSpan.h"
 #include "game_object/GameObjectContainer.h"
 
 
@@ -22,9 +25,16 @@ public:
     virtual double getFrictionFactor() const;
     virtual double getHitRecoveryFactor() const;
     virtual bool isMovable() const;
+    virtual bool isSleeping() const;
+    virtual size_t getQuietFrameCount() const;
     virtual Point getPosition() const override;
     virtual Point getSpeed() const;
-    virtual RectangleIteratorPtr getGeometry() const;
+
+    // geometry in the object coordinates, the span doesn't allocate and
+    // is valid till the next setGeometry() call
+    RectangleIteratorPtr getGeometry() const;
+    RectangleSpan getGeometrySpan() const;
+
     virtual SimplePhysicalObjectPointer getContiguousObject(Direction dir) const;
 
     virtual void accept(GameObjectVisitor& visitor) override;
@@ -32,11 +42,20 @@ public:
     virtual void setSpeed(const Point &speed);
     virtual void setContiguousObject(Direction dir, SimplePhysicalObjectPointer objectPtr);
     virtual void resetContiguousObjects();
+    virtual void setIsSleeping(bool isSleeping);
+    virtual void setQuietFrameCount(size_t count);
 
 protected:
     PhysicalObject(const std::string &name = "[PhysicalObject]");
 
+    void setGeometry(std::vector<Rectangle> geometry);
+
 private:
+    // the state of attached object is kept in the body store
+    friend BodyStore;
+    void setBody(BodyStore *bodyStorePtr, size_t bodyNum);
+    BodyStore *getBodyStorePtr() const;
+    size_t getBodyNum() const;
 
     struct Impl;
     std::unique_ptr<Impl> _pimpl;
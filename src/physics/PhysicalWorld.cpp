@@ -53,17 +53,17 @@ void PhysicalWorld::setEnginePtr(const PhysicalEnginePointer &enginePtr)
 }
 
 
-void PhysicalWorld::doAddSubObject(GameObjectPointer /*subObjPtr*/)
+void PhysicalWorld::doAddSubObject(GameObjectPointer subObjPtr)
 {
     if (getEnginePtr() != nullptr)
-        getEnginePtr()->updateMetadata();
+        getEnginePtr()->addObject(subObjPtr);
 }
 
 
-void PhysicalWorld::doRemoveSubObject(GameObjectPointer /*subObjPtr*/)
+void PhysicalWorld::doRemoveSubObject(GameObjectPointer subObjPtr)
 {
     if (getEnginePtr() != nullptr)
-        getEnginePtr()->updateMetadata();
+        getEnginePtr()->removeObject(subObjPtr);
 }
 
 
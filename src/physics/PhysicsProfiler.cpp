@@ -0,0 +1,127 @@
+// PhysicsProfiler.cpp
+
+#include <stdexcept>
+
+#include "PhysicsProfiler.h"
+
+
+namespace Platformer
+{
+
+
+PhysicsProfiler::PhysicsProfiler(size_t frameCapacity)
+{
+    setFrameCapacity(frameCapacity);
+}
+
+
+PhysicsProfiler::~PhysicsProfiler() = default;
+
+
+const PhysicsProfiler::FrameRecord &PhysicsProfiler::getFrame(size_t num) const
+{
+    if (num >= _frameCount)
+        throw std::logic_error("PhysicsProfiler::getFrame: wrong frame number");
+
+    return _frames[(_firstFrameNum + num) % _frames.size()];
+}
+
+
+const PhysicsProfiler::FrameRecord &PhysicsProfiler::getLastFrame() const
+{
+    if (_frameCount == 0)
+        throw std::logic_error("PhysicsProfiler::getLastFrame: no frames are recorded");
+
+    return getFrame(_frameCount - 1);
+}
+
+
+const char *PhysicsProfiler::getPhaseName(Phase phase)
+{
+    static const char *PHASE_NAMES[PhaseCount]
+            = {"physical rules", "pre-process", "pair search", "narrow phase", "resolution", "post-process"};
+
+    if (phase >= PhaseCount)
+        throw std::logic_error("PhysicsProfiler::getPhaseName: wrong phase");
+
+    return PHASE_NAMES[phase];
+}
+
+
+const char *PhysicsProfiler::getCounterName(Counter counter)
+{
+    static const char *COUNTER_NAMES[CounterCount]
+            = {"pairs", "rectangles", "iterations", "collisions", "sub-steps"};
+
+    if (counter >= CounterCount)
+        throw std::logic_error("PhysicsProfiler::getCounterName: wrong counter");
+
+    return COUNTER_NAMES[counter];
+}
+
+
+void PhysicsProfiler::setEnabled(bool isEnabled)
+{
+    _isEnabled = isEnabled;
+    _isFrameStarted = false;
+}
+
+
+void PhysicsProfiler::setFrameCapacity(size_t frameCapacity)
+{
+    if (frameCapacity == 0)
+        throw std::logic_error("PhysicsProfiler::setFrameCapacity: capacity is zero");
+
+    _frames.assign(frameCapacity, FrameRecord());
+    clear();
+}
+
+
+void PhysicsProfiler::clear()
+{
+    _firstFrameNum = 0;
+    _frameCount = 0;
+}
+
+
+void PhysicsProfiler::beginFrame()
+{
+    if (!_isEnabled)
+        return;
+
+    _currentFrame = FrameRecord();
+    _currentFrame._frameNum = _totalFrameCount;
+    _frameStartPoint = Clock::now();
+    _isFrameStarted = true;
+}
+
+
+void PhysicsProfiler::endFrame()
+{
+    // the profiler could be enabled in the middle of the frame
+    if (!_isEnabled || !_isFrameStarted)
+        return;
+
+    _currentFrame._frameTime = std::chrono::duration<double>(Clock::now() - _frameStartPoint).count();
+    _isFrameStarted = false;
+    ++_totalFrameCount;
+
+    // the oldest frame is overwritten, when the buffer is full
+    if (_frameCount < _frames.size())
+        _frames[(_firstFrameNum + _frameCount++) % _frames.size()] = _currentFrame;
+    else
+    {
+        _frames[_firstFrameNum] = _currentFrame;
+        _firstFrameNum = (_firstFrameNum + 1) % _frames.size();
+    }
+}
+
+
+void PhysicsProfiler::addStep()
+{
+    if (_isEnabled)
+        ++_currentFrame._stepCount;
+}
+
+
+}  // namespace Platformer
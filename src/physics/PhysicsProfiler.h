@@ -0,0 +1,160 @@
+// PhysicsProfiler.h
+
+#ifndef PHYSICSPROFILER_H
+#define PHYSICSPROFILER_H
+
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+#include "Types.h"
+#include "platform/TraceRecorder.h"
+
+
+namespace Platformer
+{
+
+
+// Phase times & counters of the last processWorld() calls kept in a ring
+// buffer. A disabled profiler records nothing, its timers & counters only
+// check the flag.
+class PhysicsProfiler
+{
+public:
+    enum Phase
+    {
+        PhysicalRulesPhase,
+        PreProcessPhase,
+        PairSearchPhase,
+        NarrowPhase,
+        ResolutionPhase,
+        PostProcessPhase,
+        PhaseCount
+    };
+
+    enum Counter
+    {
+        PairTestCounter,
+        RectangleTestCounter,
+        IterationCounter,
+        CollisionCounter,
+        SubStepCounter,
+        CounterCount
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    // one processWorld() call, it can make several engine steps
+    struct FrameRecord
+    {
+        uint64_t _frameNum = 0;
+        size_t _stepCount = 0;
+        double _frameTime = 0;
+        double _phaseTimes[PhaseCount] = {};
+        size_t _counts[CounterCount] = {};
+    };
+
+    // Adds the time of the enclosing scope to the phase, switchPhase()
+    // passes the time measured so far to the current phase. Phases are
+    // recorded as trace events too, when the trace recorder is enabled.
+    class PhaseTimer
+    {
+    public:
+        inline PhaseTimer(PhysicsProfiler &profiler, Phase phase)
+            : _profilerPtr(profiler.isEnabled() ? &profiler : nullptr)
+            , _isTraced(TraceRecorder::isEnabled())
+            , _phase(phase)
+        {
+            if (_profilerPtr != nullptr || _isTraced)
+                _startPoint = Clock::now();
+        }
+
+        inline ~PhaseTimer()
+        {
+            if (_profilerPtr != nullptr || _isTraced)
+                finishPhase(Clock::now());
+        }
+
+        inline void switchPhase(Phase phase)
+        {
+            if (_profilerPtr != nullptr || _isTraced)
+            {
+                Clock::time_point timePoint = Clock::now();
+                finishPhase(timePoint);
+                _startPoint = timePoint;
+            }
+
+            _phase = phase;
+        }
+
+        PhaseTimer(const PhaseTimer&) = delete;
+        PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+    private:
+        inline void finishPhase(Clock::time_point endPoint)
+        {
+            if (_profilerPtr != nullptr)
+                _profilerPtr->addPhaseTime(_phase, _startPoint, endPoint);
+
+            if (_isTraced)
+                TraceRecorder::instance()->addEvent(getPhaseName(_phase), "physics", _startPoint, endPoint);
+        }
+
+        PhysicsProfiler *_profilerPtr;
+        bool _isTraced;
+        Phase _phase;
+        Clock::time_point _startPoint;
+    };
+
+    PhysicsProfiler(size_t frameCapacity = 120);
+    ~PhysicsProfiler();
+
+    inline bool isEnabled() const       { return _isEnabled; }
+    inline size_t getFrameCapacity() const { return _frames.size(); }
+    inline size_t getFrameCount() const { return _frameCount; }
+
+    // frames from the oldest one, the last one is the latest
+    const FrameRecord &getFrame(size_t num) const;
+    const FrameRecord &getLastFrame() const;
+
+    static const char *getPhaseName(Phase phase);
+    static const char *getCounterName(Counter counter);
+
+    // recorded frames are dropped by capacity change
+    void setEnabled(bool isEnabled);
+    void setFrameCapacity(size_t frameCapacity);
+    void clear();
+
+    void beginFrame();
+    void endFrame();
+    void addStep();
+
+    inline void addCount(Counter counter, size_t count)
+    {
+        if (_isEnabled)
+            _currentFrame._counts[counter] += count;
+    }
+
+    inline void addPhaseTime(Phase phase, Clock::time_point startPoint, Clock::time_point endPoint)
+    {
+        _currentFrame._phaseTimes[phase] += std::chrono::duration<double>(endPoint - startPoint).count();
+    }
+
+private:
+    bool _isEnabled = false;
+    bool _isFrameStarted = false;
+
+    // ring buffer, _firstFrameNum is the place of the oldest frame
+    std::vector<FrameRecord> _frames;
+    size_t _firstFrameNum = 0;
+    size_t _frameCount = 0;
+    uint64_t _totalFrameCount = 0;
+
+    FrameRecord _currentFrame;
+    Clock::time_point _frameStartPoint;
+};
+
+
+}  // namespace Platformer
+
+#endif  // PHYSICSPROFILER_H
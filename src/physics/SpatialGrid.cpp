@@ -0,0 +1,196 @@
+// SpatialGrid.cpp
+
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+#include "SpatialGrid.h"
+
+
+namespace Platformer
+{
+
+
+SpatialGrid::SpatialGrid(double cellSize)
+{
+    setCellSize(cellSize);
+}
+
+
+SpatialGrid::~SpatialGrid()
+{
+}
+
+
+void SpatialGrid::setCellSize(double cellSize)
+{
+    if (!(cellSize > 0))
+        throw std::logic_error("SpatialGrid::setCellSize: cell size must be positive");
+
+    _cellSize = cellSize;
+    clear();
+}
+
+
+void SpatialGrid::setBox(size_t bodyNum, const BoundingBox &box)
+{
+    if (bodyNum >= _entries.size())
+    {
+        _entries.resize(bodyNum + 1);
+        _queryStamps.resize(bodyNum + 1, 0);
+    }
+
+    Entry &entry = _entries[bodyNum];
+    const CellRange cellRange = getCellRange(box);
+    entry._box = box;
+
+    if (cellRange == entry._cellRange)
+        return;
+
+    removeFromCells(bodyNum);
+    entry._cellRange = cellRange;
+    addToCells(bodyNum);
+}
+
+
+void SpatialGrid::clear()
+{
+    // cells keep their memory for the next bodies
+    for (auto &cell : _cells)
+        cell.second.clear();
+
+    _entries.clear();
+    _largeBodyNums.clear();
+    _queryStamps.clear();
+}
+
+
+void SpatialGrid::findBodies(const BoundingBox &box, std::vector<size_t> &bodyNums) const
+{
+    bodyNums.clear();
+    const CellRange cellRange = getCellRange(box);
+
+    if (cellRange.isEmpty())
+        return;
+
+    ++_queryStamp;
+
+    auto addBody = [this, &box, &bodyNums](size_t bodyNum)
+    {
+        if (_queryStamps[bodyNum] != _queryStamp && _entries[bodyNum]._box.isCollided(box))
+            bodyNums.push_back(bodyNum);
+
+        _queryStamps[bodyNum] = _queryStamp;
+    };
+
+    for (size_t bodyNum : _largeBodyNums)
+        addBody(bodyNum);
+
+    // a box larger than the grid is tested against all cells
+    const double cellCount = (static_cast<double>(cellRange._right) - cellRange._left + 1)
+                           * (static_cast<double>(cellRange._bottom) - cellRange._top + 1);
+
+    if (cellCount > _cells.size())
+    {
+        for (const auto &cell : _cells)
+            for (size_t bodyNum : cell.second)
+                addBody(bodyNum);
+
+        return;
+    }
+
+    for (long cellX = cellRange._left; cellX <= cellRange._right; ++cellX)
+        for (long cellY = cellRange._top; cellY <= cellRange._bottom; ++cellY)
+        {
+            auto cellIt = _cells.find(getCellKey(cellX, cellY));
+
+            if (cellIt != _cells.end())
+                for (size_t bodyNum : cellIt->second)
+                    addBody(bodyNum);
+        }
+}
+
+
+long SpatialGrid::getCellNum(double coordinate) const
+{
+    return static_cast<long>(std::floor(coordinate / _cellSize));
+}
+
+
+SpatialGrid::CellKey SpatialGrid::getCellKey(long cellX, long cellY) const
+{
+    return (static_cast<CellKey>(static_cast<uint32_t>(cellX)) << 32) | static_cast<uint32_t>(cellY);
+}
+
+
+SpatialGrid::CellRange SpatialGrid::getCellRange(const BoundingBox &box) const
+{
+    CellRange cellRange;
+
+    if (box.isEmpty())
+        return cellRange;
+
+    cellRange._left   = getCellNum(box.getLeft());
+    cellRange._top    = getCellNum(box.getTop());
+    cellRange._right  = getCellNum(box.getRight());
+    cellRange._bottom = getCellNum(box.getBottom());
+    return cellRange;
+}
+
+
+void SpatialGrid::addToCells(size_t bodyNum)
+{
+    Entry &entry = _entries[bodyNum];
+    const CellRange &cellRange = entry._cellRange;
+
+    if (cellRange.isEmpty())
+        return;
+
+    entry._isLarge = (cellRange._right - cellRange._left + 1) * (cellRange._bottom - cellRange._top + 1)
+                   > MAX_BODY_CELL_COUNT;
+
+    if (entry._isLarge)
+    {
+        _largeBodyNums.push_back(bodyNum);
+        return;
+    }
+
+    for (long cellX = cellRange._left; cellX <= cellRange._right; ++cellX)
+        for (long cellY = cellRange._top; cellY <= cellRange._bottom; ++cellY)
+            _cells[getCellKey(cellX, cellY)].push_back(bodyNum);
+}
+
+
+void SpatialGrid::removeFromCells(size_t bodyNum)
+{
+    const Entry &entry = _entries[bodyNum];
+    const CellRange &cellRange = entry._cellRange;
+
+    if (cellRange.isEmpty())
+        return;
+
+    if (entry._isLarge)
+    {
+        removeBodyNum(_largeBodyNums, bodyNum);
+        return;
+    }
+
+    for (long cellX = cellRange._left; cellX <= cellRange._right; ++cellX)
+        for (long cellY = cellRange._top; cellY <= cellRange._bottom; ++cellY)
+            removeBodyNum(_cells[getCellKey(cellX, cellY)], bodyNum);
+}
+
+
+void SpatialGrid::removeBodyNum(std::vector<size_t> &bodyNums, size_t bodyNum)
+{
+    auto bodyNumIt = std::find(bodyNums.begin(), bodyNums.end(), bodyNum);
+
+    if (bodyNumIt == bodyNums.end())
+        return;
+
+    *bodyNumIt = bodyNums.back();
+    bodyNums.pop_back();
+}
+
+
+}  // namespace Platformer
@@ -0,0 +1,90 @@
+// SpatialGrid.h
+
+#ifndef SPATIALGRID_H
+#define SPATIALGRID_H
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include "Types.h"
+#include "geometry/BoundingBox.h"
+
+
+namespace Platformer
+{
+
+
+// Uniform grid of body bounds for area queries. A body is kept in the cells
+// its bounds cover and is moved between cells only when the covered range
+// changes, so updates of resting bodies are free. Bodies covering too many
+// cells are kept in one list, that every query tests.
+class SpatialGrid
+{
+public:
+    SpatialGrid(double cellSize = 128);
+    ~SpatialGrid();
+
+    inline double getCellSize() const  { return _cellSize; }
+    inline size_t getBodyCount() const { return _entries.size(); }
+
+    // bodies are dropped by cell size change
+    void setCellSize(double cellSize);
+
+    // adds the body or moves it, bodies with empty bounds are never found
+    void setBox(size_t bodyNum, const BoundingBox &box);
+    void clear();
+
+    // numbers of bodies with bounds overlapping the box in no order
+    void findBodies(const BoundingBox &box, std::vector<size_t> &bodyNums) const;
+
+private:
+    using CellKey = uint64_t;
+
+    // range of covered cells, the range of a body out of cells is empty
+    struct CellRange
+    {
+        long _left = 0, _top = 0, _right = -1, _bottom = -1;
+
+        inline bool operator==(const CellRange &other) const
+        {
+            return _left == other._left && _top == other._top
+                    && _right == other._right && _bottom == other._bottom;
+        }
+
+        inline bool isEmpty() const { return _left > _right || _top > _bottom; }
+    };
+
+    struct Entry
+    {
+        BoundingBox _box;
+        CellRange _cellRange;
+        bool _isLarge = false;
+    };
+
+    long getCellNum(double coordinate) const;
+    CellKey getCellKey(long cellX, long cellY) const;
+    CellRange getCellRange(const BoundingBox &box) const;
+    void addToCells(size_t bodyNum);
+    void removeFromCells(size_t bodyNum);
+    static void removeBodyNum(std::vector<size_t> &bodyNums, size_t bodyNum);
+
+private:
+    double _cellSize = 128;
+    std::unordered_map<CellKey, std::vector<size_t> > _cells;
+    std::vector<Entry> _entries;
+    std::vector<size_t> _largeBodyNums;
+
+    // bodies found by the current query, so bodies of several cells are
+    // reported once
+    mutable std::vector<uint64_t> _queryStamps;
+    mutable uint64_t _queryStamp = 0;
+
+    // constants
+    static const long MAX_BODY_CELL_COUNT = 256;
+};
+
+
+}  // namespace Platformer
+
+#endif  // SPATIALGRID_H
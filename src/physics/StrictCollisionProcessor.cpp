@@ -2,13 +2,20 @@
 
 #include <assert.h>
 #include <vector>
+#include <algorithm>
 
 #include "Iterator.h"
 #include "geometry/Point.h"
+#include "platform/TraceRecorder.h"
 #include "PhysicalObject.h"
 #include "PhysicalWorld.h"
 #include "PhysicalEngine.h"
-#include "visitor/SimpleHierarchicalVisitor.h"
+#include "BodyStore.h"
+#include "ContactCache.h"
+#include "PhysicsProfiler.h"
+#include "SweepAndPruneBroadPhase.h"
+#include "BoundingVolumeHierarchy.h"
+#include "WorkerPool.h"
 #include "StrictCollisionProcessor.h"
 
 
@@ -26,6 +33,12 @@ struct ObjectMetadata
     SimplePhysicalObjectPointer _objectPtr = nullptr;
     size_t _lastConnectionNum = 0;
     Point _lastPosition;
+
+    // static objects don't move by themselves, their bounds are kept in
+    // the hierarchy built by updateStaticGeometry(), ones given a speed
+    // become dynamic at the frame start
+    bool _isStatic = false;
+    size_t _dynamicNum = 0;
 };
 
 
@@ -36,6 +49,19 @@ struct CollisionInfo
     double _timeRate = 1;
     bool _hasCollision = false;
     Direction _direction = Right;
+
+    // number of the candidate pair, the earlier pair wins at equal times
+    size_t _pairNum = 0;
+
+    // rectangle pairs tested to find the collision, they are profiled
+    size_t _rectTestCount = 0;
+
+    inline bool isEarlierThan(const CollisionInfo &other) const
+    {
+        return _hasCollision
+            && (   !other._hasCollision || _timeRate < other._timeRate
+                || (_timeRate == other._timeRate && _pairNum < other._pairNum));
+    }
 };
 
 
@@ -46,24 +72,25 @@ struct StrictCollisionProcessor::Impl
     void doPreProcess(double frameTimeSec);
     void processCollisions(double fullframeTimeSec);
     void doPostProcess(double frameTimeSec);
+    void projectRestFrame(double frameTimeSec);
 
     // procedures
     void processCollision(const CollisionInfo &collision, double frameTimeSec);
     void activate(ObjectMetadata *metadataPtr,
                   ObjectMetadata *parentMetadataPtr);
     void processStand(ObjectMetadata *metadataPtr);
+    void addObject(size_t objectNum);
+    bool isStaticObject(size_t objectNum) const;
+    void addDynamicObject(size_t objectNum);
+    void removeDynamicObject(size_t dynamicNum);
+    void updateStaticGeometry();
+    void updateProxies(double frameTimeSec);
+    void findCandidatePairs();
 
     // functions
+    CollisionInfo findEarliestCollision(size_t firstPairNum, size_t pairCount, double frameTimeSec);
     CollisionInfo findCollisionBetween(size_t lessObjectNum, size_t greaterObjectNum, double frameTimeSec);
-
-    void solvePlatformHit(double objectSpeed, double PlatformSpeed,
-                          double speedRecoveryFactor,
-                          double &newObjectSpeed) const;
-
-    void solveCentralHit(double firstObjectSpeed,       double firstObjectMass,
-                         double secondObjectSpeed,      double secondObjectMass,
-                         double speedRecoveryFactor,
-                         double &newFirstObjectSpeed,   double &newSecondObjectSpeed) const;
+    CollisionInfo findStaticCollisionBetween(size_t lessObjectNum, size_t greaterObjectNum, double frameTimeSec);
 
 
     inline double abs(double value)
@@ -83,14 +110,40 @@ struct StrictCollisionProcessor::Impl
 
 
     // data members
-    PhysicalWorldPointer _worldPtr;
-    SimpleHierarchicalVisitorPointer<PhysicalObject> _objectCollectorPtr;
+    StrictCollisionProcessor *_processorPtr = nullptr;
+    BodyStore *_bodyStorePtr = nullptr;
+    ContactCache *_contactCachePtr = nullptr;
+    PhysicsProfiler *_profilerPtr = nullptr;
+
+    // object numbers are the same as body numbers in the store
     std::vector<ObjectMetadata> _objectVect;
-    size_t _totalConnectionCount;
+    size_t _totalConnectionCount = 0;
+
+    // static & dynamic objects, static geometry is rebuilt lazily
+    std::vector<size_t> _dynamicObjectNums;
+    bool _isStaticGeometryDirty = false;
+    BoundingVolumeHierarchy _staticHierarchy;
+
+    // broad phase, proxies are built for dynamic objects only
+    BroadPhasePointer _broadPhasePtr;
+    std::vector<BroadPhase::Proxy> _proxies;
+    std::vector<BroadPhase::Pair> _proxyPairs;
+    std::vector<size_t> _foundStaticObjectNums;
+    std::vector<BroadPhase::Pair> _candidatePairs;
+
+    // narrow phase, candidate pairs are split into ranges between threads
+    WorkerPool _workerPool;
+    std::vector<CollisionInfo> _rangeCollisions;
+    size_t _rangePairCount = 0;
+    double _rangeFrameTimeSec = 0;
+
+    // the task is made once, so the pool runs don't allocate
+    WorkerPool::Task _rangeTask;
 
     // constants
-    const double ABSOLUTE_TIME_ERROR  = 0.0001;
+    const double ABSOLUTE_TIME_ERROR  = CollisionProcessor::getAbsoluteTimeError();
     const double DOUBLE_COMPARE_ERROR = 0.0001;
+    const size_t MIN_RANGE_PAIR_COUNT = 64;
     // const size_t STATIC_FRAME_COUNT   = 50;
 };
 
@@ -101,13 +154,19 @@ StrictCollisionProcessor::StrictCollisionProcessor(SimplePhysicalEnginePointer e
     : CollisionProcessor(enginePtr)
     , _pimpl(new Impl())
 {
-    _pimpl->_worldPtr = getEnginePtr()->getWorldPtr();
+    _pimpl->_processorPtr = this;
 
-    _pimpl->_objectCollectorPtr.reset(new SimpleHierarchicalVisitor<PhysicalObject>
-                                      ([this](PhysicalObject &object)
+    Impl *implPtr = _pimpl.get();
+    _pimpl->_rangeTask = [implPtr](size_t rangeNum, size_t /*threadNum*/)
     {
-        _pimpl->_objectVect.emplace_back(&object);
-    }));
+        TraceRecorder::Scope scope("narrow range", "physics");
+        size_t firstPairNum = std::min(rangeNum * implPtr->_rangePairCount, implPtr->_candidatePairs.size());
+        size_t pairCount = std::min(implPtr->_rangePairCount, implPtr->_candidatePairs.size() - firstPairNum);
+
+        implPtr->_rangeCollisions[rangeNum]
+                = implPtr->findEarliestCollision(firstPairNum, pairCount, implPtr->_rangeFrameTimeSec);
+    };
+    _pimpl->_broadPhasePtr = std::make_shared<SweepAndPruneBroadPhase>();
 }
 
 StrictCollisionProcessor::StrictCollisionProcessor(StrictCollisionProcessor&& /*other*/) = default;
@@ -115,40 +174,145 @@ StrictCollisionProcessor& StrictCollisionProcessor::operator=(StrictCollisionPro
 StrictCollisionProcessor::~StrictCollisionProcessor() = default;
 
 
+BroadPhasePointer StrictCollisionProcessor::getBroadPhasePtr() const
+{
+    return _pimpl->_broadPhasePtr;
+}
+
+
+void StrictCollisionProcessor::setBroadPhasePtr(BroadPhasePointer broadPhasePtr)
+{
+    if (broadPhasePtr == nullptr)
+        throw std::logic_error("StrictCollisionProcessor::setBroadPhasePtr: broad phase is null");
+
+    _pimpl->_broadPhasePtr = broadPhasePtr;
+}
+
+
 void StrictCollisionProcessor::updateMetadata()
 {
     if (getEnginePtr()->getWorldPtr() == nullptr)
         throw std::logic_error("PhysicalEngine::updateObjectCache: world is not set");
 
+    _pimpl->_bodyStorePtr = &getEnginePtr()->getBodyStore();
+    _pimpl->_contactCachePtr = &getEnginePtr()->getContactCache();
     _pimpl->_objectVect.clear();
-    _pimpl->_objectCollectorPtr->visit(getEnginePtr()->getWorldPtr()->getSubObjects());
+    _pimpl->_dynamicObjectNums.clear();
+
+    for (size_t bodyNum = 0; bodyNum < _pimpl->_bodyStorePtr->getBodyCount(); ++bodyNum)
+        _pimpl->addObject(bodyNum);
+
+    _pimpl->updateStaticGeometry();
 }
 
 
-void StrictCollisionProcessor::processFrame(double frameTimeSec)
+void StrictCollisionProcessor::addBody(size_t bodyNum)
 {
-    //std::cout << "StrictCollisionProcessor::processFrame" << std::endl;
+    _pimpl->_bodyStorePtr = &getEnginePtr()->getBodyStore();
+    _pimpl->_contactCachePtr = &getEnginePtr()->getContactCache();
+
+    if (bodyNum != _pimpl->_objectVect.size())
+        throw std::logic_error("StrictCollisionProcessor::addBody: wrong body number");
+
+    _pimpl->addObject(bodyNum);
+}
+
+
+void StrictCollisionProcessor::removeBody(size_t bodyNum)
+{
+    std::vector<ObjectMetadata> &objectVect = _pimpl->_objectVect;
+
+    if (bodyNum >= objectVect.size())
+        throw std::logic_error("StrictCollisionProcessor::removeBody: wrong body number");
+
+    if (objectVect[bodyNum]._isStatic)
+        _pimpl->_isStaticGeometryDirty = true;
+    else
+        _pimpl->removeDynamicObject(objectVect[bodyNum]._dynamicNum);
+
+    // the last object takes the number of the removed one
+    const size_t lastNum = objectVect.size() - 1;
+
+    if (bodyNum != lastNum)
+    {
+        objectVect[bodyNum] = objectVect[lastNum];
+
+        if (objectVect[bodyNum]._isStatic)
+            _pimpl->_isStaticGeometryDirty = true;
+        else
+            _pimpl->_dynamicObjectNums[objectVect[bodyNum]._dynamicNum] = bodyNum;
+    }
+
+    objectVect.pop_back();
+}
+
+
+void StrictCollisionProcessor::beginFrame(double frameTimeSec)
+{
+    //std::cout << "StrictCollisionProcessor::beginFrame" << std::endl;
+
+    _pimpl->_workerPool.setThreadCount(getEnginePtr()->getThreadCount());
+    _pimpl->_profilerPtr = &getEnginePtr()->getProfiler();
+
+    PhysicsProfiler::PhaseTimer timer(*_pimpl->_profilerPtr, PhysicsProfiler::PreProcessPhase);
+
+    // static objects moved outside of the engine rebuild the hierarchy,
+    // ones given a speed by themselves or by ancestors become dynamic
+    for (size_t objectNum = 0; objectNum < _pimpl->_objectVect.size(); ++objectNum)
+    {
+        if (!_pimpl->_objectVect[objectNum]._isStatic)
+            continue;
+
+        if (!_pimpl->isStaticObject(objectNum))
+        {
+            _pimpl->addDynamicObject(objectNum);
+            _pimpl->_isStaticGeometryDirty = true;
+        }
+        else if (_pimpl->_bodyStorePtr->updateGeometry(objectNum))
+        {
+            _pimpl->_isStaticGeometryDirty = true;
+        }
+    }
+
+    if (_pimpl->_isStaticGeometryDirty)
+        _pimpl->updateStaticGeometry();
+
+    // resting contacts of the last frame are solved together
+    timer.switchPhase(PhysicsProfiler::ResolutionPhase);
+    solveContacts(frameTimeSec);
 
     // update state of object metadata & other service actions
+    timer.switchPhase(PhysicsProfiler::PreProcessPhase);
     _pimpl->doPreProcess(frameTimeSec);
+    linkContacts();
+    startBudget();
+}
 
+
+void StrictCollisionProcessor::processSubStep(double subStepTimeSec)
+{
     // collision checking & processing
-    _pimpl->processCollisions(frameTimeSec);
+    _pimpl->processCollisions(subStepTimeSec);
 
     // error recovery
-    // _pimpl->doPostProcess(frameTimeSec);
+    // _pimpl->doPostProcess(subStepTimeSec);
 }
 
 
 void StrictCollisionProcessor::Impl::doPreProcess(double /*frameTimeSec*/)
 {
-    for (ObjectMetadata &metadata : _objectVect)
+    _totalConnectionCount = 0;
+
+    for (size_t objectNum = 0; objectNum < _objectVect.size(); ++objectNum)
     {
-        // reset contiguous objects
-        metadata._objectPtr->resetContiguousObjects();
+        ObjectMetadata &metadata = _objectVect[objectNum];
+
+        // reset contiguous objects, sleeping ones keep their island links
+        if (!_bodyStorePtr->isSleeping(objectNum))
+            metadata._objectPtr->resetContiguousObjects();
 
         // remember current position
-        metadata._lastPosition = metadata._objectPtr->getPosition();
+        metadata._lastPosition = _bodyStorePtr->getPosition(objectNum);
 
         // reset last connection number
         metadata._lastConnectionNum = 0;
@@ -158,41 +322,73 @@ void StrictCollisionProcessor::Impl::doPreProcess(double /*frameTimeSec*/)
 
 void StrictCollisionProcessor::Impl::processCollisions(double fullframeTimeSec)
 {
-    _totalConnectionCount = 0;
-    size_t iterationCount = 0;
     double restFrameTimeSec = fullframeTimeSec;
+    PhysicsProfiler::PhaseTimer timer(*_profilerPtr, PhysicsProfiler::PairSearchPhase);
 
-    for (bool hasCollision = true; hasCollision; ++iterationCount)  // TODO: limit iteration count
+    for (bool hasCollision = true; hasCollision; )
     {
-        // find the earliest collision
+        // stalled frames are finished approximately
+        if (_processorPtr->isBudgetSpent())
+        {
+            timer.switchPhase(PhysicsProfiler::ResolutionPhase);
+            projectRestFrame(restFrameTimeSec);
+            break;
+        }
+
+        // find pairs with overlapping swept bounds
+        timer.switchPhase(PhysicsProfiler::PairSearchPhase);
+        updateProxies(restFrameTimeSec);
+        findCandidatePairs();
+        timer.switchPhase(PhysicsProfiler::NarrowPhase);
+
+        // find the earliest collision, pair tests only read object state,
+        // so ranges of pairs are tested in parallel
+        const size_t threadCount = _workerPool.getThreadCount();
+        const size_t rangeCount = std::max<size_t>(1, std::min(threadCount * 4,
+                                  _candidatePairs.size() / MIN_RANGE_PAIR_COUNT));
+        const size_t rangePairCount = (_candidatePairs.size() + rangeCount - 1) / rangeCount;
+
+        _rangeCollisions.assign(rangeCount, CollisionInfo());
+        _rangePairCount = rangePairCount;
+        _rangeFrameTimeSec = restFrameTimeSec;
+
+        _workerPool.run(rangeCount, _rangeTask);
+
         CollisionInfo earliestCollision;
+        size_t rectTestCount = 0;
 
-        for (size_t lessObjectNum = 0; lessObjectNum < _objectVect.size(); ++lessObjectNum)
-            for (size_t greaterObectNum = lessObjectNum + 1; greaterObectNum < _objectVect.size(); ++greaterObectNum)
-            {
-                CollisionInfo possibleCollision = findCollisionBetween(lessObjectNum, greaterObectNum, restFrameTimeSec);
+        for (const CollisionInfo &rangeCollision : _rangeCollisions)
+        {
+            rectTestCount += rangeCollision._rectTestCount;
 
-                if (possibleCollision._hasCollision && possibleCollision._timeRate < earliestCollision._timeRate)
-                    earliestCollision = possibleCollision;
-            }
+            if (rangeCollision.isEarlierThan(earliestCollision))
+                earliestCollision = rangeCollision;
+        }
 
         // process collision
+        timer.switchPhase(PhysicsProfiler::ResolutionPhase);
         hasCollision = earliestCollision._hasCollision;
+        _profilerPtr->addCount(PhysicsProfiler::IterationCounter, 1);
+        _profilerPtr->addCount(PhysicsProfiler::PairTestCounter, _candidatePairs.size());
+        _profilerPtr->addCount(PhysicsProfiler::RectangleTestCounter, rectTestCount);
+        _profilerPtr->addCount(PhysicsProfiler::CollisionCounter, hasCollision ? 1 : 0);
 
         if (hasCollision)
             processCollision(earliestCollision, restFrameTimeSec);
 
-        // move objects to collision moment
-        for (size_t objectNum = 0; objectNum < _objectVect.size(); ++objectNum)
-            if (objectNum != earliestCollision._lessObjectNum
-                    && objectNum != earliestCollision._greaterObectNum)
+        // move objects to collision moment, the hit ones are moved by
+        // processCollision()
+        for (size_t objectNum : _dynamicObjectNums)
+            if (   (   !hasCollision
+                    || (   objectNum != earliestCollision._lessObjectNum
+                        && objectNum != earliestCollision._greaterObectNum))
+                && !_bodyStorePtr->isSleeping(objectNum))
             {
-                ObjectMetadata *metadataPtr = &_objectVect[objectNum];
-                SimplePhysicalObjectPointer objPtr = metadataPtr->_objectPtr;
+                Point shift = _bodyStorePtr->getSpeed(objectNum) * restFrameTimeSec * earliestCollision._timeRate;
 
-                //if (!metadataPtr->_isStatic)
-                objPtr->setPosition(objPtr->getPosition()
-                                    + objPtr->getSpeed() * restFrameTimeSec * earliestCollision._timeRate);
+                _bodyStorePtr->setPosition(objectNum,
+                                           _bodyStorePtr->getX(objectNum) + shift.getX(),
+                                           _bodyStorePtr->getY(objectNum) + shift.getY());
             }
 
         restFrameTimeSec *= (1 - earliestCollision._timeRate);
@@ -200,6 +396,127 @@ void StrictCollisionProcessor::Impl::processCollisions(double fullframeTimeSec)
 }
 
 
+void StrictCollisionProcessor::Impl::addObject(size_t objectNum)
+{
+    _objectVect.emplace_back(_bodyStorePtr->getObjectPtr(objectNum));
+    ObjectMetadata &metadata = _objectVect.back();
+
+    metadata._isStatic = isStaticObject(objectNum);
+
+    if (metadata._isStatic)
+        _isStaticGeometryDirty = true;
+    else
+        addDynamicObject(objectNum);
+}
+
+
+bool StrictCollisionProcessor::Impl::isStaticObject(size_t objectNum) const
+{
+    // sub-objects are moved together with their ancestors
+    for (size_t bodyNum = objectNum; bodyNum != BodyStore::NO_BODY; bodyNum = _bodyStorePtr->getParentNum(bodyNum))
+    {
+        if (_bodyStorePtr->isMovable(bodyNum) || _bodyStorePtr->getSpeedX(bodyNum) != 0 || _bodyStorePtr->getSpeedY(bodyNum) != 0)
+            return false;
+    }
+
+    return true;
+}
+
+
+void StrictCollisionProcessor::Impl::addDynamicObject(size_t objectNum)
+{
+    ObjectMetadata &metadata = _objectVect[objectNum];
+
+    metadata._isStatic = false;
+    metadata._dynamicNum = _dynamicObjectNums.size();
+    _dynamicObjectNums.push_back(objectNum);
+}
+
+
+void StrictCollisionProcessor::Impl::removeDynamicObject(size_t dynamicNum)
+{
+    const size_t lastDynamicNum = _dynamicObjectNums.size() - 1;
+
+    _dynamicObjectNums[dynamicNum] = _dynamicObjectNums[lastDynamicNum];
+    _objectVect[_dynamicObjectNums[dynamicNum]]._dynamicNum = dynamicNum;
+    _dynamicObjectNums.pop_back();
+}
+
+
+void StrictCollisionProcessor::Impl::updateStaticGeometry()
+{
+    _isStaticGeometryDirty = false;
+
+    std::vector<BoundingVolumeHierarchy::Item> staticItems;
+
+    for (size_t objectNum = 0; objectNum < _objectVect.size(); ++objectNum)
+    {
+        if (!_objectVect[objectNum]._isStatic)
+            continue;
+
+        _bodyStorePtr->updateGeometry(objectNum);
+        const BoundingBox &box = _bodyStorePtr->getBox(objectNum);
+
+        if (!box.isEmpty())
+            staticItems.emplace_back(box, objectNum);
+    }
+
+    _staticHierarchy.build(std::move(staticItems));
+}
+
+
+void StrictCollisionProcessor::Impl::updateProxies(double frameTimeSec)
+{
+    _proxies.resize(_dynamicObjectNums.size());
+
+    for (size_t proxyNum = 0; proxyNum < _dynamicObjectNums.size(); ++proxyNum)
+    {
+        const size_t objectNum = _dynamicObjectNums[proxyNum];
+        BroadPhase::Proxy &proxy = _proxies[proxyNum];
+
+        // sweep the box over the [-ABSOLUTE_TIME_ERROR, 1] time rate range,
+        // that findCollisionBetween accepts, world geometry is recomputed
+        // for moved objects only
+        _bodyStorePtr->updateSweptBox(objectNum, _bodyStorePtr->getSpeed(objectNum) * frameTimeSec,
+                                      ABSOLUTE_TIME_ERROR, DOUBLE_COMPARE_ERROR);
+        proxy._isActive = _bodyStorePtr->isActive(objectNum);
+        proxy._box = _bodyStorePtr->getSweptBox(objectNum);
+    }
+}
+
+
+void StrictCollisionProcessor::Impl::findCandidatePairs()
+{
+    _candidatePairs.clear();
+
+    // dynamic vs dynamic objects
+    _broadPhasePtr->findPairs(_proxies, _proxyPairs);
+
+    for (const BroadPhase::Pair &pair : _proxyPairs)
+        _candidatePairs.emplace_back(_dynamicObjectNums[pair.first], _dynamicObjectNums[pair.second]);
+
+    // dynamic vs static objects
+    for (size_t proxyNum = 0; proxyNum < _proxies.size(); ++proxyNum)
+    {
+        size_t objectNum = _dynamicObjectNums[proxyNum];
+
+        if (   !_proxies[proxyNum]._isActive || _proxies[proxyNum]._box.isEmpty()
+            || !_bodyStorePtr->isMovable(objectNum))
+            continue;
+
+        _foundStaticObjectNums.clear();
+        _staticHierarchy.query(_proxies[proxyNum]._box, _foundStaticObjectNums);
+
+        for (size_t staticObjectNum : _foundStaticObjectNums)
+            _candidatePairs.emplace_back(std::min(objectNum, staticObjectNum),
+                                         std::max(objectNum, staticObjectNum));
+    }
+
+    // keep the order of brute force enumeration
+    std::sort(_candidatePairs.begin(), _candidatePairs.end());
+}
+
+
 void StrictCollisionProcessor::Impl::doPostProcess(double /*frameTimeSec*/)
 {
     // error recovery
@@ -212,23 +529,27 @@ void StrictCollisionProcessor::Impl::doPostProcess(double /*frameTimeSec*/)
             SimplePhysicalObjectPointer firstObjectPtr  = firstMetadataPtr->_objectPtr;
             SimplePhysicalObjectPointer secondObjectPtr = secondMetadataPtr->_objectPtr;
 
-            auto firstRectIt  = firstObjectPtr->getGeometry();
-            auto secondRectIt = secondObjectPtr->getGeometry();
+            // objects could be returned back by previous pairs
+            _bodyStorePtr->updateGeometry(lessObjectNum);
+            _bodyStorePtr->updateGeometry(greaterObjectNum);
+
+            const RectangleBatch firstRects  = _bodyStorePtr->getWorldRects(lessObjectNum);
+            const RectangleBatch secondRects = _bodyStorePtr->getWorldRects(greaterObjectNum);
+            const Point firstShift  = firstObjectPtr->getSpeed()  * (ABSOLUTE_TIME_ERROR * -0.5);
+            const Point secondShift = secondObjectPtr->getSpeed() * (ABSOLUTE_TIME_ERROR * -0.5);
             bool isCollide = false;
 
             // for each pair of objects rectangles
-            for (firstRectIt->first(); !firstRectIt->isDone() && !isCollide; firstRectIt->next())
-                for (secondRectIt->first(); !secondRectIt->isDone() && !isCollide; secondRectIt->next())
+            for (size_t firstRectNum = 0; firstRectNum < firstRects._count && !isCollide; ++firstRectNum)
+                for (size_t secondRectNum = 0; secondRectNum < secondRects._count && !isCollide; ++secondRectNum)
                 {
                     // calculate position of first rectangle at -ABSOLUTE_TIME_ERROR / 2 moment
-                    Rectangle firstRect = firstRectIt->current();
-                    firstRect.setPosition(firstRect.getPosition() + firstObjectPtr->getSpeed() * (ABSOLUTE_TIME_ERROR * -0.5));
-                    firstRect = firstObjectPtr->mapToGlobal(firstRect, _worldPtr.get());
+                    Rectangle firstRect = firstRects.getRectangle(firstRectNum);
+                    firstRect.setPosition(firstRect.getPosition() + firstShift);
 
                     // calculate position of second rectangle at -ABSOLUTE_TIME_ERROR / 2 moment
-                    Rectangle secondRect = secondRectIt->current();
-                    secondRect.setPosition(secondRect.getPosition() + secondObjectPtr->getSpeed() * (ABSOLUTE_TIME_ERROR * -0.5));
-                    secondRect = secondObjectPtr->mapToGlobal(secondRect, _worldPtr.get());
+                    Rectangle secondRect = secondRects.getRectangle(secondRectNum);
+                    secondRect.setPosition(secondRect.getPosition() + secondShift);
 
                     // if rectangles collide then there is an error here
                     isCollide = firstRect.isStrongCollided(secondRect);
@@ -244,6 +565,62 @@ void StrictCollisionProcessor::Impl::doPostProcess(double /*frameTimeSec*/)
 }
 
 
+void StrictCollisionProcessor::Impl::projectRestFrame(double frameTimeSec)
+{
+    // movable objects, that would hit something till the end of the frame,
+    // lose the speed along the hit normal, so they keep sliding along it,
+    // others are moved without further collision processing, every pass
+    // zeroes at least one speed component, so the loop is finite
+    for (bool hasStoppedObjects = true; hasStoppedObjects; )
+    {
+        hasStoppedObjects = false;
+        updateProxies(frameTimeSec);
+        findCandidatePairs();
+        _profilerPtr->addCount(PhysicsProfiler::PairTestCounter, _candidatePairs.size());
+
+        for (const BroadPhase::Pair &pair : _candidatePairs)
+        {
+            CollisionInfo collision
+                    = (_objectVect[pair.first]._isStatic || _objectVect[pair.second]._isStatic)
+                    ? findStaticCollisionBetween(pair.first, pair.second, frameTimeSec)
+                    : findCollisionBetween(pair.first, pair.second, frameTimeSec);
+
+            _profilerPtr->addCount(PhysicsProfiler::RectangleTestCounter, collision._rectTestCount);
+
+            if (!collision._hasCollision)
+                continue;
+
+            const bool isHorizontalCollision = collision._direction == Right || collision._direction == Left;
+
+            for (size_t objectNum : {pair.first, pair.second})
+            {
+                if (!_bodyStorePtr->isMovable(objectNum))
+                    continue;
+
+                if (isHorizontalCollision && _bodyStorePtr->getSpeedX(objectNum) != 0)
+                    _bodyStorePtr->setSpeed(objectNum, 0, _bodyStorePtr->getSpeedY(objectNum));
+                else if (!isHorizontalCollision && _bodyStorePtr->getSpeedY(objectNum) != 0)
+                    _bodyStorePtr->setSpeed(objectNum, _bodyStorePtr->getSpeedX(objectNum), 0);
+                else
+                    continue;
+
+                hasStoppedObjects = true;
+            }
+        }
+    }
+
+    for (size_t objectNum : _dynamicObjectNums)
+        if (!_bodyStorePtr->isSleeping(objectNum))
+        {
+            Point shift = _bodyStorePtr->getSpeed(objectNum) * frameTimeSec;
+
+            _bodyStorePtr->setPosition(objectNum,
+                                       _bodyStorePtr->getX(objectNum) + shift.getX(),
+                                       _bodyStorePtr->getY(objectNum) + shift.getY());
+        }
+}
+
+
 void StrictCollisionProcessor::Impl::processCollision(const CollisionInfo &collision, double frameTimeSec)
 {
     ObjectMetadata *firstMetadataPtr  = &_objectVect[collision._lessObjectNum];
@@ -260,6 +637,7 @@ void StrictCollisionProcessor::Impl::processCollision(const CollisionInfo &colli
     SimplePhysicalObjectPointer lastNeighborPtr = firstObjPtr->getContiguousObject(collision._direction);
     firstObjPtr->setContiguousObject(collision._direction, secondObjPtr);
     secondObjPtr->setContiguousObject(getOppositeDirrection(collision._direction), firstObjPtr);
+    _contactCachePtr->refreshContact(collision._lessObjectNum, collision._greaterObectNum, collision._direction);
 
     // set connection number
     if (lastNeighborPtr != secondObjPtr)
@@ -276,73 +654,37 @@ void StrictCollisionProcessor::Impl::processCollision(const CollisionInfo &colli
     secondMetadataPtr->_lastConnectionNum = maxConnectionNum;
 
     if (hasSameConnectionNum)
-    {
-        // simplified collision processing
-        double firstObjectSpeed  = firstObjPtr->getSpeed().getProjection(isHorizontalCollision);
-        double secondObjectSpeed = secondObjPtr->getSpeed().getProjection(isHorizontalCollision);
-        double newSpeed = 0;
-
-        if (!firstObjPtr->isMovable())
-            newSpeed = firstObjectSpeed;
-        else if (!secondObjPtr->isMovable())
-            newSpeed = secondObjectSpeed;
-        else
-            newSpeed = 0;
-
-        Point firstObjectSpeedVect = firstObjPtr->getSpeed();
-        firstObjectSpeedVect.setProjection(newSpeed, isHorizontalCollision);
-        firstObjPtr->setSpeed(firstObjectSpeedVect);
+        _processorPtr->applyContactSpeeds(firstObjPtr, secondObjPtr, isHorizontalCollision);
+    else
+        _processorPtr->applyHitSpeeds(firstObjPtr, secondObjPtr, isHorizontalCollision);
+}
 
-        Point secondObjectSpeedVect = secondObjPtr->getSpeed();
-        secondObjectSpeedVect.setProjection(newSpeed, isHorizontalCollision);
-        secondObjPtr->setSpeed(secondObjectSpeedVect);
-        return;
-    }
 
-    // calculate new speeds
-    const double speedRecoveryFactor = (   firstObjPtr->getHitRecoveryFactor()
-                                        + secondObjPtr->getHitRecoveryFactor()) / 2;
+CollisionInfo StrictCollisionProcessor::Impl::findEarliestCollision(size_t firstPairNum,
+                                                                    size_t pairCount,
+                                                                    double frameTimeSec)
+{
+    CollisionInfo earliestCollision;
+    size_t rectTestCount = 0;
 
-    if (firstObjPtr->isMovable() && secondObjPtr->isMovable())
-    {
-        // hit between two objects
-        double firstObjectSpeed  = firstObjPtr->getSpeed().getProjection(isHorizontalCollision);
-        double secondObjectSpeed = secondObjPtr->getSpeed().getProjection(isHorizontalCollision);
-        double newFirstObjectSpeed  = 0;
-        double newSecondObjectSpeed = 0;
-
-        solveCentralHit(firstObjectSpeed, firstObjPtr->getMass(),
-                        secondObjectSpeed, secondObjPtr->getMass(),
-                        speedRecoveryFactor,
-                        newFirstObjectSpeed, newSecondObjectSpeed);
-
-        Point firstObjectSpeedVect = firstObjPtr->getSpeed();
-        firstObjectSpeedVect.setProjection(newFirstObjectSpeed, isHorizontalCollision);
-        firstObjPtr->setSpeed(firstObjectSpeedVect);
-
-        Point secondObjectSpeedVect = secondObjPtr->getSpeed();
-        secondObjectSpeedVect.setProjection(newSecondObjectSpeed, isHorizontalCollision);
-        secondObjPtr->setSpeed(secondObjectSpeedVect);
-    }
-    else if (firstObjPtr->isMovable() || secondObjPtr->isMovable())
-    {
-        // hit between object and platform
-        SimplePhysicalObjectPointer objectPtr   = ( firstObjPtr->isMovable() ? firstObjPtr : secondObjPtr);
-        SimplePhysicalObjectPointer platformPtr = (!firstObjPtr->isMovable() ? firstObjPtr : secondObjPtr);
-        double objectSpeed   = objectPtr->getSpeed().getProjection(isHorizontalCollision);
-        double platformSpeed = platformPtr->getSpeed().getProjection(isHorizontalCollision);
-        double newObjectSpeed   = 0;
-
-        solvePlatformHit(objectSpeed, platformSpeed, speedRecoveryFactor, newObjectSpeed);
-
-        Point objectSpeedVect = objectPtr->getSpeed();
-        objectSpeedVect.setProjection(newObjectSpeed, isHorizontalCollision);
-        objectPtr->setSpeed(objectSpeedVect);
-    }
-    else
+    for (size_t pairNum = firstPairNum; pairNum < firstPairNum + pairCount; ++pairNum)
     {
-        // do nothing
+        const BroadPhase::Pair &pair = _candidatePairs[pairNum];
+
+        CollisionInfo possibleCollision
+                = (_objectVect[pair.first]._isStatic || _objectVect[pair.second]._isStatic)
+                ? findStaticCollisionBetween(pair.first, pair.second, frameTimeSec)
+                : findCollisionBetween(pair.first, pair.second, frameTimeSec);
+
+        possibleCollision._pairNum = pairNum;
+        rectTestCount += possibleCollision._rectTestCount;
+
+        if (possibleCollision.isEarlierThan(earliestCollision))
+            earliestCollision = possibleCollision;
     }
+
+    earliestCollision._rectTestCount = rectTestCount;
+    return earliestCollision;
 }
 
 
@@ -350,133 +692,62 @@ CollisionInfo StrictCollisionProcessor::Impl::findCollisionBetween(size_t lessOb
                                                                    size_t greaterObjectNum,
                                                                    double frameTimeSec)
 {
-    ObjectMetadata *firstMetadataPtr  = &_objectVect[lessObjectNum];
-    ObjectMetadata *secondMetadataPtr = &_objectVect[greaterObjectNum];
-    SimplePhysicalObjectPointer firstObjPtr  = firstMetadataPtr->_objectPtr;
-    SimplePhysicalObjectPointer secondObjPtr = secondMetadataPtr->_objectPtr;
+    CollisionInfo collision;
+    collision._lessObjectNum = lessObjectNum;
+    collision._greaterObectNum = greaterObjectNum;
 
-    if (!firstObjPtr->isMovable() && !secondObjPtr->isMovable())
-        return CollisionInfo();
+    if (!_bodyStorePtr->isMovable(lessObjectNum) && !_bodyStorePtr->isMovable(greaterObjectNum))
+        return collision;
 
-    RectangleIteratorPtr firstRectIterator  = firstObjPtr->getGeometry();
-    RectangleIteratorPtr secondRectIterator = secondObjPtr->getGeometry();
+    SweptBody lessBody;
+    lessBody._rects = _bodyStorePtr->getWorldRects(lessObjectNum);
+    lessBody._position = _bodyStorePtr->getPosition(lessObjectNum);
+    lessBody._speed = _bodyStorePtr->getSpeed(lessObjectNum);
 
-    // ===== not refactored ==============
-    double minCollisionTime = 1;
-    bool isHorizontalCollision = false;
+    SweptBody greaterBody;
+    greaterBody._rects = _bodyStorePtr->getWorldRects(greaterObjectNum);
+    greaterBody._position = _bodyStorePtr->getPosition(greaterObjectNum);
+    greaterBody._speed = _bodyStorePtr->getSpeed(greaterObjectNum);
 
-    static double timeVect[4];
-    static const bool TYPE_FLAGS[4] = {false, false, true, true};
+    collision._hasCollision = CollisionProcessor::findCollisionBetween(
+                lessBody, greaterBody, frameTimeSec, collision._timeRate, collision._direction);
+    collision._rectTestCount = lessBody._rects._count * greaterBody._rects._count;
 
-    for (firstRectIterator->first(); !firstRectIterator->isDone(); firstRectIterator->next() /*, ++rectNum*/)
-    {
-        Rectangle rect1 = firstObjPtr->mapToGlobal(firstRectIterator->current(), _worldPtr.get());
-        Rectangle rect1M(rect1.getPosition() + firstObjPtr->getSpeed() * frameTimeSec, rect1.getSize());
+    return collision;
+}
 
-        for (secondRectIterator->first(); !secondRectIterator->isDone(); secondRectIterator->next())
-        {
-            Rectangle rect2 = secondObjPtr->mapToGlobal(secondRectIterator->current(), _worldPtr.get());
-            Rectangle rect2M(rect2.getPosition() + secondObjPtr->getSpeed() * frameTimeSec, rect2.getSize());
-            double tbt = (rect2.getTop() - rect1.getBottom())
-                    / (rect1M.getBottom() - rect1.getBottom() - rect2M.getTop() + rect2.getTop());
-            double ttb = (rect1.getTop() - rect2.getBottom())
-                    / (rect2M.getBottom() - rect2.getBottom() - rect1M.getTop() + rect1.getTop());
-            double trl = (rect2.getLeft() - rect1.getRight())
-                    / (rect1M.getRight() - rect1.getRight() - rect2M.getLeft() + rect2.getLeft());
-            double tlr = (rect1.getLeft() - rect2.getRight())
-                    / (rect2M.getRight() - rect2.getRight() - rect1M.getLeft() + rect1.getLeft());
-
-            timeVect[0] = tbt;
-            timeVect[1] = ttb;
-            timeVect[2] = trl;
-            timeVect[3] = tlr;
-
-            double minHTime = 1;
-            double minVTime = 1;
-
-            for (int tnum = 0; tnum < 4; ++tnum)
-                if (timeVect[tnum] >= -ABSOLUTE_TIME_ERROR && timeVect[tnum] < minCollisionTime)
-                {
-                    if (TYPE_FLAGS[tnum])
-                         minHTime = timeVect[tnum];
-                    else minVTime = timeVect[tnum];
-                }
 
-            bool hasHCollision = minHTime < 1;
-            bool hasVCollision = minVTime < 1;
-
-            hasHCollision &= (firstObjPtr->getSpeed().getX() != secondObjPtr->getSpeed().getX());
-            hasVCollision &= (firstObjPtr->getSpeed().getY() != secondObjPtr->getSpeed().getY());
-
-            // check that collision has really happened
-            double x1 = rect1.getLeft() + firstObjPtr->getSpeed().getX() * frameTimeSec * minVTime
-                    + rect1.getWidth() / 2;
-            double x2 = rect2.getLeft() + secondObjPtr->getSpeed().getX() * frameTimeSec * minVTime
-                    + rect2.getWidth() / 2;
-            double y1 = rect1.getTop() + firstObjPtr->getSpeed().getY() * frameTimeSec * minHTime
-                    + rect1.getHeight() / 2;
-            double y2 = rect2.getTop() + secondObjPtr->getSpeed().getY() * frameTimeSec * minHTime
-                    + rect2.getHeight() / 2;
-
-            hasVCollision &= abs(x1 - x2) <= (rect1.getWidth()  + rect2.getWidth())  / 2;
-            hasHCollision &= abs(y1 - y2) <= (rect1.getHeight() + rect2.getHeight()) / 2;
-
-            hasHCollision &= timeVect[2] >= -ABSOLUTE_TIME_ERROR && timeVect[3] >= -ABSOLUTE_TIME_ERROR;
-            hasVCollision &= timeVect[0] >= -ABSOLUTE_TIME_ERROR && timeVect[1] >= -ABSOLUTE_TIME_ERROR;
-
-            // Debug output
-#ifdef DEBUG_OUTPUT
-            std::cout << objNum1 << "-" << objNum2 << " " << x1 << " " << x2 << " {";
-            for (int tnum = 0; tnum < 4; ++tnum)
-                std::cout << timeVect[tnum] << ", ";
-            std::cout << "} " << hasHCollision << " " << hasVCollision << " " << isHorizontalCollision << std::endl;
-#endif
-
-            if (hasHCollision || hasVCollision)
-            {
-                minCollisionTime = std::min(minHTime, minVTime);
-                isHorizontalCollision = minHTime < minVTime;
-            }
-        }
-    }
 
-    Direction direction;
-
-    if (isHorizontalCollision)
-         direction = (firstObjPtr->getPosition().getX() < secondObjPtr->getPosition().getX()) ? Right : Left;
-    else direction = (firstObjPtr->getPosition().getY() < secondObjPtr->getPosition().getY()) ? Down : Up;
-    // ===================
 
+CollisionInfo StrictCollisionProcessor::Impl::findStaticCollisionBetween(size_t lessObjectNum,
+                                                                         size_t greaterObjectNum,
+                                                                         double frameTimeSec)
+{
     CollisionInfo collision;
-    collision._direction = direction;
     collision._lessObjectNum = lessObjectNum;
     collision._greaterObectNum = greaterObjectNum;
-    collision._hasCollision = minCollisionTime < 1;
-    collision._timeRate = minCollisionTime;
-    return collision;
-}
 
+    const bool isLessStatic = _objectVect[lessObjectNum]._isStatic;
+    const size_t staticObjectNum  = isLessStatic ? lessObjectNum : greaterObjectNum;
+    const size_t dynamicObjectNum = isLessStatic ? greaterObjectNum : lessObjectNum;
 
-void StrictCollisionProcessor::Impl::solvePlatformHit(double objectSpeed, double platformSpeed,
-                                                      double speedRecoveryFactor,
-                                                      double &newObjectSpeed) const
-{
-    newObjectSpeed = platformSpeed - speedRecoveryFactor * (objectSpeed - platformSpeed);
-}
+    // static objects don't move during the frame
+    SweptBody staticBody;
+    staticBody._rects = _bodyStorePtr->getWorldRects(staticObjectNum);
+    staticBody._position = _bodyStorePtr->getPosition(staticObjectNum);
 
+    SweptBody dynamicBody;
+    dynamicBody._rects = _bodyStorePtr->getWorldRects(dynamicObjectNum);
+    dynamicBody._position = _bodyStorePtr->getPosition(dynamicObjectNum);
+    dynamicBody._speed = _bodyStorePtr->getSpeed(dynamicObjectNum);
 
-void StrictCollisionProcessor::Impl::solveCentralHit(double firstObjectSpeed,     double firstObjectMass,
-                                                     double secondObjectSpeed,    double secondObjectMass,
-                                                     double speedRecoveryFactor,
-                                                     double &newFirstObjectSpeed, double &newSecondObjectSpeed) const
-{
-    double speedDifference = firstObjectSpeed - secondObjectSpeed;
-    newFirstObjectSpeed = (firstObjectMass  * firstObjectSpeed
-                           + secondObjectMass * secondObjectSpeed
-                           - secondObjectMass * speedRecoveryFactor * speedDifference)
-            / (firstObjectMass + secondObjectMass);
+    collision._hasCollision = CollisionProcessor::findCollisionBetween(
+                isLessStatic ? staticBody : dynamicBody,
+                isLessStatic ? dynamicBody : staticBody,
+                frameTimeSec, collision._timeRate, collision._direction);
+    collision._rectTestCount = staticBody._rects._count * dynamicBody._rects._count;
 
-    newSecondObjectSpeed = newFirstObjectSpeed + speedRecoveryFactor * speedDifference;
+    return collision;
 }
 
 
@@ -21,8 +21,14 @@ public:
     virtual StrictCollisionProcessor& operator=(StrictCollisionProcessor&& other);
     virtual ~StrictCollisionProcessor();
 
+    BroadPhasePointer getBroadPhasePtr() const;
+
+    void setBroadPhasePtr(BroadPhasePointer broadPhasePtr);
     virtual void updateMetadata() override;
-    virtual void processFrame(double frameTimeSec) override;
+    virtual void addBody(size_t bodyNum) override;
+    virtual void removeBody(size_t bodyNum) override;
+    virtual void beginFrame(double frameTimeSec) override;
+    virtual void processSubStep(double subStepTimeSec) override;
 
 private:
     struct Impl;
@@ -0,0 +1,94 @@
+// SweepAndPruneBroadPhase.cpp
+
+#include <algorithm>
+
+#include "SweepAndPruneBroadPhase.h"
+
+
+namespace Platformer
+{
+
+
+struct SweepAndPruneBroadPhase::Impl
+{
+    Impl()
+    {
+    }
+
+    void sortProxies(const std::vector<Proxy> &proxies);
+
+    // proxy numbers sorted by the left edge; kept between calls, because
+    // objects move a little per step and insertion sort is almost linear then
+    std::vector<size_t> _order;
+};
+
+
+
+SweepAndPruneBroadPhase::SweepAndPruneBroadPhase()
+    : BroadPhase()
+    , _pimpl(new Impl())
+{
+}
+
+SweepAndPruneBroadPhase::SweepAndPruneBroadPhase(SweepAndPruneBroadPhase&& /*other*/) = default;
+SweepAndPruneBroadPhase& SweepAndPruneBroadPhase::operator=(SweepAndPruneBroadPhase&& /*other*/) = default;
+SweepAndPruneBroadPhase::~SweepAndPruneBroadPhase() = default;
+
+
+void SweepAndPruneBroadPhase::doFindPairs(const std::vector<Proxy> &proxies, std::vector<Pair> &pairs)
+{
+    _pimpl->sortProxies(proxies);
+
+    const std::vector<size_t> &order = _pimpl->_order;
+
+    for (size_t orderNum = 0; orderNum < order.size(); ++orderNum)
+    {
+        const Proxy &proxy = proxies[order[orderNum]];
+
+        for (size_t nextOrderNum = orderNum + 1; nextOrderNum < order.size(); ++nextOrderNum)
+        {
+            const Proxy &nextProxy = proxies[order[nextOrderNum]];
+
+            if (nextProxy._box.getLeft() > proxy._box.getRight())
+                break;
+
+            if (isPairNeeded(proxy, nextProxy))
+                pairs.emplace_back(std::min(order[orderNum], order[nextOrderNum]),
+                                   std::max(order[orderNum], order[nextOrderNum]));
+        }
+    }
+}
+
+
+void SweepAndPruneBroadPhase::Impl::sortProxies(const std::vector<Proxy> &proxies)
+{
+    auto isLess = [&proxies](size_t firstNum, size_t secondNum)
+    {
+        return proxies[firstNum]._box.getLeft() < proxies[secondNum]._box.getLeft();
+    };
+
+    if (_order.size() != proxies.size())
+    {
+        _order.resize(proxies.size());
+
+        for (size_t proxyNum = 0; proxyNum < _order.size(); ++proxyNum)
+            _order[proxyNum] = proxyNum;
+
+        std::sort(_order.begin(), _order.end(), isLess);
+        return;
+    }
+
+    for (size_t orderNum = 1; orderNum < _order.size(); ++orderNum)
+    {
+        size_t proxyNum = _order[orderNum];
+        size_t insertNum = orderNum;
+
+        for ( ; insertNum > 0 && isLess(proxyNum, _order[insertNum - 1]); --insertNum)
+            _order[insertNum] = _order[insertNum - 1];
+
+        _order[insertNum] = proxyNum;
+    }
+}
+
+
+}  // namespace Platformer
@@ -0,0 +1,34 @@
+// SweepAndPruneBroadPhase.h
+
+#ifndef SWEEPANDPRUNEBROADPHASE_H
+#define SWEEPANDPRUNEBROADPHASE_H
+
+#include <memory>
+
+#include "BroadPhase.h"
+
+
+namespace Platformer
+{
+
+
+class SweepAndPruneBroadPhase : public BroadPhase
+{
+public:
+    SweepAndPruneBroadPhase();
+    SweepAndPruneBroadPhase(SweepAndPruneBroadPhase&& other);
+    virtual SweepAndPruneBroadPhase& operator=(SweepAndPruneBroadPhase&& other);
+    virtual ~SweepAndPruneBroadPhase();
+
+protected:
+    virtual void doFindPairs(const std::vector<Proxy> &proxies, std::vector<Pair> &pairs) override;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> _pimpl;
+};
+
+
+}  // namespace Platformer
+
+#endif  // SWEEPANDPRUNEBROADPHASE_H
@@ -18,7 +18,6 @@ struct TestObject::Impl
     }
 
     double _mass = 0;
-    std::vector<Rectangle> _geometry;
 };
 
 
@@ -30,7 +29,7 @@ TestObject::TestObject(double mass, const std::string &name)
     setMass(mass);
     //setRectangle(Rectangle(0, 0, 170, 100));
 
-    _pimpl->_geometry.push_back(Rectangle(0, 0, 70, 70));
+    setGeometry({Rectangle(0, 0, 70, 70)});
 
 //    auto h = 50;
 //    auto l = 5;
@@ -58,14 +57,6 @@ double TestObject::getMass() const
     return _pimpl->_mass;
 }
 
-RectangleIteratorPtr TestObject::getGeometry() const
-{
-//    return IteratorPointer<Rectangle>(
-//                new SingleValueIterator<Rectangle>(getRectangle()));
-
-    return createContainerIterator(_pimpl->_geometry);
-}
-
 //const Rectangle &TestObject::getRectangle() const
 //{
 //    return _pimpl->_rect;
@@ -78,7 +69,9 @@ void TestObject::setMass(double mass)
 
 void TestObject::setSize(const Point &size)
 {
-    _pimpl->_geometry.front().setSize(size);
+    Rectangle rect = getGeometrySpan()[0];
+    rect.setSize(size);
+    setGeometry({rect});
 }
 
 //void TestObject::setRectangle(const Rectangle &rect)
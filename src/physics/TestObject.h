@@ -20,7 +20,6 @@ public:
     virtual ~TestObject();
 
     virtual double getMass() const override;
-    virtual RectangleIteratorPtr getGeometry() const override;
 
     void setMass(double mass);
     void setSize(const Point &size);
@@ -0,0 +1,482 @@
+// TimeOfImpactKernel.cpp
+
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TOI_KERNEL_HAS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TOI_KERNEL_HAS_AVX2 1
+#include <immintrin.h>
+#endif
+
+#include "TimeOfImpactKernel.h"
+
+
+namespace Platformer
+{
+
+
+namespace
+{
+
+
+const size_t CHUNK_SIZE = 8;
+
+
+// values of the moving rectangle shared by all lanes
+struct KernelInput
+{
+    double _left, _top, _width, _height, _right, _bottom;
+    double _movedLeft, _movedTop, _movedRight, _movedBottom;
+    double _shiftX, _shiftY, _batchShiftX, _batchShiftY;
+    double _halfWidth, _halfHeight;
+};
+
+
+// times of impact and overlap checks at these times for a chunk of the batch
+struct KernelOutput
+{
+    double _tbt[CHUNK_SIZE], _ttb[CHUNK_SIZE], _trl[CHUNK_SIZE], _tlr[CHUNK_SIZE];
+    bool _isBtOverlapped[CHUNK_SIZE], _isTbOverlapped[CHUNK_SIZE];
+    bool _isRlOverlapped[CHUNK_SIZE], _isLrOverlapped[CHUNK_SIZE];
+};
+
+
+inline bool isXOverlapped(const KernelInput &in, double left, double width, double timeRate)
+{
+    double x1 = in._left + in._shiftX * timeRate + in._halfWidth;
+    double x2 = left + in._batchShiftX * timeRate + width / 2;
+
+    return std::abs(x1 - x2) <= (in._width + width) / 2;
+}
+
+
+inline bool isYOverlapped(const KernelInput &in, double top, double height, double timeRate)
+{
+    double y1 = in._top + in._shiftY * timeRate + in._halfHeight;
+    double y2 = top + in._batchShiftY * timeRate + height / 2;
+
+    return std::abs(y1 - y2) <= (in._height + height) / 2;
+}
+
+
+void computeLane(const KernelInput &in, const RectangleBatch &batch, size_t rectNum,
+                 KernelOutput &out, size_t lane)
+{
+    const double left   = batch._lefts[rectNum];
+    const double top    = batch._tops[rectNum];
+    const double width  = batch._widths[rectNum];
+    const double height = batch._heights[rectNum];
+    const double right  = left + width;
+    const double bottom = top + height;
+    const double movedLeft   = left + in._batchShiftX;
+    const double movedTop    = top  + in._batchShiftY;
+    const double movedRight  = movedLeft + width;
+    const double movedBottom = movedTop  + height;
+
+    out._tbt[lane] = (top - in._bottom)    / (in._movedBottom - in._bottom - movedTop  + top);
+    out._ttb[lane] = (in._top - bottom)    / (movedBottom - bottom - in._movedTop  + in._top);
+    out._trl[lane] = (left - in._right)    / (in._movedRight - in._right - movedLeft + left);
+    out._tlr[lane] = (in._left - right)    / (movedRight - right - in._movedLeft + in._left);
+
+    out._isBtOverlapped[lane] = isXOverlapped(in, left, width,  out._tbt[lane]);
+    out._isTbOverlapped[lane] = isXOverlapped(in, left, width,  out._ttb[lane]);
+    out._isRlOverlapped[lane] = isYOverlapped(in, top,  height, out._trl[lane]);
+    out._isLrOverlapped[lane] = isYOverlapped(in, top,  height, out._tlr[lane]);
+}
+
+
+#ifdef TOI_KERNEL_HAS_SSE2
+
+inline __m128d absValue(__m128d value)
+{
+    return _mm_andnot_pd(_mm_set1_pd(-0.0), value);
+}
+
+
+inline int getOverlapMask(__m128d position1, __m128d shift1, __m128d halfSize1,
+                          __m128d position2, __m128d shift2, __m128d size2,
+                          __m128d size1, __m128d timeRate)
+{
+    const __m128d two = _mm_set1_pd(2);
+    __m128d center1 = _mm_add_pd(_mm_add_pd(position1, _mm_mul_pd(shift1, timeRate)), halfSize1);
+    __m128d center2 = _mm_add_pd(_mm_add_pd(position2, _mm_mul_pd(shift2, timeRate)), _mm_div_pd(size2, two));
+
+    return _mm_movemask_pd(_mm_cmple_pd(absValue(_mm_sub_pd(center1, center2)),
+                                        _mm_div_pd(_mm_add_pd(size1, size2), two)));
+}
+
+
+size_t computeLanesSse2(const KernelInput &in, const RectangleBatch &batch,
+                        size_t firstNum, size_t firstLane, size_t count, KernelOutput &out)
+{
+    const __m128d left1        = _mm_set1_pd(in._left);
+    const __m128d top1         = _mm_set1_pd(in._top);
+    const __m128d width1       = _mm_set1_pd(in._width);
+    const __m128d height1      = _mm_set1_pd(in._height);
+    const __m128d right1       = _mm_set1_pd(in._right);
+    const __m128d bottom1      = _mm_set1_pd(in._bottom);
+    const __m128d movedLeft1   = _mm_set1_pd(in._movedLeft);
+    const __m128d movedTop1    = _mm_set1_pd(in._movedTop);
+    const __m128d movedRight1  = _mm_set1_pd(in._movedRight);
+    const __m128d movedBottom1 = _mm_set1_pd(in._movedBottom);
+    const __m128d shiftX1      = _mm_set1_pd(in._shiftX);
+    const __m128d shiftY1      = _mm_set1_pd(in._shiftY);
+    const __m128d shiftX2      = _mm_set1_pd(in._batchShiftX);
+    const __m128d shiftY2      = _mm_set1_pd(in._batchShiftY);
+    const __m128d halfWidth1   = _mm_set1_pd(in._halfWidth);
+    const __m128d halfHeight1  = _mm_set1_pd(in._halfHeight);
+
+    size_t lane = firstLane;
+
+    for ( ; lane + 2 <= count; lane += 2)
+    {
+        const size_t rectNum = firstNum + lane;
+        __m128d left   = _mm_loadu_pd(batch._lefts   + rectNum);
+        __m128d top    = _mm_loadu_pd(batch._tops    + rectNum);
+        __m128d width  = _mm_loadu_pd(batch._widths  + rectNum);
+        __m128d height = _mm_loadu_pd(batch._heights + rectNum);
+        __m128d right  = _mm_add_pd(left, width);
+        __m128d bottom = _mm_add_pd(top, height);
+        __m128d movedLeft   = _mm_add_pd(left, shiftX2);
+        __m128d movedTop    = _mm_add_pd(top,  shiftY2);
+        __m128d movedRight  = _mm_add_pd(movedLeft, width);
+        __m128d movedBottom = _mm_add_pd(movedTop,  height);
+
+        __m128d tbt = _mm_div_pd(_mm_sub_pd(top, bottom1),
+                                 _mm_add_pd(_mm_sub_pd(_mm_sub_pd(movedBottom1, bottom1), movedTop), top));
+        __m128d ttb = _mm_div_pd(_mm_sub_pd(top1, bottom),
+                                 _mm_add_pd(_mm_sub_pd(_mm_sub_pd(movedBottom, bottom), movedTop1), top1));
+        __m128d trl = _mm_div_pd(_mm_sub_pd(left, right1),
+                                 _mm_add_pd(_mm_sub_pd(_mm_sub_pd(movedRight1, right1), movedLeft), left));
+        __m128d tlr = _mm_div_pd(_mm_sub_pd(left1, right),
+                                 _mm_add_pd(_mm_sub_pd(_mm_sub_pd(movedRight, right), movedLeft1), left1));
+
+        _mm_storeu_pd(out._tbt + lane, tbt);
+        _mm_storeu_pd(out._ttb + lane, ttb);
+        _mm_storeu_pd(out._trl + lane, trl);
+        _mm_storeu_pd(out._tlr + lane, tlr);
+
+        int btMask = getOverlapMask(left1, shiftX1, halfWidth1,  left, shiftX2, width,  width1,  tbt);
+        int tbMask = getOverlapMask(left1, shiftX1, halfWidth1,  left, shiftX2, width,  width1,  ttb);
+        int rlMask = getOverlapMask(top1,  shiftY1, halfHeight1, top,  shiftY2, height, height1, trl);
+        int lrMask = getOverlapMask(top1,  shiftY1, halfHeight1, top,  shiftY2, height, height1, tlr);
+
+        for (size_t bit = 0; bit < 2; ++bit)
+        {
+            out._isBtOverlapped[lane + bit] = (btMask >> bit) & 1;
+            out._isTbOverlapped[lane + bit] = (tbMask >> bit) & 1;
+            out._isRlOverlapped[lane + bit] = (rlMask >> bit) & 1;
+            out._isLrOverlapped[lane + bit] = (lrMask >> bit) & 1;
+        }
+    }
+
+    return lane;
+}
+
+#endif  // TOI_KERNEL_HAS_SSE2
+
+
+#ifdef TOI_KERNEL_HAS_AVX2
+
+__attribute__((target("avx2")))
+inline __m256d absValue(__m256d value)
+{
+    return _mm256_andnot_pd(_mm256_set1_pd(-0.0), value);
+}
+
+
+__attribute__((target("avx2")))
+inline int getOverlapMask(__m256d position1, __m256d shift1, __m256d halfSize1,
+                          __m256d position2, __m256d shift2, __m256d size2,
+                          __m256d size1, __m256d timeRate)
+{
+    const __m256d two = _mm256_set1_pd(2);
+    __m256d center1 = _mm256_add_pd(_mm256_add_pd(position1, _mm256_mul_pd(shift1, timeRate)), halfSize1);
+    __m256d center2 = _mm256_add_pd(_mm256_add_pd(position2, _mm256_mul_pd(shift2, timeRate)),
+                                    _mm256_div_pd(size2, two));
+
+    return _mm256_movemask_pd(_mm256_cmp_pd(absValue(_mm256_sub_pd(center1, center2)),
+                                            _mm256_div_pd(_mm256_add_pd(size1, size2), two), _CMP_LE_OQ));
+}
+
+
+__attribute__((target("avx2")))
+size_t computeLanesAvx2(const KernelInput &in, const RectangleBatch &batch,
+                        size_t firstNum, size_t firstLane, size_t count, KernelOutput &out)
+{
+    const __m256d left1        = _mm256_set1_pd(in._left);
+    const __m256d top1         = _mm256_set1_pd(in._top);
+    const __m256d width1       = _mm256_set1_pd(in._width);
+    const __m256d height1      = _mm256_set1_pd(in._height);
+    const __m256d right1       = _mm256_set1_pd(in._right);
+    const __m256d bottom1      = _mm256_set1_pd(in._bottom);
+    const __m256d movedLeft1   = _mm256_set1_pd(in._movedLeft);
+    const __m256d movedTop1    = _mm256_set1_pd(in._movedTop);
+    const __m256d movedRight1  = _mm256_set1_pd(in._movedRight);
+    const __m256d movedBottom1 = _mm256_set1_pd(in._movedBottom);
+    const __m256d shiftX1      = _mm256_set1_pd(in._shiftX);
+    const __m256d shiftY1      = _mm256_set1_pd(in._shiftY);
+    const __m256d shiftX2      = _mm256_set1_pd(in._batchShiftX);
+    const __m256d shiftY2      = _mm256_set1_pd(in._batchShiftY);
+    const __m256d halfWidth1   = _mm256_set1_pd(in._halfWidth);
+    const __m256d halfHeight1  = _mm256_set1_pd(in._halfHeight);
+
+    size_t lane = firstLane;
+
+    for ( ; lane + 4 <= count; lane += 4)
+    {
+        const size_t rectNum = firstNum + lane;
+        __m256d left   = _mm256_loadu_pd(batch._lefts   + rectNum);
+        __m256d top    = _mm256_loadu_pd(batch._tops    + rectNum);
+        __m256d width  = _mm256_loadu_pd(batch._widths  + rectNum);
+        __m256d height = _mm256_loadu_pd(batch._heights + rectNum);
+        __m256d right  = _mm256_add_pd(left, width);
+        __m256d bottom = _mm256_add_pd(top, height);
+        __m256d movedLeft   = _mm256_add_pd(left, shiftX2);
+        __m256d movedTop    = _mm256_add_pd(top,  shiftY2);
+        __m256d movedRight  = _mm256_add_pd(movedLeft, width);
+        __m256d movedBottom = _mm256_add_pd(movedTop,  height);
+
+        __m256d tbt = _mm256_div_pd(_mm256_sub_pd(top, bottom1),
+                                    _mm256_add_pd(_mm256_sub_pd(_mm256_sub_pd(movedBottom1, bottom1), movedTop), top));
+        __m256d ttb = _mm256_div_pd(_mm256_sub_pd(top1, bottom),
+                                    _mm256_add_pd(_mm256_sub_pd(_mm256_sub_pd(movedBottom, bottom), movedTop1), top1));
+        __m256d trl = _mm256_div_pd(_mm256_sub_pd(left, right1),
+                                    _mm256_add_pd(_mm256_sub_pd(_mm256_sub_pd(movedRight1, right1), movedLeft), left));
+        __m256d tlr = _mm256_div_pd(_mm256_sub_pd(left1, right),
+                                    _mm256_add_pd(_mm256_sub_pd(_mm256_sub_pd(movedRight, right), movedLeft1), left1));
+
+        _mm256_storeu_pd(out._tbt + lane, tbt);
+        _mm256_storeu_pd(out._ttb + lane, ttb);
+        _mm256_storeu_pd(out._trl + lane, trl);
+        _mm256_storeu_pd(out._tlr + lane, tlr);
+
+        int btMask = getOverlapMask(left1, shiftX1, halfWidth1,  left, shiftX2, width,  width1,  tbt);
+        int tbMask = getOverlapMask(left1, shiftX1, halfWidth1,  left, shiftX2, width,  width1,  ttb);
+        int rlMask = getOverlapMask(top1,  shiftY1, halfHeight1, top,  shiftY2, height, height1, trl);
+        int lrMask = getOverlapMask(top1,  shiftY1, halfHeight1, top,  shiftY2, height, height1, tlr);
+
+        for (size_t bit = 0; bit < 4; ++bit)
+        {
+            out._isBtOverlapped[lane + bit] = (btMask >> bit) & 1;
+            out._isTbOverlapped[lane + bit] = (tbMask >> bit) & 1;
+            out._isRlOverlapped[lane + bit] = (rlMask >> bit) & 1;
+            out._isLrOverlapped[lane + bit] = (lrMask >> bit) & 1;
+        }
+    }
+
+    return lane;
+}
+
+#endif  // TOI_KERNEL_HAS_AVX2
+
+
+// Chooses hits in the batch order. Only the times below the current minimum
+// are taken, the later of two suitable times of an axis wins, as it was in
+// the pairwise test.
+void chooseHits(const KernelOutput &out, size_t count,
+                bool isSpeedXDifferent, bool isSpeedYDifferent, double absoluteTimeError,
+                double &minCollisionTime, bool &isHorizontalCollision)
+{
+    for (size_t lane = 0; lane < count; ++lane)
+    {
+        const double tbt = out._tbt[lane];
+        const double ttb = out._ttb[lane];
+        const double trl = out._trl[lane];
+        const double tlr = out._tlr[lane];
+
+        double minHTime = 1;
+        double minVTime = 1;
+        bool isHOverlapped = false;
+        bool isVOverlapped = false;
+
+        if (tbt >= -absoluteTimeError && tbt < minCollisionTime)
+        {
+            minVTime = tbt;
+            isVOverlapped = out._isBtOverlapped[lane];
+        }
+
+        if (ttb >= -absoluteTimeError && ttb < minCollisionTime)
+        {
+            minVTime = ttb;
+            isVOverlapped = out._isTbOverlapped[lane];
+        }
+
+        if (trl >= -absoluteTimeError && trl < minCollisionTime)
+        {
+            minHTime = trl;
+            isHOverlapped = out._isRlOverlapped[lane];
+        }
+
+        if (tlr >= -absoluteTimeError && tlr < minCollisionTime)
+        {
+            minHTime = tlr;
+            isHOverlapped = out._isLrOverlapped[lane];
+        }
+
+        bool hasHCollision = minHTime < 1 && isSpeedXDifferent && isHOverlapped
+                && trl >= -absoluteTimeError && tlr >= -absoluteTimeError;
+        bool hasVCollision = minVTime < 1 && isSpeedYDifferent && isVOverlapped
+                && tbt >= -absoluteTimeError && ttb >= -absoluteTimeError;
+
+        if (hasHCollision || hasVCollision)
+        {
+            minCollisionTime = std::min(minHTime, minVTime);
+            isHorizontalCollision = minHTime < minVTime;
+        }
+    }
+}
+
+
+TimeOfImpactKernel::InstructionSet detectInstructionSet()
+{
+#ifdef TOI_KERNEL_HAS_AVX2
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+        return TimeOfImpactKernel::Avx2Instructions;
+#endif
+
+#ifdef TOI_KERNEL_HAS_SSE2
+    return TimeOfImpactKernel::Sse2Instructions;
+#else
+    return TimeOfImpactKernel::ScalarInstructions;
+#endif
+}
+
+
+TimeOfImpactKernel::InstructionSet &currentInstructionSet()
+{
+    static TimeOfImpactKernel::InstructionSet instructionSet = detectInstructionSet();
+    return instructionSet;
+}
+
+
+}  // namespace
+
+
+
+void PackedRectangles::clear()
+{
+    _lefts.clear();
+    _tops.clear();
+    _widths.clear();
+    _heights.clear();
+}
+
+
+RectangleBatch PackedRectangles::getBatch() const
+{
+    return getBatch(0, getCount());
+}
+
+
+RectangleBatch PackedRectangles::getBatch(size_t firstNum, size_t count) const
+{
+    RectangleBatch batch;
+    batch._lefts   = _lefts.data()   + firstNum;
+    batch._tops    = _tops.data()    + firstNum;
+    batch._widths  = _widths.data()  + firstNum;
+    batch._heights = _heights.data() + firstNum;
+    batch._count   = count;
+
+    return batch;
+}
+
+
+
+TimeOfImpactKernel::InstructionSet TimeOfImpactKernel::getInstructionSet()
+{
+    return currentInstructionSet();
+}
+
+
+bool TimeOfImpactKernel::isSupported(InstructionSet instructionSet)
+{
+    switch (instructionSet)
+    {
+    case ScalarInstructions:
+        return true;
+
+    case Sse2Instructions:
+        return detectInstructionSet() != ScalarInstructions;
+
+    case Avx2Instructions:
+        return detectInstructionSet() == Avx2Instructions;
+    }
+
+    return false;
+}
+
+
+void TimeOfImpactKernel::setInstructionSet(InstructionSet instructionSet)
+{
+    if (!isSupported(instructionSet))
+        throw std::logic_error("TimeOfImpactKernel::setInstructionSet: instruction set is not supported");
+
+    currentInstructionSet() = instructionSet;
+}
+
+
+void TimeOfImpactKernel::findEarliestHit(const Rectangle &rect, const Point &speed,
+                                         const RectangleBatch &batch, const Point &batchSpeed,
+                                         double frameTimeSec, double absoluteTimeError,
+                                         double &minCollisionTime, bool &isHorizontalCollision)
+{
+    const Point shift = speed * frameTimeSec;
+    const Point batchShift = batchSpeed * frameTimeSec;
+
+    KernelInput in;
+    in._left        = rect.getLeft();
+    in._top         = rect.getTop();
+    in._width       = rect.getWidth();
+    in._height      = rect.getHeight();
+    in._right       = rect.getRight();
+    in._bottom      = rect.getBottom();
+    in._movedLeft   = in._left + shift.getX();
+    in._movedTop    = in._top  + shift.getY();
+    in._movedRight  = in._movedLeft + in._width;
+    in._movedBottom = in._movedTop  + in._height;
+    in._shiftX      = shift.getX();
+    in._shiftY      = shift.getY();
+    in._batchShiftX = batchShift.getX();
+    in._batchShiftY = batchShift.getY();
+    in._halfWidth   = in._width  / 2;
+    in._halfHeight  = in._height / 2;
+
+    const bool isSpeedXDifferent = speed.getX() != batchSpeed.getX();
+    const bool isSpeedYDifferent = speed.getY() != batchSpeed.getY();
+    const InstructionSet instructionSet = currentInstructionSet();
+    KernelOutput out;
+
+    for (size_t firstNum = 0; firstNum < batch._count; firstNum += CHUNK_SIZE)
+    {
+        const size_t count = std::min(CHUNK_SIZE, batch._count - firstNum);
+        size_t lane = 0;
+
+#ifdef TOI_KERNEL_HAS_AVX2
+        if (instructionSet == Avx2Instructions)
+            lane = computeLanesAvx2(in, batch, firstNum, lane, count, out);
+#endif
+
+#ifdef TOI_KERNEL_HAS_SSE2
+        if (instructionSet != ScalarInstructions)
+            lane = computeLanesSse2(in, batch, firstNum, lane, count, out);
+#endif
+
+        for ( ; lane < count; ++lane)
+            computeLane(in, batch, firstNum + lane, out, lane);
+
+        chooseHits(out, count, isSpeedXDifferent, isSpeedYDifferent, absoluteTimeError,
+                   minCollisionTime, isHorizontalCollision);
+    }
+}
+
+
+}  // namespace Platformer
@@ -0,0 +1,103 @@
+// TimeOfImpactKernel.h
+
+#ifndef TIMEOFIMPACTKERNEL_H
+#define TIMEOFIMPACTKERNEL_H
+
+#include <vector>
+
+#include "geometry/Point.h"
+#include "geometry/Rectangle.h"
+
+
+namespace Platformer
+{
+
+
+// View of rectangles packed as a structure of arrays
+struct RectangleBatch
+{
+    const double *_lefts   = nullptr;
+    const double *_tops    = nullptr;
+    const double *_widths  = nullptr;
+    const double *_heights = nullptr;
+    size_t _count = 0;
+
+    inline Rectangle getRectangle(size_t num) const
+    {
+        return Rectangle(_lefts[num], _tops[num], _widths[num], _heights[num]);
+    }
+};
+
+
+// Storage of rectangles packed for the kernel
+class PackedRectangles
+{
+public:
+    inline size_t getCount() const
+    {
+        return _lefts.size();
+    }
+
+    inline void addRectangle(const Rectangle &rect)
+    {
+        _lefts.push_back(rect.getLeft());
+        _tops.push_back(rect.getTop());
+        _widths.push_back(rect.getWidth());
+        _heights.push_back(rect.getHeight());
+    }
+
+    inline Rectangle getRectangle(size_t num) const
+    {
+        return Rectangle(_lefts[num], _tops[num], _widths[num], _heights[num]);
+    }
+
+    inline void setRectangle(size_t num, const Rectangle &rect)
+    {
+        _lefts[num]   = rect.getLeft();
+        _tops[num]    = rect.getTop();
+        _widths[num]  = rect.getWidth();
+        _heights[num] = rect.getHeight();
+    }
+
+    void clear();
+    RectangleBatch getBatch() const;
+    RectangleBatch getBatch(size_t firstNum, size_t count) const;
+
+private:
+    std::vector<double> _lefts, _tops, _widths, _heights;
+};
+
+
+// Swept AABB times of impact of one moving rectangle against a batch of
+// rectangles moving with the same speed. All four times and overlap checks
+// are computed for several rectangles at once, then hits are chosen in the
+// batch order, so the result is the same as of the pairwise scalar test.
+// Vector paths are bit exact with the scalar one unless the compiler is
+// allowed to contract floating point operations (e.g. -ffp-contract=fast
+// together with -mfma).
+class TimeOfImpactKernel
+{
+public:
+    enum InstructionSet
+    {
+        ScalarInstructions,
+        Sse2Instructions,
+        Avx2Instructions
+    };
+
+    static InstructionSet getInstructionSet();
+    static bool isSupported(InstructionSet instructionSet);
+    static void setInstructionSet(InstructionSet instructionSet);
+
+    // Updates minCollisionTime and isHorizontalCollision if the rectangle
+    // hits any rectangle of the batch earlier than minCollisionTime.
+    static void findEarliestHit(const Rectangle &rect, const Point &speed,
+                                const RectangleBatch &batch, const Point &batchSpeed,
+                                double frameTimeSec, double absoluteTimeError,
+                                double &minCollisionTime, bool &isHorizontalCollision);
+};
+
+
+}  // namespace Platformer
+
+#endif  // TIMEOFIMPACTKERNEL_H
@@ -0,0 +1,158 @@
+// UniformGridBroadPhase.cpp
+
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+
+#include "UniformGridBroadPhase.h"
+
+
+namespace Platformer
+{
+
+
+struct UniformGridBroadPhase::Impl
+{
+    Impl()
+    {
+    }
+
+    using CellKey = uint64_t;
+    using CellEntry = std::pair<CellKey, size_t>;
+
+    inline long getCellNum(double coordinate) const
+    {
+        return static_cast<long>(std::floor(coordinate / _cellSize));
+    }
+
+    inline CellKey getCellKey(long cellX, long cellY) const
+    {
+        return (static_cast<CellKey>(static_cast<uint32_t>(cellX)) << 32)
+                | static_cast<uint32_t>(cellY);
+    }
+
+    double _cellSize = 64;
+
+    // (cell, proxy) entries sorted by cell, rebuilt on every call
+    std::vector<CellEntry> _cellEntries;
+
+    // proxies covering too many cells are tested against all others
+    std::vector<size_t> _largeProxyNums;
+
+    // constants
+    const long MAX_PROXY_CELL_COUNT = 256;
+};
+
+
+
+UniformGridBroadPhase::UniformGridBroadPhase(double cellSize)
+    : BroadPhase()
+    , _pimpl(new Impl())
+{
+    setCellSize(cellSize);
+}
+
+UniformGridBroadPhase::UniformGridBroadPhase(UniformGridBroadPhase&& /*other*/) = default;
+UniformGridBroadPhase& UniformGridBroadPhase::operator=(UniformGridBroadPhase&& /*other*/) = default;
+UniformGridBroadPhase::~UniformGridBroadPhase() = default;
+
+
+double UniformGridBroadPhase::getCellSize() const
+{
+    return _pimpl->_cellSize;
+}
+
+
+void UniformGridBroadPhase::setCellSize(double cellSize)
+{
+    if (!(cellSize > 0))
+        throw std::logic_error("UniformGridBroadPhase::setCellSize: cell size must be positive");
+
+    _pimpl->_cellSize = cellSize;
+}
+
+
+void UniformGridBroadPhase::doFindPairs(const std::vector<Proxy> &proxies, std::vector<Pair> &pairs)
+{
+    _pimpl->_cellEntries.clear();
+    _pimpl->_largeProxyNums.clear();
+
+    // put proxies to the cells
+    for (size_t proxyNum = 0; proxyNum < proxies.size(); ++proxyNum)
+    {
+        const BoundingBox &box = proxies[proxyNum]._box;
+
+        if (box.isEmpty())
+            continue;
+
+        long firstCellX = _pimpl->getCellNum(box.getLeft());
+        long lastCellX  = _pimpl->getCellNum(box.getRight());
+        long firstCellY = _pimpl->getCellNum(box.getTop());
+        long lastCellY  = _pimpl->getCellNum(box.getBottom());
+
+        if ((lastCellX - firstCellX + 1) * (lastCellY - firstCellY + 1) > _pimpl->MAX_PROXY_CELL_COUNT)
+        {
+            _pimpl->_largeProxyNums.push_back(proxyNum);
+            continue;
+        }
+
+        for (long cellX = firstCellX; cellX <= lastCellX; ++cellX)
+            for (long cellY = firstCellY; cellY <= lastCellY; ++cellY)
+                _pimpl->_cellEntries.emplace_back(_pimpl->getCellKey(cellX, cellY), proxyNum);
+    }
+
+    std::sort(_pimpl->_cellEntries.begin(), _pimpl->_cellEntries.end());
+
+    // test proxies sharing a cell
+    const std::vector<Impl::CellEntry> &entries = _pimpl->_cellEntries;
+
+    for (size_t beginNum = 0, endNum = 0; beginNum < entries.size(); beginNum = endNum)
+    {
+        for (endNum = beginNum + 1; endNum < entries.size() && entries[endNum].first == entries[beginNum].first; )
+            ++endNum;
+
+        for (size_t firstNum = beginNum; firstNum < endNum; ++firstNum)
+            for (size_t secondNum = firstNum + 1; secondNum < endNum; ++secondNum)
+            {
+                const Proxy &firstProxy  = proxies[entries[firstNum].second];
+                const Proxy &secondProxy = proxies[entries[secondNum].second];
+
+                if (!isPairNeeded(firstProxy, secondProxy))
+                    continue;
+
+                // report the pair only from the cell holding the top left
+                // corner of the boxes intersection, so it is reported once
+                long ownerCellX = _pimpl->getCellNum(std::max(firstProxy._box.getLeft(),
+                                                              secondProxy._box.getLeft()));
+                long ownerCellY = _pimpl->getCellNum(std::max(firstProxy._box.getTop(),
+                                                              secondProxy._box.getTop()));
+
+                if (_pimpl->getCellKey(ownerCellX, ownerCellY) == entries[beginNum].first)
+                    pairs.emplace_back(entries[firstNum].second, entries[secondNum].second);
+            }
+    }
+
+    // test large proxies
+    for (size_t largeNum = 0; largeNum < _pimpl->_largeProxyNums.size(); ++largeNum)
+    {
+        size_t largeProxyNum = _pimpl->_largeProxyNums[largeNum];
+
+        for (size_t proxyNum = 0; proxyNum < proxies.size(); ++proxyNum)
+        {
+            // each pair of two large proxies is tested once
+            bool isLarge = std::binary_search(_pimpl->_largeProxyNums.begin(),
+                                         _pimpl->_largeProxyNums.end(), proxyNum);
+
+            if (proxyNum == largeProxyNum || (isLarge && proxyNum < largeProxyNum))
+                continue;
+
+            if (isPairNeeded(proxies[largeProxyNum], proxies[proxyNum]))
+                pairs.emplace_back(std::min(largeProxyNum, proxyNum),
+                                   std::max(largeProxyNum, proxyNum));
+        }
+    }
+}
+
+
+}  // namespace Platformer
@@ -0,0 +1,38 @@
+// UniformGridBroadPhase.h
+
+#ifndef UNIFORMGRIDBROADPHASE_H
+#define UNIFORMGRIDBROADPHASE_H
+
+#include <memory>
+
+#include "BroadPhase.h"
+
+
+namespace Platformer
+{
+
+
+class UniformGridBroadPhase : public BroadPhase
+{
+public:
+    UniformGridBroadPhase(double cellSize = 64);
+    UniformGridBroadPhase(UniformGridBroadPhase&& other);
+    virtual UniformGridBroadPhase& operator=(UniformGridBroadPhase&& other);
+    virtual ~UniformGridBroadPhase();
+
+    double getCellSize() const;
+
+    void setCellSize(double cellSize);
+
+protected:
+    virtual void doFindPairs(const std::vector<Proxy> &proxies, std::vector<Pair> &pairs) override;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> _pimpl;
+};
+
+
+}  // namespace Platformer
+
+#endif  // UNIFORMGRIDBROADPHASE_H
@@ -0,0 +1,170 @@
+// WorkerPool.cpp
+
+#include <stdexcept>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include "WorkerPool.h"
+
+
+namespace Platformer
+{
+
+
+struct WorkerPool::Impl
+{
+    ~Impl()
+    {
+        stopThreads();
+    }
+
+    void startThreads(size_t threadCount);
+    void stopThreads();
+    void runThread(size_t threadNum, size_t lastJobNum);
+    void runTasks(size_t threadNum);
+
+    std::vector<std::thread> _threads;
+    std::mutex _mutex;
+    std::condition_variable _startCondition;
+    std::condition_variable _doneCondition;
+
+    // current job, _jobNum is changed for every run() call
+    const Task *_taskPtr = nullptr;
+    size_t _taskCount = 0;
+    size_t _jobNum = 0;
+    size_t _busyThreadCount = 0;
+    std::atomic<size_t> _nextTaskNum;
+    bool _isStopping = false;
+};
+
+
+
+WorkerPool::WorkerPool(size_t threadCount)
+    : _pimpl(new Impl())
+{
+    _pimpl->_nextTaskNum = 0;
+    setThreadCount(threadCount);
+}
+
+
+WorkerPool::WorkerPool(WorkerPool&& /*other*/) = default;
+WorkerPool& WorkerPool::operator=(WorkerPool&& /*other*/) = default;
+WorkerPool::~WorkerPool() = default;
+
+
+size_t WorkerPool::getThreadCount() const
+{
+    return _pimpl->_threads.size() + 1;
+}
+
+
+void WorkerPool::setThreadCount(size_t threadCount)
+{
+    if (threadCount == 0)
+        throw std::logic_error("WorkerPool::setThreadCount: thread count is zero");
+
+    if (threadCount == getThreadCount())
+        return;
+
+    _pimpl->stopThreads();
+    _pimpl->startThreads(threadCount);
+}
+
+
+void WorkerPool::run(size_t taskCount, const Task &task)
+{
+    if (taskCount == 0)
+        return;
+
+    // nothing to share
+    if (_pimpl->_threads.empty() || taskCount == 1)
+    {
+        for (size_t taskNum = 0; taskNum < taskCount; ++taskNum)
+            task(taskNum, 0);
+
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_pimpl->_mutex);
+        _pimpl->_taskPtr = &task;
+        _pimpl->_taskCount = taskCount;
+        _pimpl->_nextTaskNum = 0;
+        _pimpl->_busyThreadCount = _pimpl->_threads.size();
+        ++_pimpl->_jobNum;
+    }
+
+    _pimpl->_startCondition.notify_all();
+    _pimpl->runTasks(0);
+
+    std::unique_lock<std::mutex> lock(_pimpl->_mutex);
+    _pimpl->_doneCondition.wait(lock, [this]() { return _pimpl->_busyThreadCount == 0; });
+    _pimpl->_taskPtr = nullptr;
+}
+
+
+void WorkerPool::Impl::startThreads(size_t threadCount)
+{
+    _isStopping = false;
+
+    for (size_t threadNum = 1; threadNum < threadCount; ++threadNum)
+        _threads.emplace_back(&Impl::runThread, this, threadNum, _jobNum);
+}
+
+
+void WorkerPool::Impl::stopThreads()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _isStopping = true;
+    }
+
+    _startCondition.notify_all();
+
+    for (std::thread &thread : _threads)
+        thread.join();
+
+    _threads.clear();
+}
+
+
+void WorkerPool::Impl::runThread(size_t threadNum, size_t lastJobNum)
+{
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _startCondition.wait(lock, [this, lastJobNum]() { return _isStopping || _jobNum != lastJobNum; });
+
+            if (_isStopping)
+                return;
+
+            lastJobNum = _jobNum;
+        }
+
+        runTasks(threadNum);
+
+        bool isLast = false;
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            isLast = --_busyThreadCount == 0;
+        }
+
+        if (isLast)
+            _doneCondition.notify_one();
+    }
+}
+
+
+void WorkerPool::Impl::runTasks(size_t threadNum)
+{
+    for (size_t taskNum = _nextTaskNum++; taskNum < _taskCount; taskNum = _nextTaskNum++)
+        (*_taskPtr)(taskNum, threadNum);
+}
+
+
+}  // namespace Platformer
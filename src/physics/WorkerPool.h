@@ -0,0 +1,42 @@
+// WorkerPool.h
+
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <memory>
+#include <functional>
+
+
+namespace Platformer
+{
+
+
+// Fixed set of threads running numbered tasks. The calling thread takes
+// part in the work, so the pool of N threads starts N - 1 workers.
+class WorkerPool
+{
+public:
+    // task number and number of the thread running it (0 is the caller)
+    using Task = std::function<void(size_t taskNum, size_t threadNum)>;
+
+    WorkerPool(size_t threadCount = 1);
+    WorkerPool(WorkerPool&& other);
+    virtual WorkerPool& operator=(WorkerPool&& other);
+    virtual ~WorkerPool();
+
+    size_t getThreadCount() const;
+
+    void setThreadCount(size_t threadCount);
+
+    // runs tasks [0, taskCount) and returns when all of them are done
+    void run(size_t taskCount, const Task &task);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> _pimpl;
+};
+
+
+}  // namespace Platformer
+
+#endif  // WORKERPOOL_H
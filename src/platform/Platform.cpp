@@ -69,6 +69,12 @@ VisualizerPointer Platform::getVisualizer() const
     return _pimpl->_managerPtr->getVisualizer();
 }
 
+ReplayLogPointer Platform::getRecordingLogPtr() const
+{
+    _pimpl->check();
+    return _pimpl->_managerPtr->getRecordingLogPtr();
+}
+
 
 
 
@@ -91,6 +97,13 @@ void Platform::setFPS(double fps)
 }
 
 
+void Platform::setRecordingLogPtr(ReplayLogPointer logPtr)
+{
+    _pimpl->check();
+    _pimpl->_managerPtr->setRecordingLogPtr(logPtr);
+}
+
+
 void Platform::showWarning(const std::string &what)
 {
     _pimpl->check();
@@ -24,9 +24,11 @@ public:
     double getFPS() const;
     double getActualFrameTime() const;
     VisualizerPointer getVisualizer() const;
+    ReplayLogPointer getRecordingLogPtr() const;
 
     void initialize(PlatformManagerPointer managerPtr);
     void setFPS(double fps);
+    void setRecordingLogPtr(ReplayLogPointer logPtr);
     void showWarning(const std::string &what);
     void showError(const std::string &what);
     void triggerKey(char ch, bool isPressed);
@@ -10,6 +10,7 @@
 //#include <QTimer>
 
 //#include "PlatformerApplication.h"
+#include "ReplayLog.h"
 #include "PlatformManager.h"
 
 
@@ -26,6 +27,12 @@ struct PlatformManager::Impl
     std::map<char, KeySet> _charKeyRegistry;
     std::map<Key::KeyId, KeySet> _idKeyRegistry;
 
+    // pressed keys are tracked for recording, repeated presses aren't
+    // transitions
+    std::set<char> _pressedChars;
+    std::set<Key::KeyId> _pressedKeyIds;
+    ReplayLogPointer _recordingLogPtr;
+
     std::chrono::high_resolution_clock::time_point _lastTimePoint;
     std::chrono::duration<double> _frameTime;
 };
@@ -60,6 +67,11 @@ VisualizerPointer PlatformManager::getVisualizer() const
     return _pimpl->_visualizerPtr;
 }
 
+ReplayLogPointer PlatformManager::getRecordingLogPtr() const
+{
+    return _pimpl->_recordingLogPtr;
+}
+
 
 void PlatformManager::setFPS(double fps)
 {
@@ -74,6 +86,32 @@ void PlatformManager::setVisualizer(VisualizerPointer visualizerPtr)
 }
 
 
+void PlatformManager::setRecordingLogPtr(ReplayLogPointer logPtr)
+{
+    _pimpl->_recordingLogPtr = logPtr;
+
+    if (logPtr == nullptr)
+        return;
+
+    ReplayLog::KeyEvent event;
+    event._isPressed = true;
+
+    for (char ch : _pimpl->_pressedChars)
+    {
+        event._char = ch;
+        logPtr->addKeyEvent(event);
+    }
+
+    event._char = 0;
+
+    for (Key::KeyId id : _pimpl->_pressedKeyIds)
+    {
+        event._keyId = id;
+        logPtr->addKeyEvent(event);
+    }
+}
+
+
 void PlatformManager::showWarning(const std::string &what)
 {
     std::cerr << what << std::endl;
@@ -113,6 +151,17 @@ void PlatformManager::unregisterKey(SimpleKeyPointer keyPtr)
 }
 
 
+void PlatformManager::handleFrame()
+{
+    // key events since the last frame belong to this one
+    if (_pimpl->_recordingLogPtr != nullptr)
+        _pimpl->_recordingLogPtr->addFrame(getActualFrameTime());
+
+    if (frameHandler != nullptr)
+        frameHandler();
+}
+
+
 void PlatformManager::updateActualFrameTime()
 {
     std::chrono::high_resolution_clock::time_point point
@@ -122,6 +171,12 @@ void PlatformManager::updateActualFrameTime()
 }
 
 
+void PlatformManager::setActualFrameTime(double frameTimeSec)
+{
+    _pimpl->_frameTime = std::chrono::duration<double>(frameTimeSec);
+}
+
+
 void PlatformManager::doSetFPS(double /*fps*/)
 {
 }
@@ -142,12 +197,30 @@ void PlatformManager::triggerKey(char ch, bool isPressed)
 {
     // TODO: do not process char that has no registred Key objects
 
+    if (isPressed ? _pimpl->_pressedChars.insert(ch).second : _pimpl->_pressedChars.erase(ch) != 0)
+        if (_pimpl->_recordingLogPtr != nullptr)
+        {
+            ReplayLog::KeyEvent event;
+            event._char = ch;
+            event._isPressed = isPressed;
+            _pimpl->_recordingLogPtr->addKeyEvent(event);
+        }
+
     for (SimpleKeyPointer keyPtr : _pimpl->_charKeyRegistry[ch])
         keyPtr->setIsPressed(isPressed);
 }
 
 void PlatformManager::triggerKey(Key::KeyId id, bool isPressed)
 {
+    if (isPressed ? _pimpl->_pressedKeyIds.insert(id).second : _pimpl->_pressedKeyIds.erase(id) != 0)
+        if (_pimpl->_recordingLogPtr != nullptr)
+        {
+            ReplayLog::KeyEvent event;
+            event._keyId = id;
+            event._isPressed = isPressed;
+            _pimpl->_recordingLogPtr->addKeyEvent(event);
+        }
+
     for (SimpleKeyPointer keyPtr : _pimpl->_idKeyRegistry[id])
         keyPtr->setIsPressed(isPressed);
 }
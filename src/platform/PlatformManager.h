@@ -26,9 +26,15 @@ public:
     double getFPS() const;
     double getActualFrameTime() const;
     VisualizerPointer getVisualizer() const;
+    ReplayLogPointer getRecordingLogPtr() const;
 
     void setFPS(double fps);
     void setVisualizer(VisualizerPointer visualizerPtr);
+
+    // Frame times & key transitions are appended to the log, until it's
+    // reset by nullptr. Keys pressed at the start are recorded as pressed
+    // before the first frame.
+    void setRecordingLogPtr(ReplayLogPointer logPtr);
     void showWarning(const std::string &what);
     void showError(const std::string &what);
     void triggerKey(char ch, bool isPressed);
@@ -44,7 +50,11 @@ public:
 
 protected:
     PlatformManager(int &argc, char *argv[]);
+
+    // managers call it on every frame instead of the frame handler
+    void handleFrame();
     void updateActualFrameTime();
+    void setActualFrameTime(double frameTimeSec);
     virtual void doSetFPS(double fps);
     virtual void doSetVisualizer(VisualizerPointer visualizerPtr);
     virtual void doShowWarning(const std::string &what);
@@ -0,0 +1,295 @@
+// ReplayLog.cpp
+
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+
+#include "ReplayLog.h"
+
+
+namespace Platformer
+{
+
+
+struct ReplayLog::Impl
+{
+    // events of the frame are from the end of the previous frame ones to
+    // _eventEndNum, events after the last frame ones are pending
+    struct Frame
+    {
+        double _frameTime = 0;
+        size_t _eventEndNum = 0;
+    };
+
+    enum EventFlag : uint8_t
+    {
+        PressedEvent = 1,
+        KeyIdEvent   = 2
+    };
+
+    Impl()
+    {
+    }
+
+    inline size_t getEventBeginNum(size_t frameNum) const
+    {
+        return frameNum == 0 ? 0 : _frames[frameNum - 1]._eventEndNum;
+    }
+
+    static void writeNumber(std::ostream &stream, uint64_t number, size_t byteCount);
+    static void writeCount(std::ostream &stream, size_t count);
+    static bool readByte(std::istream &stream, uint8_t &byte);
+    static uint64_t readNumber(std::istream &stream, size_t byteCount);
+    static size_t readCount(std::istream &stream);
+
+    static const char MAGIC[4];
+    static const uint8_t VERSION = 1;
+
+    std::vector<Frame> _frames;
+    std::vector<KeyEvent> _events;
+};
+
+
+const char ReplayLog::Impl::MAGIC[4] = {'P', 'L', 'R', 'L'};
+
+
+
+ReplayLog::ReplayLog()
+    : _pimpl(new Impl())
+{
+}
+
+
+ReplayLog::ReplayLog(ReplayLog&& /*other*/) = default;
+ReplayLog& ReplayLog::operator=(ReplayLog&& /*other*/) = default;
+ReplayLog::~ReplayLog() = default;
+
+
+size_t ReplayLog::getFrameCount() const
+{
+    return _pimpl->_frames.size();
+}
+
+
+double ReplayLog::getFrameTime(size_t frameNum) const
+{
+    if (frameNum >= _pimpl->_frames.size())
+        throw std::logic_error("ReplayLog::getFrameTime: wrong frame number");
+
+    return _pimpl->_frames[frameNum]._frameTime;
+}
+
+
+size_t ReplayLog::getKeyEventCount(size_t frameNum) const
+{
+    if (frameNum >= _pimpl->_frames.size())
+        throw std::logic_error("ReplayLog::getKeyEventCount: wrong frame number");
+
+    return _pimpl->_frames[frameNum]._eventEndNum - _pimpl->getEventBeginNum(frameNum);
+}
+
+
+const ReplayLog::KeyEvent &ReplayLog::getKeyEvent(size_t frameNum, size_t eventNum) const
+{
+    if (eventNum >= getKeyEventCount(frameNum))
+        throw std::logic_error("ReplayLog::getKeyEvent: wrong event number");
+
+    return _pimpl->_events[_pimpl->getEventBeginNum(frameNum) + eventNum];
+}
+
+
+void ReplayLog::addKeyEvent(const KeyEvent &event)
+{
+    _pimpl->_events.push_back(event);
+}
+
+
+void ReplayLog::addFrame(double frameTimeSec)
+{
+    Impl::Frame frame;
+    frame._frameTime = frameTimeSec;
+    frame._eventEndNum = _pimpl->_events.size();
+    _pimpl->_frames.push_back(frame);
+}
+
+
+void ReplayLog::clear()
+{
+    _pimpl->_frames.clear();
+    _pimpl->_events.clear();
+}
+
+
+void ReplayLog::write(std::ostream &stream) const
+{
+    stream.write(Impl::MAGIC, sizeof(Impl::MAGIC));
+    stream.put(static_cast<char>(Impl::VERSION));
+
+    for (size_t frameNum = 0; frameNum < _pimpl->_frames.size(); ++frameNum)
+    {
+        // frame times are kept exactly, replayed steps have to be the same
+        uint64_t frameTimeBits = 0;
+        std::memcpy(&frameTimeBits, &_pimpl->_frames[frameNum]._frameTime, sizeof(frameTimeBits));
+        Impl::writeNumber(stream, frameTimeBits, sizeof(frameTimeBits));
+        Impl::writeCount(stream, getKeyEventCount(frameNum));
+
+        for (size_t eventNum = 0; eventNum < getKeyEventCount(frameNum); ++eventNum)
+        {
+            const KeyEvent &event = getKeyEvent(frameNum, eventNum);
+            const bool isKeyId = event._char == 0;
+
+            stream.put(isKeyId ? static_cast<char>(event._keyId) : event._char);
+            stream.put(static_cast<char>((event._isPressed ? Impl::PressedEvent : 0)
+                                         | (isKeyId ? Impl::KeyIdEvent : 0)));
+        }
+    }
+
+    if (!stream)
+        throw std::runtime_error("ReplayLog::write: can't write the log");
+}
+
+
+void ReplayLog::write(const std::string &fileName) const
+{
+    std::ofstream stream(fileName, std::ios::binary);
+
+    if (!stream)
+        throw std::runtime_error("ReplayLog::write: can't open " + fileName);
+
+    write(stream);
+}
+
+
+void ReplayLog::read(std::istream &stream)
+{
+    char magic[sizeof(Impl::MAGIC)] = {};
+    uint8_t version = 0;
+
+    if (!stream.read(magic, sizeof(magic)) || std::memcmp(magic, Impl::MAGIC, sizeof(magic)) != 0
+            || !Impl::readByte(stream, version))
+        throw std::runtime_error("ReplayLog::read: it isn't a replay log");
+
+    if (version != Impl::VERSION)
+        throw std::runtime_error("ReplayLog::read: unknown log version");
+
+    ReplayLog log;
+    uint8_t firstByte = 0;
+
+    // frames go till the end of the stream, the first byte is checked to
+    // tell the end from a cut frame
+    while (Impl::readByte(stream, firstByte))
+    {
+        uint64_t frameTimeBits = firstByte | Impl::readNumber(stream, sizeof(frameTimeBits) - 1) << 8;
+        double frameTimeSec = 0;
+        std::memcpy(&frameTimeSec, &frameTimeBits, sizeof(frameTimeSec));
+
+        const size_t eventCount = Impl::readCount(stream);
+
+        for (size_t eventNum = 0; eventNum < eventCount; ++eventNum)
+        {
+            const uint8_t code = static_cast<uint8_t>(Impl::readNumber(stream, 1));
+            const uint8_t flags = static_cast<uint8_t>(Impl::readNumber(stream, 1));
+            KeyEvent event;
+
+            if ((flags & Impl::KeyIdEvent) == 0)
+                event._char = static_cast<char>(code);
+            else if (code <= Key::Down)
+                event._keyId = static_cast<Key::KeyId>(code);
+            else
+                throw std::runtime_error("ReplayLog::read: unknown key id");
+
+            event._isPressed = (flags & Impl::PressedEvent) != 0;
+            log.addKeyEvent(event);
+        }
+
+        log.addFrame(frameTimeSec);
+    }
+
+    *this = std::move(log);
+}
+
+
+void ReplayLog::read(const std::string &fileName)
+{
+    std::ifstream stream(fileName, std::ios::binary);
+
+    if (!stream)
+        throw std::runtime_error("ReplayLog::read: can't open " + fileName);
+
+    read(stream);
+}
+
+
+void ReplayLog::Impl::writeNumber(std::ostream &stream, uint64_t number, size_t byteCount)
+{
+    for (size_t byteNum = 0; byteNum < byteCount; ++byteNum)
+        stream.put(static_cast<char>((number >> (8 * byteNum)) & 0xFF));
+}
+
+
+void ReplayLog::Impl::writeCount(std::ostream &stream, size_t count)
+{
+    // 7 bits per byte, the high bit marks the next byte, so frames
+    // without events take one byte
+    do
+    {
+        const uint8_t byte = count & 0x7F;
+        count >>= 7;
+        stream.put(static_cast<char>(count != 0 ? byte | 0x80 : byte));
+    }
+    while (count != 0);
+}
+
+
+bool ReplayLog::Impl::readByte(std::istream &stream, uint8_t &byte)
+{
+    const std::istream::int_type value = stream.get();
+
+    if (value == std::istream::traits_type::eof())
+        return false;
+
+    byte = static_cast<uint8_t>(value);
+    return true;
+}
+
+
+uint64_t ReplayLog::Impl::readNumber(std::istream &stream, size_t byteCount)
+{
+    uint64_t number = 0;
+
+    for (size_t byteNum = 0; byteNum < byteCount; ++byteNum)
+    {
+        uint8_t byte = 0;
+
+        if (!readByte(stream, byte))
+            throw std::runtime_error("ReplayLog::read: the log is cut");
+
+        number |= static_cast<uint64_t>(byte) << (8 * byteNum);
+    }
+
+    return number;
+}
+
+
+size_t ReplayLog::Impl::readCount(std::istream &stream)
+{
+    size_t count = 0;
+    uint8_t byte = 0;
+
+    for (size_t shift = 0; ; shift += 7)
+    {
+        if (shift >= 8 * sizeof(count))
+            throw std::runtime_error("ReplayLog::read: wrong event count");
+
+        byte = static_cast<uint8_t>(readNumber(stream, 1));
+        count |= static_cast<size_t>(byte & 0x7F) << shift;
+
+        if ((byte & 0x80) == 0)
+            return count;
+    }
+}
+
+
+}  // namespace Platformer
@@ -0,0 +1,68 @@
+// ReplayLog.h
+
+#ifndef REPLAYLOG_H
+#define REPLAYLOG_H
+
+#include <memory>
+#include <string>
+#include <istream>
+#include <ostream>
+
+#include "Types.h"
+#include "Key.h"
+
+
+namespace Platformer
+{
+
+
+// Frame times & key transitions of a game session. The platform manager
+// records them while its recording log is set, HeadlessPlatformManager
+// replays them with the same frame times & key events before every frame,
+// so the session is reproduced without the window & the timer. Replays are
+// exact while the engine has no collision time budget.
+class ReplayLog
+{
+public:
+    // key is given by the char, if it isn't zero, else by the key id
+    struct KeyEvent
+    {
+        char _char = 0;
+        Key::KeyId _keyId = Key::Unknown;
+        bool _isPressed = false;
+    };
+
+    ReplayLog();
+    ReplayLog(ReplayLog&& other);
+    virtual ReplayLog& operator=(ReplayLog&& other);
+    virtual ~ReplayLog();
+
+    size_t getFrameCount() const;
+    double getFrameTime(size_t frameNum) const;
+
+    // key events triggered before the frame handler of the frame
+    size_t getKeyEventCount(size_t frameNum) const;
+    const KeyEvent &getKeyEvent(size_t frameNum, size_t eventNum) const;
+
+    // key events are added to the next frame
+    void addKeyEvent(const KeyEvent &event);
+    void addFrame(double frameTimeSec);
+    void clear();
+
+    // Compact binary format: a header, then 8 bytes of the frame time, the
+    // event count & 2 bytes per event for every frame. Numbers are little
+    // endian, so logs are portable between machines.
+    void write(std::ostream &stream) const;
+    void write(const std::string &fileName) const;
+    void read(std::istream &stream);
+    void read(const std::string &fileName);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> _pimpl;
+};
+
+
+}  // namespace Platformer
+
+#endif  // REPLAYLOG_H
@@ -0,0 +1,223 @@
+// TraceRecorder.cpp
+
+#include <vector>
+#include <mutex>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+#include "TraceRecorder.h"
+
+
+namespace Platformer
+{
+
+
+struct TraceRecorder::Impl
+{
+    struct Event
+    {
+        const char *_name = nullptr;
+        const char *_category = nullptr;
+        Clock::time_point _startPoint;
+        Clock::time_point _endPoint;
+    };
+
+    // Only the owner thread writes events, the total count is published
+    // after the event, the ring place of an event is its number modulo
+    // the capacity. Buffers outlive their threads.
+    struct ThreadBuffer
+    {
+        std::vector<Event> _events;
+        std::atomic<size_t> _eventCount{0};
+        size_t _threadNum = 0;
+    };
+
+    Impl()
+    {
+    }
+
+    ThreadBuffer *getThreadBuffer();
+    static void writeString(std::ostream &stream, const char *text);
+
+    // the mutex guards the buffer list, events are written without it
+    mutable std::mutex _mutex;
+    std::vector<std::unique_ptr<ThreadBuffer> > _buffers;
+    size_t _eventCapacity = 1 << 16;
+    Clock::time_point _startPoint = Clock::now();
+};
+
+
+std::atomic<bool> TraceRecorder::_isEnabled{false};
+
+
+TraceRecorder::TraceRecorder()
+    : _pimpl(new Impl())
+{
+}
+
+
+TraceRecorder::~TraceRecorder()
+{
+}
+
+
+TraceRecorder *TraceRecorder::instance()
+{
+    // worker threads record events too, the local static is made once
+    static std::unique_ptr<TraceRecorder> instancePtr(new TraceRecorder());
+    return instancePtr.get();
+}
+
+
+size_t TraceRecorder::getEventCapacity() const
+{
+    std::lock_guard<std::mutex> lock(_pimpl->_mutex);
+    return _pimpl->_eventCapacity;
+}
+
+
+void TraceRecorder::setEnabled(bool isEnabled)
+{
+    _isEnabled.store(isEnabled, std::memory_order_relaxed);
+}
+
+
+void TraceRecorder::setEventCapacity(size_t capacity)
+{
+    if (capacity == 0)
+        throw std::logic_error("TraceRecorder::setEventCapacity: capacity is zero");
+
+    if (isEnabled())
+        throw std::logic_error("TraceRecorder::setEventCapacity: recording is enabled");
+
+    std::lock_guard<std::mutex> lock(_pimpl->_mutex);
+    _pimpl->_eventCapacity = capacity;
+
+    for (std::unique_ptr<Impl::ThreadBuffer> &bufferPtr : _pimpl->_buffers)
+    {
+        bufferPtr->_events.assign(capacity, Impl::Event());
+        bufferPtr->_eventCount.store(0, std::memory_order_relaxed);
+    }
+}
+
+
+void TraceRecorder::clear()
+{
+    std::lock_guard<std::mutex> lock(_pimpl->_mutex);
+
+    for (std::unique_ptr<Impl::ThreadBuffer> &bufferPtr : _pimpl->_buffers)
+        bufferPtr->_eventCount.store(0, std::memory_order_relaxed);
+}
+
+
+void TraceRecorder::addEvent(const char *name, const char *category,
+                             Clock::time_point startPoint, Clock::time_point endPoint)
+{
+    Impl::ThreadBuffer *bufferPtr = _pimpl->getThreadBuffer();
+    const size_t eventCount = bufferPtr->_eventCount.load(std::memory_order_relaxed);
+
+    Impl::Event &event = bufferPtr->_events[eventCount % bufferPtr->_events.size()];
+    event._name = name;
+    event._category = category;
+    event._startPoint = startPoint;
+    event._endPoint = endPoint;
+
+    bufferPtr->_eventCount.store(eventCount + 1, std::memory_order_release);
+}
+
+
+void TraceRecorder::writeJson(std::ostream &stream) const
+{
+    std::lock_guard<std::mutex> lock(_pimpl->_mutex);
+    bool isFirstEvent = true;
+
+    const std::ios_base::fmtflags flags = stream.flags();
+    const std::streamsize precision = stream.precision();
+
+    stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    stream << std::fixed << std::setprecision(3);
+
+    for (const std::unique_ptr<Impl::ThreadBuffer> &bufferPtr : _pimpl->_buffers)
+    {
+        const size_t eventCount = bufferPtr->_eventCount.load(std::memory_order_acquire);
+        const size_t capacity = bufferPtr->_events.size();
+
+        // threads are numbered by their first events, the names make
+        // the rows of the viewer
+        stream << (isFirstEvent ? "\n" : ",\n")
+               << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << bufferPtr->_threadNum
+               << ",\"args\":{\"name\":\"thread " << bufferPtr->_threadNum << "\"}}";
+        isFirstEvent = false;
+
+        // the oldest kept event goes first
+        for (size_t eventNum = eventCount > capacity ? eventCount - capacity : 0; eventNum < eventCount; ++eventNum)
+        {
+            const Impl::Event &event = bufferPtr->_events[eventNum % capacity];
+            const double startTime = std::chrono::duration<double, std::micro>(event._startPoint
+                                                                               - _pimpl->_startPoint).count();
+            const double duration = std::chrono::duration<double, std::micro>(event._endPoint
+                                                                              - event._startPoint).count();
+
+            stream << ",\n{\"name\":";
+            Impl::writeString(stream, event._name);
+            stream << ",\"cat\":";
+            Impl::writeString(stream, event._category);
+            stream << ",\"ph\":\"X\",\"ts\":" << startTime << ",\"dur\":" << duration
+                   << ",\"pid\":1,\"tid\":" << bufferPtr->_threadNum << "}";
+        }
+    }
+
+    stream << "\n]}\n";
+    stream.flags(flags);
+    stream.precision(precision);
+}
+
+
+void TraceRecorder::writeJson(const std::string &fileName) const
+{
+    std::ofstream stream(fileName);
+
+    if (!stream)
+        throw std::runtime_error("TraceRecorder::writeJson: can't open " + fileName);
+
+    writeJson(stream);
+}
+
+
+TraceRecorder::Impl::ThreadBuffer *TraceRecorder::Impl::getThreadBuffer()
+{
+    // the buffer of the thread is made by its first event
+    static thread_local ThreadBuffer *threadBufferPtr = nullptr;
+
+    if (threadBufferPtr != nullptr)
+        return threadBufferPtr;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::unique_ptr<ThreadBuffer> bufferPtr(new ThreadBuffer());
+    bufferPtr->_events.resize(_eventCapacity);
+    bufferPtr->_threadNum = _buffers.size();
+
+    threadBufferPtr = bufferPtr.get();
+    _buffers.push_back(std::move(bufferPtr));
+    return threadBufferPtr;
+}
+
+
+void TraceRecorder::Impl::writeString(std::ostream &stream, const char *text)
+{
+    stream << '"';
+
+    for (const char *charPtr = text; *charPtr != 0; ++charPtr)
+    {
+        if (*charPtr == '"' || *charPtr == '\\')
+            stream << '\\';
+
+        stream << *charPtr;
+    }
+
+    stream << '"';
+}
+
+
+}  // namespace Platformer
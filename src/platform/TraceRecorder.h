@@ -0,0 +1,91 @@
+// TraceRecorder.h
+
+#ifndef TRACERECORDER_H
+#define TRACERECORDER_H
+
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <ostream>
+
+
+namespace Platformer
+{
+
+
+// Timeline of game & engine frames written in the Trace Event JSON format of
+// chrome://tracing and Perfetto. Every thread records complete events to its
+// own ring buffer without locks, the oldest events are overwritten. Events
+// are written out & cleared between frames, when no thread is recording.
+class TraceRecorder
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // complete event of the enclosing scope, names have to be string literals
+    class Scope
+    {
+    public:
+        inline Scope(const char *name, const char *category = "game")
+            : _name(name)
+            , _category(category)
+            , _isRecorded(TraceRecorder::isEnabled())
+        {
+            if (_isRecorded)
+                _startPoint = Clock::now();
+        }
+
+        inline ~Scope()
+        {
+            if (_isRecorded)
+                TraceRecorder::instance()->addEvent(_name, _category, _startPoint, Clock::now());
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char *_name;
+        const char *_category;
+        bool _isRecorded;
+        Clock::time_point _startPoint;
+    };
+
+    virtual ~TraceRecorder();
+
+    static TraceRecorder *instance();
+
+    static inline bool isEnabled()
+    {
+        return _isEnabled.load(std::memory_order_relaxed);
+    }
+
+    // number of the last events kept for every thread
+    size_t getEventCapacity() const;
+
+    void setEnabled(bool isEnabled);
+    void setEventCapacity(size_t capacity);
+    void clear();
+
+    // names & categories are kept as pointers, they have to be string literals
+    void addEvent(const char *name, const char *category,
+                  Clock::time_point startPoint, Clock::time_point endPoint);
+
+    void writeJson(std::ostream &stream) const;
+    void writeJson(const std::string &fileName) const;
+
+protected:
+    TraceRecorder();
+
+private:
+    static std::atomic<bool> _isEnabled;
+
+    struct Impl;
+    std::unique_ptr<Impl> _pimpl;
+};
+
+
+}  // namespace Platformer
+
+#endif  // TRACERECORDER_H
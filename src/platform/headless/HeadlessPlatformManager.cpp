@@ -0,0 +1,130 @@
+// HeadlessPlatformManager.cpp
+
+#include <stdexcept>
+
+#include "platform/ReplayLog.h"
+#include "HeadlessVisualizer.h"
+#include "HeadlessPlatformManager.h"
+
+
+namespace Platformer
+{
+
+
+struct HeadlessPlatformManager::Impl
+{
+    Impl()
+    {
+    }
+
+    size_t _frameCount = 0;
+    size_t _frameNum = 0;
+    bool _isFrameLoopStarted = false;
+    ReplayLogPointer _replayLogPtr;
+};
+
+
+
+HeadlessPlatformManager::HeadlessPlatformManager(int &argc, char *argv[])
+    : PlatformManager(argc, argv)
+    , _pimpl(new Impl())
+{
+    setActualFrameTime(1.0 / getFPS());
+    setVisualizer(std::make_shared<HeadlessVisualizer>());
+}
+
+
+HeadlessPlatformManager::HeadlessPlatformManager(HeadlessPlatformManager&& /*other*/) = default;
+HeadlessPlatformManager& HeadlessPlatformManager::operator=(HeadlessPlatformManager&& /*other*/) = default;
+HeadlessPlatformManager::~HeadlessPlatformManager() = default;
+
+
+size_t HeadlessPlatformManager::getFrameCount() const
+{
+    return _pimpl->_frameCount;
+}
+
+
+size_t HeadlessPlatformManager::getFrameNum() const
+{
+    return _pimpl->_frameNum;
+}
+
+
+ReplayLogPointer HeadlessPlatformManager::getReplayLogPtr() const
+{
+    return _pimpl->_replayLogPtr;
+}
+
+
+void HeadlessPlatformManager::setFrameCount(size_t frameCount)
+{
+    _pimpl->_frameCount = frameCount;
+}
+
+
+void HeadlessPlatformManager::setReplayLogPtr(ReplayLogPointer logPtr)
+{
+    // frames after the replay are fixed again
+    _pimpl->_replayLogPtr = logPtr;
+    setActualFrameTime(1.0 / getFPS());
+}
+
+
+void HeadlessPlatformManager::startFrameLoop()
+{
+    _pimpl->_isFrameLoopStarted = true;
+}
+
+
+void HeadlessPlatformManager::stopFrameLoop()
+{
+    _pimpl->_isFrameLoopStarted = false;
+}
+
+
+int HeadlessPlatformManager::runMainLoop()
+{
+    _pimpl->_frameNum = 0;
+
+    while (_pimpl->_isFrameLoopStarted
+           && (_pimpl->_frameCount == 0 || _pimpl->_frameNum < _pimpl->_frameCount))
+    {
+        const ReplayLogPointer &logPtr = _pimpl->_replayLogPtr;
+
+        if (logPtr != nullptr)
+        {
+            if (_pimpl->_frameNum >= logPtr->getFrameCount())
+                break;
+
+            setActualFrameTime(logPtr->getFrameTime(_pimpl->_frameNum));
+
+            for (size_t eventNum = 0; eventNum < logPtr->getKeyEventCount(_pimpl->_frameNum); ++eventNum)
+            {
+                const ReplayLog::KeyEvent &event = logPtr->getKeyEvent(_pimpl->_frameNum, eventNum);
+
+                if (event._char != 0)
+                    triggerKey(event._char, event._isPressed);
+                else
+                    triggerKey(event._keyId, event._isPressed);
+            }
+        }
+
+        handleFrame();
+        ++_pimpl->_frameNum;
+    }
+
+    return 0;
+}
+
+
+void HeadlessPlatformManager::doSetFPS(double fps)
+{
+    if (fps <= 0)
+        throw std::logic_error("HeadlessPlatformManager::doSetFPS: FPS is not positive");
+
+    setActualFrameTime(1.0 / fps);
+}
+
+
+}  // namespace Platformer
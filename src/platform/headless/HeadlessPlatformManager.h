@@ -0,0 +1,53 @@
+// HeadlessPlatformManager.h
+
+#ifndef HEADLESSPLATFORMMANAGER_H
+#define HEADLESSPLATFORMMANAGER_H
+
+#include <memory>
+#include <string>
+
+#include "platform/PlatformManager.h"
+#include "Types.h"
+
+
+namespace Platformer
+{
+
+
+// Platform without a window and a timer. The main loop calls the frame
+// handler as fast as possible with the fixed frame time of 1 / FPS, so
+// runs are deterministic and don't depend on the machine speed. A replay
+// log gives recorded frame times & key events to the frames instead.
+class HeadlessPlatformManager : public PlatformManager
+{
+public:
+    HeadlessPlatformManager(int &argc, char *argv[]);
+    HeadlessPlatformManager(HeadlessPlatformManager&& other);
+    virtual HeadlessPlatformManager& operator=(HeadlessPlatformManager&& other);
+    virtual ~HeadlessPlatformManager();
+
+    size_t getFrameCount() const;
+    size_t getFrameNum() const;
+    ReplayLogPointer getReplayLogPtr() const;
+
+    // main loop returns after frameCount frames, zero count means no limit
+    void setFrameCount(size_t frameCount);
+
+    // the main loop returns after the last frame of the log too
+    void setReplayLogPtr(ReplayLogPointer logPtr);
+    virtual void startFrameLoop() override;
+    virtual void stopFrameLoop() override;
+    virtual int runMainLoop() override;
+
+protected:
+    virtual void doSetFPS(double fps) override;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> _pimpl;
+};
+
+
+}  // namespace Platformer
+
+#endif  // HEADLESSPLATFORMMANAGER_H
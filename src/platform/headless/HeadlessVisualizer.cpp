@@ -0,0 +1,54 @@
+// HeadlessVisualizer.cpp
+
+#include "HeadlessVisualizer.h"
+
+
+namespace Platformer
+{
+
+
+struct HeadlessVisualizer::Impl
+{
+    Impl()
+    {
+    }
+
+    Rectangle _sceneRect;
+};
+
+
+
+HeadlessVisualizer::HeadlessVisualizer()
+    : _pimpl(new Impl())
+{
+}
+
+
+HeadlessVisualizer::HeadlessVisualizer(HeadlessVisualizer&& /*other*/) = default;
+HeadlessVisualizer& HeadlessVisualizer::operator=(HeadlessVisualizer&& /*other*/) = default;
+HeadlessVisualizer::~HeadlessVisualizer() = default;
+
+
+Rectangle HeadlessVisualizer::getSceneRect() const
+{
+    return _pimpl->_sceneRect;
+}
+
+
+void HeadlessVisualizer::clear()
+{
+}
+
+
+void HeadlessVisualizer::drawRect(const Rectangle &/*rect*/, bool /*isMovable*/, bool /*isStatic*/, bool /*isStand*/)
+{
+}
+
+
+void HeadlessVisualizer::setSceneRect(const Rectangle &rect)
+{
+    _pimpl->_sceneRect = rect;
+}
+
+
+}  // namespace Platformer
@@ -0,0 +1,39 @@
+// HeadlessVisualizer.h
+
+#ifndef HEADLESSVISUALIZER_H
+#define HEADLESSVISUALIZER_H
+
+#include <memory>
+
+#include "visualizer/Visualizer.h"
+
+
+namespace Platformer
+{
+
+
+// Visualizer of the headless platform, it keeps the scene rectangle and
+// draws nothing, so the game runs without a window.
+class HeadlessVisualizer : public Visualizer
+{
+public:
+    HeadlessVisualizer();
+    HeadlessVisualizer(HeadlessVisualizer&& other);
+    virtual HeadlessVisualizer& operator=(HeadlessVisualizer&& other);
+    virtual ~HeadlessVisualizer();
+
+    virtual Rectangle getSceneRect() const override;
+
+    virtual void clear() override;
+    virtual void drawRect(const Rectangle &rect, bool isMovable, bool isStatic, bool isStand) override;
+    virtual void setSceneRect(const Rectangle &rect) override;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> _pimpl;
+};
+
+
+}  // namespace Platformer
+
+#endif  // HEADLESSVISUALIZER_H
@@ -0,0 +1,477 @@
+// SoftwareVisualizer.cpp
+
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOFTWARE_VISUALIZER_HAS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#include "SoftwareVisualizer.h"
+
+
+namespace Platformer
+{
+
+
+namespace
+{
+
+
+inline uint32_t makeColor(uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha = 255)
+{
+    return   static_cast<uint32_t>(red)          | static_cast<uint32_t>(green) << 8
+           | static_cast<uint32_t>(blue)  << 16  | static_cast<uint32_t>(alpha) << 24;
+}
+
+
+// colors of Qt::lightGray, Qt::white, Qt::gray & Qt::black
+const uint32_t BACKGROUND_COLOR = makeColor(192, 192, 192);
+const uint32_t MOVABLE_COLOR    = makeColor(255, 255, 255);
+const uint32_t STATIC_COLOR     = makeColor(160, 160, 164);
+const uint32_t PEN_COLOR        = makeColor(0, 0, 0);
+
+// far coordinates are clamped, so pixel arithmetic can't overflow
+const double MAX_COORDINATE = 1 << 30;
+
+
+}  // namespace
+
+
+
+struct SoftwareVisualizer::Impl
+{
+    Impl()
+    {
+    }
+
+    void resize(size_t width, size_t height);
+
+    // corners are inclusive, the rectangle is clipped by the framebuffer
+    void fillRect(int64_t left, int64_t top, int64_t right, int64_t bottom, uint32_t color);
+    void drawLine(int64_t firstX, int64_t firstY, int64_t secondX, int64_t secondY, uint32_t color);
+    void clipSteps(int64_t start, int64_t shift, int64_t stepCount, size_t size,
+                   int64_t &firstStep, int64_t &lastStep) const;
+
+    static void fillSpan(uint32_t *pixelPtr, size_t count, uint32_t color);
+    static int64_t roundToPixel(double coordinate);
+
+    void writePpm(std::ostream &stream) const;
+    void writePng(std::ostream &stream) const;
+    static void writePngChunk(std::ostream &stream, const char *type, const std::vector<uint8_t> &data);
+    static void writeBigEndian(std::ostream &stream, uint32_t number);
+    static uint32_t getCrc(const char *type, const std::vector<uint8_t> &data);
+
+    size_t _width = 0;
+    size_t _height = 0;
+    std::vector<uint32_t> _pixels;
+
+    size_t _frameCount = 0;
+    std::string _dumpPrefix;
+    ImageFormat _dumpFormat = PngFormat;
+};
+
+
+
+SoftwareVisualizer::SoftwareVisualizer(size_t width, size_t height)
+    : _pimpl(new Impl())
+{
+    _pimpl->resize(width, height);
+}
+
+
+SoftwareVisualizer::SoftwareVisualizer(SoftwareVisualizer&& /*other*/) = default;
+SoftwareVisualizer& SoftwareVisualizer::operator=(SoftwareVisualizer&& /*other*/) = default;
+SoftwareVisualizer::~SoftwareVisualizer() = default;
+
+
+Rectangle SoftwareVisualizer::getSceneRect() const
+{
+    return Rectangle(0, 0, static_cast<double>(_pimpl->_width), static_cast<double>(_pimpl->_height));
+}
+
+
+size_t SoftwareVisualizer::getWidth() const
+{
+    return _pimpl->_width;
+}
+
+
+size_t SoftwareVisualizer::getHeight() const
+{
+    return _pimpl->_height;
+}
+
+
+const uint32_t *SoftwareVisualizer::getPixels() const
+{
+    return _pimpl->_pixels.data();
+}
+
+
+uint32_t SoftwareVisualizer::getPixel(size_t x, size_t y) const
+{
+    if (x >= _pimpl->_width || y >= _pimpl->_height)
+        throw std::logic_error("SoftwareVisualizer::getPixel: the pixel is out of the framebuffer");
+
+    return _pimpl->_pixels[y * _pimpl->_width + x];
+}
+
+
+uint64_t SoftwareVisualizer::getFrameHash() const
+{
+    // FNV-1a of 32 bit words, pixels are numbers, so the byte order
+    // doesn't matter
+    uint64_t hash = 14695981039346656037ULL;
+
+    auto addWord = [&hash](uint32_t word)
+    {
+        hash ^= word;
+        hash *= 1099511628211ULL;
+    };
+
+    addWord(static_cast<uint32_t>(_pimpl->_width));
+    addWord(static_cast<uint32_t>(_pimpl->_height));
+
+    for (uint32_t pixel : _pimpl->_pixels)
+        addWord(pixel);
+
+    return hash;
+}
+
+
+size_t SoftwareVisualizer::getFrameCount() const
+{
+    return _pimpl->_frameCount;
+}
+
+
+void SoftwareVisualizer::clear()
+{
+    Impl::fillSpan(_pimpl->_pixels.data(), _pimpl->_pixels.size(), BACKGROUND_COLOR);
+}
+
+
+void SoftwareVisualizer::refresh()
+{
+    const size_t frameNum = _pimpl->_frameCount++;
+
+    if (_pimpl->_dumpPrefix.empty())
+        return;
+
+    std::ostringstream fileName;
+    fileName << _pimpl->_dumpPrefix << std::setw(6) << std::setfill('0') << frameNum
+             << (_pimpl->_dumpFormat == PpmFormat ? ".ppm" : ".png");
+    writeImage(fileName.str(), _pimpl->_dumpFormat);
+}
+
+
+void SoftwareVisualizer::drawRect(const Rectangle &rect, bool isMovable, bool isStatic, bool isStand)
+{
+    const int64_t left   = Impl::roundToPixel(rect.getLeft());
+    const int64_t top    = Impl::roundToPixel(rect.getTop());
+    const int64_t right  = Impl::roundToPixel(rect.getRight());
+    const int64_t bottom = Impl::roundToPixel(rect.getBottom());
+
+    if (right < left || bottom < top)
+        return;
+
+    // the pen goes inside of the corners, the brush fills the rest
+    const int64_t penWidth = isStand ? 2 : 1;
+    const int64_t innerLeft = left + penWidth, innerTop = top + penWidth;
+    const int64_t innerRight = right - penWidth, innerBottom = bottom - penWidth;
+
+    _pimpl->fillRect(left, top, right, std::min(innerTop - 1, bottom), PEN_COLOR);
+    _pimpl->fillRect(left, std::max(innerBottom + 1, innerTop), right, bottom, PEN_COLOR);
+    _pimpl->fillRect(left, innerTop, std::min(innerLeft - 1, right), innerBottom, PEN_COLOR);
+    _pimpl->fillRect(std::max(innerRight + 1, innerLeft), innerTop, right, innerBottom, PEN_COLOR);
+    _pimpl->fillRect(innerLeft, innerTop, innerRight, innerBottom, isMovable ? MOVABLE_COLOR : STATIC_COLOR);
+
+    if (isMovable && isStatic)
+    {
+        _pimpl->drawLine(left, top, right, bottom, PEN_COLOR);
+        _pimpl->drawLine(left, bottom, right, top, PEN_COLOR);
+    }
+}
+
+
+void SoftwareVisualizer::setSceneRect(const Rectangle &rect)
+{
+    _pimpl->resize(static_cast<size_t>(std::max<int64_t>(0, Impl::roundToPixel(rect.getWidth()))),
+                   static_cast<size_t>(std::max<int64_t>(0, Impl::roundToPixel(rect.getHeight()))));
+}
+
+
+void SoftwareVisualizer::setFrameDump(const std::string &filePrefix, ImageFormat format)
+{
+    _pimpl->_dumpPrefix = filePrefix;
+    _pimpl->_dumpFormat = format;
+}
+
+
+void SoftwareVisualizer::writeImage(std::ostream &stream, ImageFormat format) const
+{
+    if (format == PpmFormat)
+        _pimpl->writePpm(stream);
+    else
+        _pimpl->writePng(stream);
+
+    if (!stream)
+        throw std::runtime_error("SoftwareVisualizer::writeImage: can't write the image");
+}
+
+
+void SoftwareVisualizer::writeImage(const std::string &fileName, ImageFormat format) const
+{
+    std::ofstream stream(fileName, std::ios::binary);
+
+    if (!stream)
+        throw std::runtime_error("SoftwareVisualizer::writeImage: can't open " + fileName);
+
+    writeImage(stream, format);
+}
+
+
+void SoftwareVisualizer::Impl::resize(size_t width, size_t height)
+{
+    _width = width;
+    _height = height;
+    _pixels.assign(width * height, BACKGROUND_COLOR);
+}
+
+
+void SoftwareVisualizer::Impl::fillRect(int64_t left, int64_t top, int64_t right, int64_t bottom, uint32_t color)
+{
+    left   = std::max<int64_t>(left, 0);
+    top    = std::max<int64_t>(top, 0);
+    right  = std::min<int64_t>(right, static_cast<int64_t>(_width) - 1);
+    bottom = std::min<int64_t>(bottom, static_cast<int64_t>(_height) - 1);
+
+    if (right < left || bottom < top)
+        return;
+
+    for (int64_t y = top; y <= bottom; ++y)
+        fillSpan(_pixels.data() + y * _width + left, static_cast<size_t>(right - left + 1), color);
+}
+
+
+void SoftwareVisualizer::Impl::drawLine(int64_t firstX, int64_t firstY, int64_t secondX, int64_t secondY,
+                                        uint32_t color)
+{
+    const int64_t shiftX = secondX - firstX;
+    const int64_t shiftY = secondY - firstY;
+    const int64_t stepCount = std::max(std::abs(shiftX), std::abs(shiftY));
+    int64_t firstStep = 0, lastStep = stepCount;
+
+    // one pixel per step of the longer axis, steps out of the framebuffer
+    // are skipped
+    clipSteps(firstX, shiftX, stepCount, _width, firstStep, lastStep);
+    clipSteps(firstY, shiftY, stepCount, _height, firstStep, lastStep);
+
+    // shifts of clamped corners exceed the clamp, so they aren't clamped again
+    for (int64_t step = firstStep; step <= lastStep; ++step)
+    {
+        const double rate = stepCount == 0 ? 0 : static_cast<double>(step) / stepCount;
+        const int64_t x = firstX + static_cast<int64_t>(std::floor(rate * shiftX + 0.5));
+        const int64_t y = firstY + static_cast<int64_t>(std::floor(rate * shiftY + 0.5));
+
+        if (x >= 0 && y >= 0 && x < static_cast<int64_t>(_width) && y < static_cast<int64_t>(_height))
+            _pixels[y * _width + x] = color;
+    }
+}
+
+
+void SoftwareVisualizer::Impl::clipSteps(int64_t start, int64_t shift, int64_t stepCount, size_t size,
+                                         int64_t &firstStep, int64_t &lastStep) const
+{
+    const int64_t maxCoordinate = static_cast<int64_t>(size) - 1;
+
+    if (shift == 0)
+    {
+        if (start < 0 || start > maxCoordinate)
+            lastStep = firstStep - 1;
+
+        return;
+    }
+
+    // the range is widened by a step, rounding of pixels is checked by the caller
+    const double firstBound = static_cast<double>(-start) * stepCount / shift;
+    const double secondBound = static_cast<double>(maxCoordinate - start) * stepCount / shift;
+
+    firstStep = std::max(firstStep, static_cast<int64_t>(std::floor(std::min(firstBound, secondBound))) - 1);
+    lastStep = std::min(lastStep, static_cast<int64_t>(std::ceil(std::max(firstBound, secondBound))) + 1);
+}
+
+
+void SoftwareVisualizer::Impl::fillSpan(uint32_t *pixelPtr, size_t count, uint32_t color)
+{
+#ifdef SOFTWARE_VISUALIZER_HAS_SSE2
+    // 8 pixels by two unaligned stores, the tail is filled by pixels
+    const __m128i colors = _mm_set1_epi32(static_cast<int>(color));
+    size_t num = 0;
+
+    for (; num + 8 <= count; num += 8)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pixelPtr + num), colors);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pixelPtr + num + 4), colors);
+    }
+
+    for (; num < count; ++num)
+        pixelPtr[num] = color;
+#else
+    std::fill_n(pixelPtr, count, color);
+#endif
+}
+
+
+int64_t SoftwareVisualizer::Impl::roundToPixel(double coordinate)
+{
+    coordinate = std::max(-MAX_COORDINATE, std::min(coordinate, MAX_COORDINATE));
+    return static_cast<int64_t>(std::floor(coordinate + 0.5));
+}
+
+
+void SoftwareVisualizer::Impl::writePpm(std::ostream &stream) const
+{
+    stream << "P6\n" << _width << " " << _height << "\n255\n";
+    std::vector<char> row(_width * 3);
+
+    for (size_t y = 0; y < _height; ++y)
+    {
+        for (size_t x = 0; x < _width; ++x)
+        {
+            const uint32_t pixel = _pixels[y * _width + x];
+            row[x * 3]     = static_cast<char>(pixel & 0xFF);
+            row[x * 3 + 1] = static_cast<char>((pixel >> 8) & 0xFF);
+            row[x * 3 + 2] = static_cast<char>((pixel >> 16) & 0xFF);
+        }
+
+        stream.write(row.data(), static_cast<std::streamsize>(row.size()));
+    }
+}
+
+
+void SoftwareVisualizer::Impl::writePng(std::ostream &stream) const
+{
+    static const char SIGNATURE[8] = {'\x89', 'P', 'N', 'G', '\r', '\n', '\x1A', '\n'};
+    stream.write(SIGNATURE, sizeof(SIGNATURE));
+
+    // 8 bit RGBA without interlace
+    std::vector<uint8_t> header;
+
+    for (uint32_t number : {static_cast<uint32_t>(_width), static_cast<uint32_t>(_height)})
+        for (int shift = 24; shift >= 0; shift -= 8)
+            header.push_back(static_cast<uint8_t>(number >> shift));
+
+    header.insert(header.end(), {8, 6, 0, 0, 0});
+    writePngChunk(stream, "IHDR", header);
+
+    // rows start with the filter type, there is no filter
+    std::vector<uint8_t> rows;
+    rows.reserve(_height * (_width * 4 + 1));
+
+    for (size_t y = 0; y < _height; ++y)
+    {
+        rows.push_back(0);
+
+        for (size_t x = 0; x < _width; ++x)
+        {
+            const uint32_t pixel = _pixels[y * _width + x];
+
+            for (int shift = 0; shift < 32; shift += 8)
+                rows.push_back(static_cast<uint8_t>(pixel >> shift));
+        }
+    }
+
+    // zlib stream of stored deflate blocks & the Adler-32 of the rows
+    std::vector<uint8_t> data = {0x78, 0x01};
+    const size_t MAX_BLOCK_SIZE = 65535;
+    size_t blockBeginNum = 0;
+
+    do
+    {
+        const size_t blockSize = std::min(MAX_BLOCK_SIZE, rows.size() - blockBeginNum);
+        const bool isLast = blockBeginNum + blockSize == rows.size();
+
+        data.push_back(isLast ? 1 : 0);
+        data.push_back(static_cast<uint8_t>(blockSize));
+        data.push_back(static_cast<uint8_t>(blockSize >> 8));
+        data.push_back(static_cast<uint8_t>(~blockSize));
+        data.push_back(static_cast<uint8_t>(~blockSize >> 8));
+        data.insert(data.end(), rows.begin() + blockBeginNum, rows.begin() + blockBeginNum + blockSize);
+        blockBeginNum += blockSize;
+    }
+    while (blockBeginNum < rows.size());
+
+    uint32_t adlerLow = 1, adlerHigh = 0;
+
+    for (uint8_t byte : rows)
+    {
+        adlerLow = (adlerLow + byte) % 65521;
+        adlerHigh = (adlerHigh + adlerLow) % 65521;
+    }
+
+    for (int shift = 24; shift >= 0; shift -= 8)
+        data.push_back(static_cast<uint8_t>((adlerHigh << 16 | adlerLow) >> shift));
+
+    writePngChunk(stream, "IDAT", data);
+    writePngChunk(stream, "IEND", std::vector<uint8_t>());
+}
+
+
+void SoftwareVisualizer::Impl::writePngChunk(std::ostream &stream, const char *type, const std::vector<uint8_t> &data)
+{
+    writeBigEndian(stream, static_cast<uint32_t>(data.size()));
+    stream.write(type, 4);
+    stream.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    writeBigEndian(stream, getCrc(type, data));
+}
+
+
+void SoftwareVisualizer::Impl::writeBigEndian(std::ostream &stream, uint32_t number)
+{
+    for (int shift = 24; shift >= 0; shift -= 8)
+        stream.put(static_cast<char>((number >> shift) & 0xFF));
+}
+
+
+uint32_t SoftwareVisualizer::Impl::getCrc(const char *type, const std::vector<uint8_t> &data)
+{
+    // CRC-32 of the chunk type & data by the table of byte remainders
+    static const std::vector<uint32_t> TABLE = []()
+    {
+        std::vector<uint32_t> table(256);
+
+        for (uint32_t byte = 0; byte < 256; ++byte)
+        {
+            uint32_t remainder = byte;
+
+            for (int bitNum = 0; bitNum < 8; ++bitNum)
+                remainder = (remainder & 1) != 0 ? 0xEDB88320 ^ (remainder >> 1) : remainder >> 1;
+
+            table[byte] = remainder;
+        }
+
+        return table;
+    }();
+
+    uint32_t crc = 0xFFFFFFFF;
+
+    for (int charNum = 0; charNum < 4; ++charNum)
+        crc = TABLE[(crc ^ static_cast<uint8_t>(type[charNum])) & 0xFF] ^ (crc >> 8);
+
+    for (uint8_t byte : data)
+        crc = TABLE[(crc ^ byte) & 0xFF] ^ (crc >> 8);
+
+    return crc ^ 0xFFFFFFFF;
+}
+
+
+}  // namespace Platformer
@@ -0,0 +1,75 @@
+// SoftwareVisualizer.h
+
+#ifndef SOFTWAREVISUALIZER_H
+#define SOFTWAREVISUALIZER_H
+
+#include <memory>
+#include <string>
+#include <ostream>
+#include <cstdint>
+
+#include "visualizer/Visualizer.h"
+
+
+namespace Platformer
+{
+
+
+// Visualizer drawing into a framebuffer in memory, so the whole draw path
+// runs without a window and frames can be compared pixel by pixel. Colors
+// & pens follow QtVisualizer, rectangle corners are rounded to pixels and
+// texts aren't drawn. Frames are dumped by refresh(), when the dump is set.
+class SoftwareVisualizer : public Visualizer
+{
+public:
+    enum ImageFormat
+    {
+        PpmFormat,
+        PngFormat
+    };
+
+    SoftwareVisualizer(size_t width = 640, size_t height = 480);
+    SoftwareVisualizer(SoftwareVisualizer&& other);
+    virtual SoftwareVisualizer& operator=(SoftwareVisualizer&& other);
+    virtual ~SoftwareVisualizer();
+
+    virtual Rectangle getSceneRect() const override;
+    size_t getWidth() const;
+    size_t getHeight() const;
+
+    // Rows of pixels from the top, a pixel is 0xAABBGGRR, so the bytes go
+    // in RGBA order on little endian machines.
+    const uint32_t *getPixels() const;
+    uint32_t getPixel(size_t x, size_t y) const;
+
+    // hash of the framebuffer size & pixels, it's the same on all machines
+    uint64_t getFrameHash() const;
+
+    // number of refresh() calls, it numbers dumped frames
+    size_t getFrameCount() const;
+
+    virtual void clear() override;
+    virtual void refresh() override;
+    virtual void drawRect(const Rectangle &rect, bool isMovable, bool isStatic, bool isStand) override;
+
+    // the framebuffer is resized to the rounded size & cleared
+    virtual void setSceneRect(const Rectangle &rect) override;
+
+    // every refresh() writes the frame to the prefix, the frame number &
+    // the extension, an empty prefix disables the dump
+    void setFrameDump(const std::string &filePrefix, ImageFormat format = PngFormat);
+
+    // Binary PPM or RGBA PNG without compression, so there are no
+    // dependencies, images are only a bit larger than raw pixels.
+    void writeImage(std::ostream &stream, ImageFormat format) const;
+    void writeImage(const std::string &fileName, ImageFormat format) const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> _pimpl;
+};
+
+
+}  // namespace Platformer
+
+#endif  // SOFTWAREVISUALIZER_H
@@ -3,6 +3,7 @@
 #include <iostream>
 
 #include <QPainter>
+#include <QPaintEvent>
 #include <QDebug>
 
 #include "QtCanvasWidget.h"
@@ -76,9 +77,14 @@ void Platformer::QtCanvasWidget::paintEvent(QPaintEvent *eventPtr)
 {
     QWidget::paintEvent(eventPtr);
 
+    // only the updated part of the pixmap is copied, the pixmap is of the
+    // widget size
     QPainter painter;
     painter.begin(this);
-    painter.drawPixmap(rect(), *_pimpl->_pixmapPtr);
+
+    for (const QRect &rect : eventPtr->region())
+        painter.drawPixmap(rect, *_pimpl->_pixmapPtr, rect);
+
     painter.end();
 }
 
@@ -41,9 +41,7 @@ QtPlatformManager::QtPlatformManager(int &argc, char *argv[])
     QObject::connect(_pimpl->_frameTimerPtr/*.get()*/, &QTimer::timeout, [this]()
     {
         updateActualFrameTime();
-
-        if (frameHandler != nullptr)
-            frameHandler();
+        handleFrame();
     });
 }
 
@@ -1,9 +1,17 @@
 // QtVisualizer.cpp
 
 #include <iostream>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
 
 #include <QWidget>
 #include <QPainter>
+#include <QPixmap>
+#include <QRegion>
+#include <QFontMetricsF>
 #include <QGraphicsScene>
 #include <QKeyEvent>
 
@@ -11,6 +19,8 @@
 #include "platform/Key.h"
 #include "platform/Platform.h"
 #include "platform/PlatformManager.h"
+#include "visualizer/DrawCommandBuffer.h"
+#include "visualizer/StaticLayer.h"
 #include "QtCanvasWidget.h"
 #include "QtVisualizer.h"
 
@@ -21,10 +31,34 @@ namespace Platformer
 
 struct QtVisualizer::Impl
 {
+    // drawn chunk of the static layer, it's redrawn by a new revision
+    struct CachedChunk
+    {
+        QPixmap _pixmap;
+        uint64_t _revision = 0;
+        uint64_t _frameNum = 0;
+    };
+
+    // visible chunk of the last frame
+    struct ChunkRecord
+    {
+        StaticLayer::ChunkKey _key;
+        uint64_t _revision;
+        QRect _rect;
+    };
+
     Impl()
     {
     }
 
+    bool findDirtyRects(const DrawCommandBuffer &buffer, const QRect &canvasRect, qreal textHeight);
+    void addDirtyRect(const QRect &rect, const QRect &canvasRect);
+    bool mergeDirtyRects(const QRect &canvasRect);
+    void invalidateFrame();
+    void drawRects(QPainter &painter, size_t style, const std::vector<DrawCommandBuffer::RectCommand> &rects);
+    void drawStaticLayer(QPainter &painter, const StaticLayer &layer, const Rectangle &viewport);
+    void drawChunk(const StaticLayer::Chunk &chunk, CachedChunk &cachedChunk);
+
     static Rectangle qrectfToRectangle(QRectF rect);
     static QRectF rectangleToQRectf(Rectangle rect);
     static char fromQtKeyToChar(int qtKeyId);
@@ -32,9 +66,52 @@ struct QtVisualizer::Impl
 
     QtCanvasWidget *_canvasPtr;
     QPainter *_painterPtr;
+
+    // batches of drawCommands() kept between frames
+    std::vector<QRectF> _rects;
+    std::vector<QLineF> _lines;
+
+    // chunks of the static layer, chunks out of the view are dropped when
+    // there are too many of them
+    const StaticLayer *_staticLayerPtr = nullptr;
+    std::unordered_map<StaticLayer::ChunkKey, CachedChunk> _cachedChunks;
+    std::vector<const StaticLayer::Chunk*> _chunkPtrs;
+    uint64_t _frameNum = 0;
+
+    // Commands of the last frame. Rectangles added or removed since then,
+    // changed chunks & texts are the dirty parts of the canvas, the rest of
+    // it is kept. The whole canvas is dirty after resizes, camera moves &
+    // single draw calls.
+    bool _isLastFrameValid = false;
+    int _lastCanvasWidth = 0;
+    int _lastCanvasHeight = 0;
+    bool _wasStaticLayerDrawn = false;
+    Rectangle _lastViewport;
+    std::vector<DrawCommandBuffer::RectCommand> _lastRects[DrawCommandBuffer::StyleCount];
+    std::vector<DrawCommandBuffer::RectCommand> _frameRects;
+    std::vector<ChunkRecord> _lastChunks;
+    std::vector<ChunkRecord> _frameChunks;
+    std::vector<DrawCommandBuffer::TextCommand> _lastTexts;
+    std::vector<char> _lastTextChars;
+    std::vector<QRect> _dirtyRects;
+
+    // canvas parts painted since the last refresh()
+    QRegion _updateRegion;
+    bool _isFullUpdate = true;
+
+    // constants
+    static const size_t MAX_CACHED_CHUNK_COUNT = 64;
+    static const size_t MAX_DIRTY_RECT_COUNT = 8;
+    static const size_t MAX_RAW_DIRTY_RECT_COUNT = 256;
+    static const int DIRTY_RECT_MARGIN = 2;
+    static const double MAX_DIRTY_AREA_RATE;
 };
 
 
+// a larger dirty area is painted at once
+const double QtVisualizer::Impl::MAX_DIRTY_AREA_RATE = 0.5;
+
+
 
 QtVisualizer::QtVisualizer()
     : _pimpl(new Impl())
@@ -83,6 +160,7 @@ Rectangle QtVisualizer::getSceneRect() const
 
 void QtVisualizer::clear()
 {
+    _pimpl->invalidateFrame();
     _pimpl->_painterPtr->begin(_pimpl->_canvasPtr->getPixmap().get());
     _pimpl->_painterPtr->fillRect(_pimpl->_canvasPtr->rect(), QBrush(Qt::lightGray));
     _pimpl->_painterPtr->end();
@@ -91,6 +169,7 @@ void QtVisualizer::clear()
 
 void QtVisualizer::drawRect(const Rectangle &rect, bool isMovable, bool isStatic, bool isStand)
 {
+    _pimpl->invalidateFrame();
     QPen pen(Qt::black);
     pen.setWidth(isStand ? 2 : 1);
 
@@ -110,6 +189,80 @@ void QtVisualizer::drawRect(const Rectangle &rect, bool isMovable, bool isStatic
 }
 
 
+void QtVisualizer::drawText(const Point &position, const std::string &text)
+{
+    _pimpl->invalidateFrame();
+    _pimpl->_painterPtr->begin(_pimpl->_canvasPtr->getPixmap().get());
+    _pimpl->_painterPtr->setPen(QPen(Qt::black));
+
+    // the text is drawn below the position, like rectangles
+    const QFontMetricsF metrics(_pimpl->_painterPtr->font());
+    _pimpl->_painterPtr->drawText(QPointF(position.getX(), position.getY() + metrics.ascent()),
+                                  QString::fromStdString(text));
+    _pimpl->_painterPtr->end();
+}
+
+
+void QtVisualizer::drawCommands(const DrawCommandBuffer &buffer)
+{
+    QPainter &painter = *_pimpl->_painterPtr;
+    const QRect canvasRect = _pimpl->_canvasPtr->rect();
+    painter.begin(_pimpl->_canvasPtr->getPixmap().get());
+    const QFontMetricsF metrics(painter.font());
+
+    if (buffer.getStaticLayerPtr() != nullptr)
+        buffer.getStaticLayerPtr()->findChunks(buffer.getStaticViewport(), _pimpl->_chunkPtrs);
+    else
+        _pimpl->_chunkPtrs.clear();
+
+    // only the dirty part is cleared & drawn again, the rest is clipped
+    if (!_pimpl->findDirtyRects(buffer, canvasRect, metrics.height()))
+    {
+        painter.fillRect(canvasRect, QBrush(Qt::lightGray));
+        _pimpl->_isFullUpdate = true;
+    }
+    else if (_pimpl->_dirtyRects.empty())
+    {
+        painter.end();
+        return;
+    }
+    else
+    {
+        QRegion region;
+
+        for (const QRect &rect : _pimpl->_dirtyRects)
+            region += rect;
+
+        painter.setClipRegion(region);
+
+        for (const QRect &rect : _pimpl->_dirtyRects)
+            painter.fillRect(rect, QBrush(Qt::lightGray));
+
+        _pimpl->_updateRegion += region;
+    }
+
+    if (buffer.getStaticLayerPtr() != nullptr)
+        _pimpl->drawStaticLayer(painter, *buffer.getStaticLayerPtr(), buffer.getStaticViewport());
+
+    for (size_t style = 0; style < DrawCommandBuffer::StyleCount; ++style)
+        _pimpl->drawRects(painter, style, buffer.getRects(style));
+
+    if (buffer.getTextCount() != 0)
+    {
+        painter.setPen(QPen(Qt::black));
+
+        for (size_t textNum = 0; textNum < buffer.getTextCount(); ++textNum)
+        {
+            const DrawCommandBuffer::TextCommand &text = buffer.getText(textNum);
+            painter.drawText(QPointF(text._position.getX(), text._position.getY() + metrics.ascent()),
+                             QString::fromUtf8(buffer.getTextChars(text), static_cast<int>(text._textLength)));
+        }
+    }
+
+    painter.end();
+}
+
+
 void QtVisualizer::setSceneRect(const Rectangle &rect)
 {
     _pimpl->_canvasPtr->resize(static_cast<int>(rect.getWidth()),
@@ -119,7 +272,322 @@ void QtVisualizer::setSceneRect(const Rectangle &rect)
 
 void Platformer::QtVisualizer::refresh()
 {
-    _pimpl->_canvasPtr->update();
+    if (_pimpl->_isFullUpdate)
+        _pimpl->_canvasPtr->update();
+    else if (!_pimpl->_updateRegion.isEmpty())
+        _pimpl->_canvasPtr->update(_pimpl->_updateRegion);
+
+    _pimpl->_updateRegion = QRegion();
+    _pimpl->_isFullUpdate = false;
+}
+
+
+bool QtVisualizer::Impl::findDirtyRects(const DrawCommandBuffer &buffer, const QRect &canvasRect, qreal textHeight)
+{
+    const StaticLayer *layerPtr = buffer.getStaticLayerPtr();
+    const Rectangle &viewport = buffer.getStaticViewport();
+    _dirtyRects.clear();
+
+    bool isFullRepaint = !_isLastFrameValid
+            || canvasRect.width() != _lastCanvasWidth || canvasRect.height() != _lastCanvasHeight
+            || (layerPtr != nullptr) != _wasStaticLayerDrawn
+            || (layerPtr != nullptr && (   viewport.getX() != _lastViewport.getX()
+                                        || viewport.getY() != _lastViewport.getY()));
+
+    auto isLess = [](const DrawCommandBuffer::RectCommand &first, const DrawCommandBuffer::RectCommand &second)
+    {
+        if (first._x != second._x)         return first._x < second._x;
+        if (first._y != second._y)         return first._y < second._y;
+        if (first._width != second._width) return first._width < second._width;
+        return first._height < second._height;
+    };
+
+    auto toQRect = [](const DrawCommandBuffer::RectCommand &rect)
+    {
+        return QRectF(rect._x, rect._y, rect._width, rect._height).toAlignedRect()
+                .adjusted(-DIRTY_RECT_MARGIN, -DIRTY_RECT_MARGIN, DIRTY_RECT_MARGIN, DIRTY_RECT_MARGIN);
+    };
+
+    // chunks with new revisions & chunks entering or leaving the view
+    _frameChunks.clear();
+
+    for (const StaticLayer::Chunk *chunkPtr : _chunkPtrs)
+    {
+        const Rectangle &rect = chunkPtr->_rect;
+        ChunkRecord record = {chunkPtr->_key, chunkPtr->_revision,
+                              QRectF(rect.getX() - viewport.getX(), rect.getY() - viewport.getY(),
+                                     rect.getWidth(), rect.getHeight()).toAlignedRect()};
+        _frameChunks.push_back(record);
+    }
+
+    auto isLessChunk = [](const ChunkRecord &first, const ChunkRecord &second) { return first._key < second._key; };
+    std::sort(_frameChunks.begin(), _frameChunks.end(), isLessChunk);
+
+    for (size_t frameNum = 0, lastNum = 0; !isFullRepaint && (frameNum < _frameChunks.size()
+                                                              || lastNum < _lastChunks.size()); )
+    {
+        if (lastNum == _lastChunks.size()
+                || (frameNum < _frameChunks.size() && isLessChunk(_frameChunks[frameNum], _lastChunks[lastNum])))
+            addDirtyRect(_frameChunks[frameNum++]._rect, canvasRect);
+        else if (frameNum == _frameChunks.size() || isLessChunk(_lastChunks[lastNum], _frameChunks[frameNum]))
+            addDirtyRect(_lastChunks[lastNum++]._rect, canvasRect);
+        else
+        {
+            if (_frameChunks[frameNum]._revision != _lastChunks[lastNum]._revision)
+                addDirtyRect(_frameChunks[frameNum]._rect, canvasRect);
+
+            ++frameNum;
+            ++lastNum;
+        }
+    }
+
+    _lastChunks.swap(_frameChunks);
+
+    // rectangles of one frame only are the old & new places of moved bodies
+    for (size_t style = 0; style < DrawCommandBuffer::StyleCount; ++style)
+    {
+        const std::vector<DrawCommandBuffer::RectCommand> &rects = buffer.getRects(style);
+        std::vector<DrawCommandBuffer::RectCommand> &lastRects = _lastRects[style];
+        _frameRects.assign(rects.begin(), rects.end());
+        std::sort(_frameRects.begin(), _frameRects.end(), isLess);
+
+        for (size_t frameNum = 0, lastNum = 0; !isFullRepaint && (frameNum < _frameRects.size()
+                                                                  || lastNum < lastRects.size()); )
+        {
+            if (lastNum == lastRects.size()
+                    || (frameNum < _frameRects.size() && isLess(_frameRects[frameNum], lastRects[lastNum])))
+                addDirtyRect(toQRect(_frameRects[frameNum++]), canvasRect);
+            else if (frameNum == _frameRects.size() || isLess(lastRects[lastNum], _frameRects[frameNum]))
+                addDirtyRect(toQRect(lastRects[lastNum++]), canvasRect);
+            else
+            {
+                ++frameNum;
+                ++lastNum;
+            }
+
+            isFullRepaint = _dirtyRects.size() > MAX_RAW_DIRTY_RECT_COUNT;
+        }
+
+        lastRects.swap(_frameRects);
+    }
+
+    // changed texts are dirty to the right edge of the canvas
+    const bool isTextChanged = buffer.getTextCount() != _lastTexts.size();
+
+    for (size_t textNum = 0; !isFullRepaint && textNum < std::max(buffer.getTextCount(), _lastTexts.size()); ++textNum)
+    {
+        const DrawCommandBuffer::TextCommand *textPtr = textNum < buffer.getTextCount() ? &buffer.getText(textNum)
+                                                                                       : nullptr;
+        const DrawCommandBuffer::TextCommand *lastTextPtr = textNum < _lastTexts.size() ? &_lastTexts[textNum]
+                                                                                        : nullptr;
+
+        if (   !isTextChanged && textPtr->_position.getX() == lastTextPtr->_position.getX()
+            && textPtr->_position.getY() == lastTextPtr->_position.getY()
+            && textPtr->_textLength == lastTextPtr->_textLength
+            && std::memcmp(buffer.getTextChars(*textPtr), _lastTextChars.data() + lastTextPtr->_textBeginNum,
+                           textPtr->_textLength) == 0)
+            continue;
+
+        for (const DrawCommandBuffer::TextCommand *changedTextPtr : {textPtr, lastTextPtr})
+        {
+            if (changedTextPtr != nullptr)
+                addDirtyRect(QRectF(changedTextPtr->_position.getX(), changedTextPtr->_position.getY(),
+                                    canvasRect.width(), textHeight).toAlignedRect(), canvasRect);
+        }
+    }
+
+    _lastTexts.clear();
+    _lastTextChars.clear();
+
+    for (size_t textNum = 0; textNum < buffer.getTextCount(); ++textNum)
+    {
+        DrawCommandBuffer::TextCommand text = buffer.getText(textNum);
+        const char *textChars = buffer.getTextChars(text);
+        text._textBeginNum = _lastTextChars.size();
+        _lastTextChars.insert(_lastTextChars.end(), textChars, textChars + text._textLength);
+        _lastTexts.push_back(text);
+    }
+
+    _isLastFrameValid = true;
+    _lastCanvasWidth = canvasRect.width();
+    _lastCanvasHeight = canvasRect.height();
+    _wasStaticLayerDrawn = layerPtr != nullptr;
+    _lastViewport = viewport;
+
+    return !isFullRepaint && mergeDirtyRects(canvasRect);
+}
+
+
+void QtVisualizer::Impl::addDirtyRect(const QRect &rect, const QRect &canvasRect)
+{
+    const QRect visibleRect = rect.intersected(canvasRect);
+
+    if (!visibleRect.isEmpty())
+        _dirtyRects.push_back(visibleRect);
+}
+
+
+bool QtVisualizer::Impl::mergeDirtyRects(const QRect &canvasRect)
+{
+    auto getArea = [](const QRect &rect)
+    {
+        return static_cast<long long>(rect.width()) * rect.height();
+    };
+
+    // overlapping rectangles are merged, then the pairs adding the least
+    // area, till a few rectangles are left
+    for (bool isMerged = true; isMerged; )
+    {
+        isMerged = false;
+
+        for (size_t firstNum = 0; firstNum < _dirtyRects.size(); ++firstNum)
+            for (size_t secondNum = firstNum + 1; secondNum < _dirtyRects.size(); )
+            {
+                if (!_dirtyRects[firstNum].intersects(_dirtyRects[secondNum]))
+                {
+                    ++secondNum;
+                    continue;
+                }
+
+                _dirtyRects[firstNum] = _dirtyRects[firstNum].united(_dirtyRects[secondNum]);
+                _dirtyRects.erase(_dirtyRects.begin() + secondNum);
+                isMerged = true;
+            }
+    }
+
+    while (_dirtyRects.size() > MAX_DIRTY_RECT_COUNT)
+    {
+        size_t bestFirstNum = 0, bestSecondNum = 1;
+        long long bestAddedArea = -1;
+
+        for (size_t firstNum = 0; firstNum < _dirtyRects.size(); ++firstNum)
+            for (size_t secondNum = firstNum + 1; secondNum < _dirtyRects.size(); ++secondNum)
+            {
+                const long long addedArea = getArea(_dirtyRects[firstNum].united(_dirtyRects[secondNum]))
+                                          - getArea(_dirtyRects[firstNum]) - getArea(_dirtyRects[secondNum]);
+
+                if (bestAddedArea < 0 || addedArea < bestAddedArea)
+                {
+                    bestAddedArea = addedArea;
+                    bestFirstNum = firstNum;
+                    bestSecondNum = secondNum;
+                }
+            }
+
+        _dirtyRects[bestFirstNum] = _dirtyRects[bestFirstNum].united(_dirtyRects[bestSecondNum]);
+        _dirtyRects.erase(_dirtyRects.begin() + bestSecondNum);
+    }
+
+    long long dirtyArea = 0;
+
+    for (const QRect &rect : _dirtyRects)
+        dirtyArea += getArea(rect);
+
+    return dirtyArea <= getArea(canvasRect) * MAX_DIRTY_AREA_RATE;
+}
+
+
+void QtVisualizer::Impl::invalidateFrame()
+{
+    _isLastFrameValid = false;
+    _isFullUpdate = true;
+}
+
+
+void QtVisualizer::Impl::drawRects(QPainter &painter, size_t style,
+                                   const std::vector<DrawCommandBuffer::RectCommand> &rects)
+{
+    if (rects.empty())
+        return;
+
+    // one pen & brush for all rectangles of the style, sleeping movable
+    // ones are crossed out over them
+    const bool isMovable = (style & DrawCommandBuffer::MovableStyle) != 0;
+    const bool isStatic = (style & DrawCommandBuffer::StaticStyle) != 0;
+    QPen pen(Qt::black);
+    pen.setWidth((style & DrawCommandBuffer::StandStyle) != 0 ? 2 : 1);
+
+    _rects.clear();
+    _lines.clear();
+
+    for (const DrawCommandBuffer::RectCommand &rect : rects)
+    {
+        _rects.push_back(QRectF(rect._x, rect._y, rect._width, rect._height));
+
+        if (isMovable && isStatic)
+        {
+            const qreal right = rect._x + rect._width;
+            const qreal bottom = rect._y + rect._height;
+            _lines.push_back(QLineF(rect._x, rect._y, right, bottom));
+            _lines.push_back(QLineF(rect._x, bottom, right, rect._y));
+        }
+    }
+
+    painter.setPen(pen);
+    painter.setBrush(QBrush(isMovable ? Qt::white : Qt::gray));
+    painter.drawRects(_rects.data(), static_cast<int>(_rects.size()));
+
+    if (!_lines.empty())
+    {
+        painter.setPen(QPen(Qt::black));
+        painter.drawLines(_lines.data(), static_cast<int>(_lines.size()));
+    }
+}
+
+
+void QtVisualizer::Impl::drawStaticLayer(QPainter &painter, const StaticLayer &layer, const Rectangle &viewport)
+{
+    // revisions are unique only in one layer
+    if (&layer != _staticLayerPtr)
+    {
+        _cachedChunks.clear();
+        _staticLayerPtr = &layer;
+    }
+
+    // chunks in the view are found by drawCommands()
+    ++_frameNum;
+
+    for (const StaticLayer::Chunk *chunkPtr : _chunkPtrs)
+    {
+        CachedChunk &cachedChunk = _cachedChunks[chunkPtr->_key];
+
+        if (cachedChunk._revision != chunkPtr->_revision || cachedChunk._pixmap.isNull())
+            drawChunk(*chunkPtr, cachedChunk);
+
+        cachedChunk._frameNum = _frameNum;
+        painter.drawPixmap(QPointF(chunkPtr->_rect.getX() - viewport.getX(), chunkPtr->_rect.getY() - viewport.getY()),
+                           cachedChunk._pixmap);
+    }
+
+    if (_cachedChunks.size() <= MAX_CACHED_CHUNK_COUNT)
+        return;
+
+    for (auto chunkIt = _cachedChunks.begin(); chunkIt != _cachedChunks.end(); )
+    {
+        if (chunkIt->second._frameNum != _frameNum)
+            chunkIt = _cachedChunks.erase(chunkIt);
+        else
+            ++chunkIt;
+    }
+}
+
+
+void QtVisualizer::Impl::drawChunk(const StaticLayer::Chunk &chunk, CachedChunk &cachedChunk)
+{
+    // chunks are opaque, so they are copied over the background
+    const int size = static_cast<int>(std::ceil(chunk._rect.getWidth()));
+
+    if (cachedChunk._pixmap.width() != size)
+        cachedChunk._pixmap = QPixmap(size, size);
+
+    cachedChunk._pixmap.fill(QColor(Qt::lightGray));
+    cachedChunk._revision = chunk._revision;
+
+    QPainter chunkPainter(&cachedChunk._pixmap);
+    chunkPainter.translate(-chunk._rect.getX(), -chunk._rect.getY());
+
+    for (size_t style = 0; style < DrawCommandBuffer::StyleCount; ++style)
+        drawRects(chunkPainter, style, chunk._rects[style]);
 }
 
 
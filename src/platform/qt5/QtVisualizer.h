@@ -27,6 +27,8 @@ public:
     virtual void clear() override;
     virtual void refresh() override;
     virtual void drawRect(const Rectangle &rect, bool isLight, bool isStatic, bool isStand) override;
+    virtual void drawText(const Point &position, const std::string &text) override;
+    virtual void drawCommands(const DrawCommandBuffer &buffer) override;
     virtual void setSceneRect(const Rectangle &rect) override;
 
 private:
@@ -1,8 +1,20 @@
 // GamePainter.cpp
 
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <sstream>
+#include <iomanip>
+
 #include "platform/Platform.h"
 #include "visualizer/Visualizer.h"
+#include "visualizer/DrawCommandBuffer.h"
+#include "visualizer/Camera.h"
+#include "visualizer/StaticLayer.h"
+#include "geometry/BoundingBox.h"
 #include "physics/TestObject.h"
+#include "physics/PhysicalEngine.h"
+#include "physics/PhysicsProfiler.h"
 #include "GamePainter.h"
 
 
@@ -12,9 +24,54 @@ namespace Platformer
 
 struct GamePainter::Impl
 {
+    struct StaticRect
+    {
+        Rectangle _rect;
+        size_t _style;
+    };
+
+    // rectangles of a static object put into the layer
+    struct StaticObject
+    {
+        uint64_t _stamp = 0;
+        std::vector<StaticRect> _rects;
+    };
+
     Impl()
     {
     }
+
+    void drawProfilerOverlay();
+    void updateCamera();
+    void updateStaticLayer();
+    void resetStaticLayer();
+    void collectStaticRects(PhysicalObject &node, std::vector<StaticRect> &rects) const;
+    static bool isSameRects(const std::vector<StaticRect> &firstRects, const std::vector<StaticRect> &secondRects);
+
+    PhysicalEnginePointer _enginePtr;
+    CameraPointer _cameraPtr;
+    bool _isProfilerOverlayVisible = false;
+
+    // commands of the frame are drawn at once after the visit
+    DrawCommandBuffer _commands;
+
+    // viewport of the frame & objects found in it
+    Rectangle _viewport;
+    std::vector<SimplePhysicalObjectPointer> _objectPtrs;
+
+    // Static objects by their pointers, they are compared with the engine
+    // ones only when its static revision changes. Pointers of removed
+    // objects are kept as keys only till the next update.
+    bool _isStaticLayerEnabled = true;
+    StaticLayer _staticLayer;
+    std::unordered_map<ConstSimplePhysicalObjectPointer, StaticObject> _staticObjects;
+    std::vector<SimplePhysicalObjectPointer> _staticObjectPtrs;
+    std::vector<StaticRect> _staticRects;
+    uint64_t _staticRevision = 0;
+    uint64_t _staticStamp = 0;
+
+    const Point OVERLAY_POSITION = Point(10, 10);
+    const double OVERLAY_LINE_HEIGHT = 16;
 };
 
 
@@ -30,21 +87,272 @@ GamePainter& GamePainter::operator=(GamePainter&& /*other*/) = default;
 GamePainter::~GamePainter() = default;
 
 
+PhysicalEnginePointer GamePainter::getEnginePtr() const
+{
+    return _pimpl->_enginePtr;
+}
+
+
+CameraPointer GamePainter::getCameraPtr() const
+{
+    return _pimpl->_cameraPtr;
+}
+
+
+bool GamePainter::isProfilerOverlayVisible() const
+{
+    return _pimpl->_isProfilerOverlayVisible;
+}
+
+
+bool GamePainter::isStaticLayerEnabled() const
+{
+    return _pimpl->_isStaticLayerEnabled;
+}
+
+
+void GamePainter::setEnginePtr(PhysicalEnginePointer enginePtr)
+{
+    _pimpl->_enginePtr = enginePtr;
+    _pimpl->resetStaticLayer();
+}
+
+
+void GamePainter::setCameraPtr(CameraPointer cameraPtr)
+{
+    _pimpl->_cameraPtr = cameraPtr;
+}
+
+
+void GamePainter::setProfilerOverlayVisible(bool isVisible)
+{
+    _pimpl->_isProfilerOverlayVisible = isVisible;
+}
+
+
+void GamePainter::setStaticLayerEnabled(bool isEnabled)
+{
+    _pimpl->_isStaticLayerEnabled = isEnabled;
+    _pimpl->resetStaticLayer();
+}
+
+
+void GamePainter::paint(IteratorType iterPtr)
+{
+    if (_pimpl->_enginePtr == nullptr || _pimpl->_cameraPtr == nullptr)
+    {
+        visit(iterPtr);
+        return;
+    }
+
+    doPreprocessAll();
+    const bool isStaticSkipped = _pimpl->_isStaticLayerEnabled;
+
+    if (isStaticSkipped)
+    {
+        _pimpl->updateStaticLayer();
+        _pimpl->_commands.setStaticLayer(&_pimpl->_staticLayer, _pimpl->_viewport);
+    }
+
+    _pimpl->_enginePtr->findRenderedObjects(_pimpl->_viewport, _pimpl->_objectPtrs, isStaticSkipped);
+
+    for (SimplePhysicalObjectPointer objectPtr : _pimpl->_objectPtrs)
+        visit(*objectPtr);
+
+    doPostprocessAll();
+}
+
+
 void GamePainter::visit(PhysicalObject &node)
 {
-    forEach(node.getGeometry(), [&node](const Rectangle &rect)
+    PhysicalEngine *enginePtr = _pimpl->_enginePtr.get();
+    const Camera *cameraPtr = _pimpl->_cameraPtr.get();
+    const Rectangle &viewport = _pimpl->_viewport;
+    DrawCommandBuffer &commands = _pimpl->_commands;
+
+    forEach(node.getGeometry(), [&node, enginePtr, cameraPtr, &viewport, &commands](const Rectangle &rect)
     {
-        Platform::visualizer()->drawRect(node.mapToGlobal(rect),
-                                         node.isMovable(),
-                                         false/*node.isStatic()*/,
-                                         false/*node.isStand()*/);
+        Rectangle renderRect = enginePtr != nullptr ? enginePtr->mapToRender(&node, rect) : node.mapToGlobal(rect);
+
+        if (cameraPtr != nullptr)
+        {
+            if (!renderRect.isCollided(viewport))
+                return;
+
+            renderRect = cameraPtr->mapToScreen(renderRect);
+        }
+
+        commands.addRect(renderRect, node.isMovable(), node.isSleeping(), false/*node.isStand()*/);
     });
 }
 
 
 void GamePainter::doPreprocessAll()
 {
-    Platform::visualizer()->clear();
+    _pimpl->_commands.clear();
+
+    if (_pimpl->_cameraPtr != nullptr)
+        _pimpl->updateCamera();
+}
+
+
+void GamePainter::doPostprocessAll()
+{
+    if (_pimpl->_isProfilerOverlayVisible)
+        _pimpl->drawProfilerOverlay();
+
+    Platform::visualizer()->drawCommands(_pimpl->_commands);
+}
+
+
+void GamePainter::Impl::updateCamera()
+{
+    // the viewport follows the window size
+    const Rectangle sceneRect = Platform::visualizer()->getSceneRect();
+
+    if (sceneRect.getWidth() > 0 && sceneRect.getHeight() > 0)
+        _cameraPtr->setViewportSize(sceneRect.getSize());
+
+    PhysicalObjectPointer targetPtr = _cameraPtr->getTargetPtr();
+
+    if (targetPtr != nullptr)
+    {
+        BoundingBox targetBox;
+
+        forEach(targetPtr->getGeometry(), [this, &targetPtr, &targetBox](const Rectangle &rect)
+        {
+            targetBox.unite(BoundingBox(_enginePtr != nullptr ? _enginePtr->mapToRender(targetPtr.get(), rect)
+                                                              : targetPtr->mapToGlobal(rect)));
+        });
+
+        if (!targetBox.isEmpty())
+            _cameraPtr->follow(targetBox.toRectangle());
+    }
+
+    _viewport = _cameraPtr->getViewport();
+}
+
+
+void GamePainter::Impl::updateStaticLayer()
+{
+    const uint64_t revision = _enginePtr->getStaticRevision();
+
+    if (revision == _staticRevision)
+        return;
+
+    _staticRevision = revision;
+    ++_staticStamp;
+    _enginePtr->findStaticObjects(_staticObjectPtrs);
+
+    // only chunks of added, removed & changed objects are touched
+    for (SimplePhysicalObjectPointer objectPtr : _staticObjectPtrs)
+    {
+        StaticObject &object = _staticObjects[objectPtr];
+        object._stamp = _staticStamp;
+        collectStaticRects(*objectPtr, _staticRects);
+
+        if (isSameRects(object._rects, _staticRects))
+            continue;
+
+        for (const StaticRect &rect : object._rects)
+            _staticLayer.removeRect(rect._rect, rect._style);
+
+        for (const StaticRect &rect : _staticRects)
+            _staticLayer.addRect(rect._rect, rect._style);
+
+        object._rects.swap(_staticRects);
+    }
+
+    for (auto objectIt = _staticObjects.begin(); objectIt != _staticObjects.end(); )
+    {
+        if (objectIt->second._stamp == _staticStamp)
+        {
+            ++objectIt;
+            continue;
+        }
+
+        for (const StaticRect &rect : objectIt->second._rects)
+            _staticLayer.removeRect(rect._rect, rect._style);
+
+        objectIt = _staticObjects.erase(objectIt);
+    }
+}
+
+
+void GamePainter::Impl::resetStaticLayer()
+{
+    _staticLayer.clear();
+    _staticObjects.clear();
+    _staticRevision = 0;
+}
+
+
+void GamePainter::Impl::collectStaticRects(PhysicalObject &node, std::vector<StaticRect> &rects) const
+{
+    rects.clear();
+    const size_t style = DrawCommandBuffer::getStyle(node.isMovable(), node.isSleeping(), false/*node.isStand()*/);
+
+    forEach(node.getGeometry(), [this, &node, &rects, style](const Rectangle &rect)
+    {
+        StaticRect staticRect = {_enginePtr->mapToRender(&node, rect), style};
+        rects.push_back(staticRect);
+    });
+}
+
+
+bool GamePainter::Impl::isSameRects(const std::vector<StaticRect> &firstRects,
+                                    const std::vector<StaticRect> &secondRects)
+{
+    if (firstRects.size() != secondRects.size())
+        return false;
+
+    for (size_t rectNum = 0; rectNum < firstRects.size(); ++rectNum)
+    {
+        const StaticRect &first = firstRects[rectNum];
+        const StaticRect &second = secondRects[rectNum];
+
+        if (   first._style != second._style
+            || first._rect.getX() != second._rect.getX() || first._rect.getY() != second._rect.getY()
+            || first._rect.getWidth() != second._rect.getWidth()
+            || first._rect.getHeight() != second._rect.getHeight())
+            return false;
+    }
+
+    return true;
+}
+
+
+void GamePainter::Impl::drawProfilerOverlay()
+{
+    if (_enginePtr == nullptr || _enginePtr->getProfiler().getFrameCount() == 0)
+        return;
+
+    const PhysicsProfiler::FrameRecord &frame = _enginePtr->getProfiler().getLastFrame();
+    std::vector<std::string> lines;
+    std::ostringstream stream;
+    stream << std::fixed << std::setprecision(3);
+
+    stream << "physics " << frame._frameTime * 1000 << " ms, steps " << frame._stepCount;
+    lines.push_back(stream.str());
+
+    for (size_t phase = 0; phase < PhysicsProfiler::PhaseCount; ++phase)
+    {
+        stream.str("");
+        stream << PhysicsProfiler::getPhaseName(static_cast<PhysicsProfiler::Phase>(phase))
+               << " " << frame._phaseTimes[phase] * 1000 << " ms";
+        lines.push_back(stream.str());
+    }
+
+    for (size_t counter = 0; counter < PhysicsProfiler::CounterCount; ++counter)
+    {
+        stream.str("");
+        stream << PhysicsProfiler::getCounterName(static_cast<PhysicsProfiler::Counter>(counter))
+               << " " << frame._counts[counter];
+        lines.push_back(stream.str());
+    }
+
+    for (size_t lineNum = 0; lineNum < lines.size(); ++lineNum)
+        _commands.addText(OVERLAY_POSITION + Point(0, lineNum * OVERLAY_LINE_HEIGHT), lines[lineNum]);
 }
 
 
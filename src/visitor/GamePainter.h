@@ -22,6 +22,31 @@ public:
     virtual GamePainter& operator=(GamePainter&& other);
     virtual ~GamePainter();
 
+    PhysicalEnginePointer getEnginePtr() const;
+    CameraPointer getCameraPtr() const;
+    bool isProfilerOverlayVisible() const;
+    bool isStaticLayerEnabled() const;
+
+    // objects are drawn at positions interpolated by the engine if it's set
+    void setEnginePtr(PhysicalEnginePointer enginePtr);
+
+    // only objects overlapping the camera viewport are drawn, the world
+    // is drawn in its own coordinates without the camera
+    void setCameraPtr(CameraPointer cameraPtr);
+
+    // the last frame of the engine profiler is drawn over the scene
+    void setProfilerOverlayVisible(bool isVisible);
+
+    // Static objects of the engine are kept in chunks of a static layer,
+    // that the visualizer can draw from its cache, only dynamic objects are
+    // visited every frame. It's used by paint() & enabled by default.
+    void setStaticLayerEnabled(bool isEnabled);
+
+    // Draws the frame. With the engine & the camera set, objects in the
+    // viewport are taken from the engine render grid instead of visiting
+    // all objects of the iterator.
+    void paint(IteratorType iterPtr);
+
     using GameObjectVisitor::visit;
 
     virtual void visit(PhysicalObject &node) override;
@@ -31,6 +56,7 @@ public:
 
 protected:
     virtual void doPreprocessAll() override;
+    virtual void doPostprocessAll() override;
 
 private:
     struct Impl;
@@ -0,0 +1,117 @@
+// Camera.cpp
+
+#include <algorithm>
+
+#include "Camera.h"
+
+
+namespace Platformer
+{
+
+
+struct Camera::Impl
+{
+    Impl()
+    {
+    }
+
+    void clampToBounds();
+    static double clamp(double position, double size, double boundsPosition, double boundsSize);
+
+    Rectangle _viewport;
+    Rectangle _bounds;
+    PhysicalObjectPointer _targetPtr;
+};
+
+
+
+Camera::Camera()
+    : _pimpl(new Impl())
+{
+}
+
+
+Camera::Camera(Camera&& /*other*/) = default;
+Camera& Camera::operator=(Camera&& /*other*/) = default;
+Camera::~Camera() = default;
+
+
+Rectangle Camera::getViewport() const
+{
+    return _pimpl->_viewport;
+}
+
+
+Rectangle Camera::getBounds() const
+{
+    return _pimpl->_bounds;
+}
+
+
+PhysicalObjectPointer Camera::getTargetPtr() const
+{
+    return _pimpl->_targetPtr;
+}
+
+
+void Camera::setViewport(const Rectangle &viewport)
+{
+    _pimpl->_viewport = viewport;
+    _pimpl->clampToBounds();
+}
+
+
+void Camera::setViewportSize(const Point &size)
+{
+    // the center stays in place
+    Point center = _pimpl->_viewport.getPosition() + _pimpl->_viewport.getSize() * 0.5;
+    setViewport(Rectangle(center + size * -0.5, size));
+}
+
+
+void Camera::setBounds(const Rectangle &bounds)
+{
+    _pimpl->_bounds = bounds;
+    _pimpl->clampToBounds();
+}
+
+
+void Camera::setTargetPtr(PhysicalObjectPointer targetPtr)
+{
+    _pimpl->_targetPtr = targetPtr;
+}
+
+
+void Camera::follow(const Rectangle &targetRect)
+{
+    Point center = targetRect.getPosition() + targetRect.getSize() * 0.5;
+    setViewport(Rectangle(center + _pimpl->_viewport.getSize() * -0.5, _pimpl->_viewport.getSize()));
+}
+
+
+Rectangle Camera::mapToScreen(const Rectangle &rect) const
+{
+    return Rectangle(rect.getPosition() + _pimpl->_viewport.getPosition() * -1, rect.getSize());
+}
+
+
+void Camera::Impl::clampToBounds()
+{
+    if (_bounds.getWidth() <= 0 || _bounds.getHeight() <= 0)
+        return;
+
+    _viewport.setPosition(Point(clamp(_viewport.getX(), _viewport.getWidth(),  _bounds.getX(), _bounds.getWidth()),
+                                clamp(_viewport.getY(), _viewport.getHeight(), _bounds.getY(), _bounds.getHeight())));
+}
+
+
+double Camera::Impl::clamp(double position, double size, double boundsPosition, double boundsSize)
+{
+    if (size >= boundsSize)
+        return boundsPosition + (boundsSize - size) / 2;
+
+    return std::max(boundsPosition, std::min(position, boundsPosition + boundsSize - size));
+}
+
+
+}  // namespace Platformer
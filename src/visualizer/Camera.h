@@ -0,0 +1,53 @@
+// Camera.h
+
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include <memory>
+
+#include "Types.h"
+#include "geometry/Point.h"
+#include "geometry/Rectangle.h"
+
+
+namespace Platformer
+{
+
+
+// Part of the world shown by the visualizer. The viewport is centered on
+// the target, when it's set, and is kept inside the bounds, when they
+// aren't empty. A viewport larger than the bounds is centered on them.
+class Camera
+{
+public:
+    Camera();
+    Camera(Camera&& other);
+    virtual Camera& operator=(Camera&& other);
+    virtual ~Camera();
+
+    // viewport in world coordinates
+    Rectangle getViewport() const;
+    Rectangle getBounds() const;
+    PhysicalObjectPointer getTargetPtr() const;
+
+    // the position is changed to keep the viewport inside the bounds
+    void setViewport(const Rectangle &viewport);
+    void setViewportSize(const Point &size);
+    void setBounds(const Rectangle &bounds);
+    void setTargetPtr(PhysicalObjectPointer targetPtr);
+
+    // centers the viewport on the rectangle of the target
+    void follow(const Rectangle &targetRect);
+
+    // from world to visualizer coordinates
+    Rectangle mapToScreen(const Rectangle &rect) const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> _pimpl;
+};
+
+
+}  // namespace Platformer
+
+#endif  // CAMERA_H
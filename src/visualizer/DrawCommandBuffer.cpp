@@ -0,0 +1,51 @@
+// DrawCommandBuffer.cpp
+
+#include "DrawCommandBuffer.h"
+
+
+namespace Platformer
+{
+
+
+DrawCommandBuffer::DrawCommandBuffer() = default;
+DrawCommandBuffer::~DrawCommandBuffer() = default;
+
+
+size_t DrawCommandBuffer::getRectCount() const
+{
+    size_t rectCount = 0;
+
+    for (const std::vector<RectCommand> &rects : _rects)
+        rectCount += rects.size();
+
+    return rectCount;
+}
+
+
+void DrawCommandBuffer::addText(const Point &position, const std::string &text)
+{
+    TextCommand command = {position, _textChars.size(), text.size()};
+    _texts.push_back(command);
+    _textChars.insert(_textChars.end(), text.begin(), text.end());
+}
+
+
+void DrawCommandBuffer::setStaticLayer(const StaticLayer *layerPtr, const Rectangle &viewport)
+{
+    _staticLayerPtr = layerPtr;
+    _staticViewport = viewport;
+}
+
+
+void DrawCommandBuffer::clear()
+{
+    for (std::vector<RectCommand> &rects : _rects)
+        rects.clear();
+
+    _texts.clear();
+    _textChars.clear();
+    _staticLayerPtr = nullptr;
+}
+
+
+}  // namespace Platformer
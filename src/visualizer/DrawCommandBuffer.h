@@ -0,0 +1,90 @@
+// DrawCommandBuffer.h
+
+#ifndef DRAWCOMMANDBUFFER_H
+#define DRAWCOMMANDBUFFER_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "Types.h"
+#include "geometry/Point.h"
+#include "geometry/Rectangle.h"
+
+
+namespace Platformer
+{
+
+
+// Draw commands of one frame for Visualizer::drawCommands(). Rectangles are
+// kept in one array per style, so a backend sets a style once for all its
+// rectangles, texts go over them. The part of a static layer in the viewport
+// goes under all of them. clear() keeps the memory, steady frames don't
+// allocate.
+class DrawCommandBuffer
+{
+public:
+    enum StyleFlag : uint8_t
+    {
+        MovableStyle = 1,
+        StaticStyle  = 2,
+        StandStyle   = 4,
+        StyleCount   = 8
+    };
+
+    // compact rectangle of screen coordinates
+    struct RectCommand
+    {
+        float _x, _y, _width, _height;
+    };
+
+    struct TextCommand
+    {
+        Point _position;
+        size_t _textBeginNum;
+        size_t _textLength;
+    };
+
+    DrawCommandBuffer();
+    ~DrawCommandBuffer();
+
+    static inline size_t getStyle(bool isMovable, bool isStatic, bool isStand)
+    {
+        return (isMovable ? MovableStyle : 0) | (isStatic ? StaticStyle : 0) | (isStand ? StandStyle : 0);
+    }
+
+    // rectangles of the style in the order they were added
+    inline const std::vector<RectCommand> &getRects(size_t style) const { return _rects[style]; }
+    inline size_t getTextCount() const { return _texts.size(); }
+    inline const TextCommand &getText(size_t num) const { return _texts[num]; }
+    inline const char *getTextChars(const TextCommand &text) const { return _textChars.data() + text._textBeginNum; }
+    size_t getRectCount() const;
+    inline const StaticLayer *getStaticLayerPtr() const { return _staticLayerPtr; }
+    inline const Rectangle &getStaticViewport() const  { return _staticViewport; }
+
+    inline void addRect(const Rectangle &rect, bool isMovable, bool isStatic, bool isStand)
+    {
+        RectCommand command = {static_cast<float>(rect.getX()),     static_cast<float>(rect.getY()),
+                               static_cast<float>(rect.getWidth()), static_cast<float>(rect.getHeight())};
+        _rects[getStyle(isMovable, isStatic, isStand)].push_back(command);
+    }
+
+    void addText(const Point &position, const std::string &text);
+
+    // the layer is drawn from the viewport of world coordinates, its left
+    // top corner is the scene origin, the layer isn't owned
+    void setStaticLayer(const StaticLayer *layerPtr, const Rectangle &viewport);
+    void clear();
+
+private:
+    std::vector<RectCommand> _rects[StyleCount];
+    std::vector<TextCommand> _texts;
+    std::vector<char> _textChars;
+    const StaticLayer *_staticLayerPtr = nullptr;
+    Rectangle _staticViewport;
+};
+
+
+}  // namespace Platformer
+
+#endif  // DRAWCOMMANDBUFFER_H
@@ -0,0 +1,183 @@
+// StaticLayer.cpp
+
+#include <cmath>
+#include <stdexcept>
+
+#include "StaticLayer.h"
+
+
+namespace Platformer
+{
+
+
+// pens up to 2 pixels wide are drawn over the rectangle borders
+const double StaticLayer::OUTLINE_MARGIN = 2;
+
+
+StaticLayer::StaticLayer(double chunkSize)
+{
+    setChunkSize(chunkSize);
+}
+
+
+StaticLayer::~StaticLayer()
+{
+}
+
+
+void StaticLayer::setChunkSize(double chunkSize)
+{
+    if (!(chunkSize > 0))
+        throw std::logic_error("StaticLayer::setChunkSize: chunk size must be positive");
+
+    _chunkSize = chunkSize;
+    clear();
+}
+
+
+void StaticLayer::addRect(const Rectangle &rect, size_t style)
+{
+    if (style >= DrawCommandBuffer::StyleCount)
+        throw std::logic_error("StaticLayer::addRect: wrong style");
+
+    const ChunkRange chunkRange = getChunkRange(rect, OUTLINE_MARGIN);
+    const DrawCommandBuffer::RectCommand command = toRectCommand(rect);
+
+    for (long chunkX = chunkRange._left; chunkX <= chunkRange._right; ++chunkX)
+        for (long chunkY = chunkRange._top; chunkY <= chunkRange._bottom; ++chunkY)
+        {
+            const ChunkKey key = getChunkKey(chunkX, chunkY);
+            Chunk &chunk = _chunks[key];
+
+            if (chunk._revision == 0)
+            {
+                chunk._key = key;
+                chunk._rect = Rectangle(chunkX * _chunkSize, chunkY * _chunkSize, _chunkSize, _chunkSize);
+            }
+
+            chunk._rects[style].push_back(command);
+            chunk._revision = ++_lastRevision;
+        }
+}
+
+
+void StaticLayer::removeRect(const Rectangle &rect, size_t style)
+{
+    if (style >= DrawCommandBuffer::StyleCount)
+        throw std::logic_error("StaticLayer::removeRect: wrong style");
+
+    const ChunkRange chunkRange = getChunkRange(rect, OUTLINE_MARGIN);
+    const DrawCommandBuffer::RectCommand command = toRectCommand(rect);
+    bool isFound = false;
+
+    for (long chunkX = chunkRange._left; chunkX <= chunkRange._right; ++chunkX)
+        for (long chunkY = chunkRange._top; chunkY <= chunkRange._bottom; ++chunkY)
+        {
+            auto chunkIt = _chunks.find(getChunkKey(chunkX, chunkY));
+
+            if (chunkIt == _chunks.end())
+                continue;
+
+            // the drawing order of the rest is kept
+            std::vector<DrawCommandBuffer::RectCommand> &rects = chunkIt->second._rects[style];
+
+            for (auto rectIt = rects.begin(); rectIt != rects.end(); ++rectIt)
+            {
+                if (   rectIt->_x == command._x && rectIt->_y == command._y
+                    && rectIt->_width == command._width && rectIt->_height == command._height)
+                {
+                    rects.erase(rectIt);
+                    isFound = true;
+                    break;
+                }
+            }
+
+            chunkIt->second._revision = ++_lastRevision;
+            bool isEmpty = true;
+
+            for (const std::vector<DrawCommandBuffer::RectCommand> &styleRects : chunkIt->second._rects)
+                isEmpty = isEmpty && styleRects.empty();
+
+            if (isEmpty)
+                _chunks.erase(chunkIt);
+        }
+
+    if (!isFound)
+        throw std::logic_error("StaticLayer::removeRect: the rectangle isn't found");
+}
+
+
+void StaticLayer::clear()
+{
+    _chunks.clear();
+}
+
+
+void StaticLayer::findChunks(const Rectangle &rect, std::vector<const Chunk*> &chunkPtrs) const
+{
+    chunkPtrs.clear();
+    const ChunkRange chunkRange = getChunkRange(rect, 0);
+
+    if (chunkRange._left > chunkRange._right || chunkRange._top > chunkRange._bottom)
+        return;
+
+    // a rectangle larger than the layer is tested against all chunks
+    const double chunkCount = (static_cast<double>(chunkRange._right) - chunkRange._left + 1)
+                            * (static_cast<double>(chunkRange._bottom) - chunkRange._top + 1);
+
+    if (chunkCount > _chunks.size())
+    {
+        for (const auto &chunk : _chunks)
+            if (chunk.second._rect.isCollided(rect))
+                chunkPtrs.push_back(&chunk.second);
+
+        return;
+    }
+
+    for (long chunkX = chunkRange._left; chunkX <= chunkRange._right; ++chunkX)
+        for (long chunkY = chunkRange._top; chunkY <= chunkRange._bottom; ++chunkY)
+        {
+            auto chunkIt = _chunks.find(getChunkKey(chunkX, chunkY));
+
+            if (chunkIt != _chunks.end())
+                chunkPtrs.push_back(&chunkIt->second);
+        }
+}
+
+
+StaticLayer::ChunkRange StaticLayer::getChunkRange(const Rectangle &rect, double margin) const
+{
+    ChunkRange chunkRange;
+
+    if (rect.getWidth() < 0 || rect.getHeight() < 0)
+        return chunkRange;
+
+    chunkRange._left   = getChunkNum(rect.getLeft() - margin);
+    chunkRange._top    = getChunkNum(rect.getTop() - margin);
+    chunkRange._right  = getChunkNum(rect.getRight() + margin);
+    chunkRange._bottom = getChunkNum(rect.getBottom() + margin);
+    return chunkRange;
+}
+
+
+StaticLayer::ChunkKey StaticLayer::getChunkKey(long chunkX, long chunkY) const
+{
+    return (static_cast<ChunkKey>(static_cast<uint32_t>(chunkX)) << 32) | static_cast<uint32_t>(chunkY);
+}
+
+
+long StaticLayer::getChunkNum(double coordinate) const
+{
+    return static_cast<long>(std::floor(coordinate / _chunkSize));
+}
+
+
+DrawCommandBuffer::RectCommand StaticLayer::toRectCommand(const Rectangle &rect)
+{
+    DrawCommandBuffer::RectCommand command = {static_cast<float>(rect.getX()),     static_cast<float>(rect.getY()),
+                                              static_cast<float>(rect.getWidth()), static_cast<float>(rect.getHeight())};
+    return command;
+}
+
+
+}  // namespace Platformer
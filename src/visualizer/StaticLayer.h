@@ -0,0 +1,80 @@
+// StaticLayer.h
+
+#ifndef STATICLAYER_H
+#define STATICLAYER_H
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include "Types.h"
+#include "geometry/Rectangle.h"
+#include "DrawCommandBuffer.h"
+
+
+namespace Platformer
+{
+
+
+// Rectangles of objects, that never move, split into square chunks of world
+// coordinates. A rectangle is kept in every chunk it can touch with its
+// outline, so a chunk is drawn alone. A backend caches the drawn chunks and
+// redraws a chunk only when its revision changes. Revisions are unique in
+// the layer, a chunk made again after removal gets a new one.
+class StaticLayer
+{
+public:
+    using ChunkKey = uint64_t;
+
+    struct Chunk
+    {
+        ChunkKey _key = 0;
+        Rectangle _rect;
+        uint64_t _revision = 0;
+
+        // world rectangles in the order they were added
+        std::vector<DrawCommandBuffer::RectCommand> _rects[DrawCommandBuffer::StyleCount];
+    };
+
+    StaticLayer(double chunkSize = 256);
+    ~StaticLayer();
+
+    inline double getChunkSize() const  { return _chunkSize; }
+    inline size_t getChunkCount() const { return _chunks.size(); }
+
+    // rectangles are dropped by chunk size change
+    void setChunkSize(double chunkSize);
+
+    // the style is made by DrawCommandBuffer::getStyle(), a rectangle is
+    // removed by the same rectangle & style
+    void addRect(const Rectangle &rect, size_t style);
+    void removeRect(const Rectangle &rect, size_t style);
+    void clear();
+
+    // chunks overlapping the rectangle in no order, empty chunks are removed
+    void findChunks(const Rectangle &rect, std::vector<const Chunk*> &chunkPtrs) const;
+
+private:
+    struct ChunkRange
+    {
+        long _left = 0, _top = 0, _right = -1, _bottom = -1;
+    };
+
+    ChunkRange getChunkRange(const Rectangle &rect, double margin) const;
+    ChunkKey getChunkKey(long chunkX, long chunkY) const;
+    long getChunkNum(double coordinate) const;
+    static DrawCommandBuffer::RectCommand toRectCommand(const Rectangle &rect);
+
+private:
+    double _chunkSize = 256;
+    std::unordered_map<ChunkKey, Chunk> _chunks;
+    uint64_t _lastRevision = 0;
+
+    // constants
+    static const double OUTLINE_MARGIN;
+};
+
+
+}  // namespace Platformer
+
+#endif  // STATICLAYER_H
@@ -1,5 +1,9 @@
 // Visualizer.cpp
 
+#include <vector>
+
+#include "DrawCommandBuffer.h"
+#include "StaticLayer.h"
 #include "Visualizer.h"
 
 
@@ -12,6 +16,8 @@ struct Visualizer::Impl
     Impl()
     {
     }
+
+    std::vector<const StaticLayer::Chunk*> _chunkPtrs;
 };
 
 
@@ -31,4 +37,44 @@ void Visualizer::refresh()
 }
 
 
+void Visualizer::drawText(const Point &/*position*/, const std::string &/*text*/)
+{
+}
+
+
+void Visualizer::drawCommands(const DrawCommandBuffer &buffer)
+{
+    clear();
+
+    // without a cache the static layer is drawn rectangle by rectangle,
+    // rectangles of several chunks are drawn by each of them
+    if (buffer.getStaticLayerPtr() != nullptr)
+    {
+        const Rectangle &viewport = buffer.getStaticViewport();
+        buffer.getStaticLayerPtr()->findChunks(viewport, _pimpl->_chunkPtrs);
+
+        for (const StaticLayer::Chunk *chunkPtr : _pimpl->_chunkPtrs)
+            for (size_t style = 0; style < DrawCommandBuffer::StyleCount; ++style)
+                for (const DrawCommandBuffer::RectCommand &rect : chunkPtr->_rects[style])
+                    drawRect(Rectangle(rect._x - viewport.getX(), rect._y - viewport.getY(), rect._width, rect._height),
+                             (style & DrawCommandBuffer::MovableStyle) != 0,
+                             (style & DrawCommandBuffer::StaticStyle) != 0,
+                             (style & DrawCommandBuffer::StandStyle) != 0);
+    }
+
+    for (size_t style = 0; style < DrawCommandBuffer::StyleCount; ++style)
+        for (const DrawCommandBuffer::RectCommand &rect : buffer.getRects(style))
+            drawRect(Rectangle(rect._x, rect._y, rect._width, rect._height),
+                     (style & DrawCommandBuffer::MovableStyle) != 0,
+                     (style & DrawCommandBuffer::StaticStyle) != 0,
+                     (style & DrawCommandBuffer::StandStyle) != 0);
+
+    for (size_t textNum = 0; textNum < buffer.getTextCount(); ++textNum)
+    {
+        const DrawCommandBuffer::TextCommand &text = buffer.getText(textNum);
+        drawText(text._position, std::string(buffer.getTextChars(text), text._textLength));
+    }
+}
+
+
 }  // namespace Platformer
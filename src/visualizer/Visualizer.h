@@ -4,7 +4,9 @@
 #define VISUALIZER_H
 
 #include <memory>
+#include <string>
 
+#include "Types.h"
 #include "geometry/Rectangle.h"
 
 
@@ -24,6 +26,14 @@ public:
     virtual void clear() = 0;
     virtual void refresh();
     virtual void drawRect(const Rectangle &rect, bool isMovable, bool isStatic, bool isStand) = 0;
+
+    // text of debug overlays, the position is the left top corner of the text
+    virtual void drawText(const Point &position, const std::string &text);
+
+    // Draws the whole frame, the scene is cleared first. By default the
+    // commands are replayed by clear(), drawRect() & drawText() calls,
+    // backends can cache chunks of the static layer instead.
+    virtual void drawCommands(const DrawCommandBuffer &buffer);
     virtual void setSceneRect(const Rectangle &rect) = 0;
 
 protected:
@@ -0,0 +1,48 @@
+// AllocationCounter.cpp
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "AllocationCounter.h"
+
+
+namespace
+{
+
+
+std::atomic<size_t> allocationCount(0);
+
+
+}  // namespace
+
+
+namespace Platformer
+{
+
+
+size_t getAllocationCount()
+{
+    return allocationCount;
+}
+
+
+}  // namespace Platformer
+
+
+// the sized, array & nothrow forms of the standard library call these ones
+void *operator new(size_t size)
+{
+    ++allocationCount;
+
+    if (void *ptr = std::malloc(size == 0 ? 1 : size))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
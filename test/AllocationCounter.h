@@ -0,0 +1,20 @@
+// AllocationCounter.h
+
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+#include <cstddef>
+
+
+namespace Platformer
+{
+
+
+// Number of global operator new calls of all threads since the start, the
+// operators are replaced by the test, that links AllocationCounter.cpp.
+size_t getAllocationCount();
+
+
+}  // namespace Platformer
+
+#endif  // ALLOCATIONCOUNTER_H
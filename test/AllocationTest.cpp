@@ -0,0 +1,165 @@
+// AllocationTest.cpp
+
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "platform/Platform.h"
+#include "platform/headless/HeadlessPlatformManager.h"
+#include "physics/PhysicalWorld.h"
+#include "physics/PhysicalEngine.h"
+#include "physics/TestObject.h"
+#include "physics/MapPlatform.h"
+#include "physics/StrictCollisionProcessor.h"
+#include "physics/KineticCollisionProcessor.h"
+#include "AllocationCounter.h"
+
+using namespace Platformer;
+
+
+namespace
+{
+
+
+const size_t TILE_COUNT = 400;
+const size_t BOX_COUNT = 100;
+const size_t WARM_UP_FRAME_COUNT = 120;
+const size_t FRAME_COUNT = 240;
+
+
+// Counts heap allocations of collision processing, the rest of the engine
+// step isn't counted.
+template <typename Processor>
+class CountingProcessor : public Processor
+{
+public:
+    CountingProcessor(SimplePhysicalEnginePointer enginePtr)
+        : Processor(enginePtr)
+    {
+    }
+
+    size_t getCountedAllocations() const
+    {
+        return _allocationCount;
+    }
+
+    void resetCountedAllocations()
+    {
+        _allocationCount = 0;
+    }
+
+    virtual void beginFrame(double frameTimeSec) override
+    {
+        const size_t startCount = Platformer::getAllocationCount();
+        Processor::beginFrame(frameTimeSec);
+        _allocationCount += Platformer::getAllocationCount() - startCount;
+    }
+
+    virtual void processSubStep(double subStepTimeSec) override
+    {
+        const size_t startCount = Platformer::getAllocationCount();
+        Processor::processSubStep(subStepTimeSec);
+        _allocationCount += Platformer::getAllocationCount() - startCount;
+    }
+
+private:
+    size_t _allocationCount = 0;
+};
+
+
+// a floor with walls & boxes thrown on it, they keep hitting each other
+void createScene(PhysicalWorldPointer worldPtr)
+{
+    static const double TILE_SIZE = 30;
+    static const double BOX_SIZE = 20;
+    static const double HEIGHT = 600;
+
+    const double width = TILE_COUNT * TILE_SIZE;
+
+    worldPtr->addSubObject(std::make_shared<MapPlatform>(Rectangle(-TILE_SIZE, 0, TILE_SIZE, HEIGHT)));
+    worldPtr->addSubObject(std::make_shared<MapPlatform>(Rectangle(width, 0, TILE_SIZE, HEIGHT)));
+
+    for (size_t tileNum = 0; tileNum < TILE_COUNT; ++tileNum)
+        worldPtr->addSubObject(std::make_shared<MapPlatform>(Rectangle(tileNum * TILE_SIZE, HEIGHT,
+                                                                       TILE_SIZE, TILE_SIZE)));
+
+    std::mt19937 random(1);
+    std::uniform_real_distribution<double> xDistribution(0, width - BOX_SIZE);
+    std::uniform_real_distribution<double> yDistribution(0, HEIGHT - BOX_SIZE);
+    std::uniform_real_distribution<double> speedDistribution(-300, 300);
+
+    for (size_t boxNum = 0; boxNum < BOX_COUNT; ++boxNum)
+    {
+        TestObjectPointer boxPtr = std::make_shared<TestObject>();
+
+        boxPtr->setPosition(Point(xDistribution(random), yDistribution(random)));
+        boxPtr->setSize(Point(BOX_SIZE, BOX_SIZE));
+        boxPtr->setSpeed(Point(speedDistribution(random), speedDistribution(random)));
+        worldPtr->addSubObject(boxPtr);
+    }
+}
+
+
+// runs the scene & returns the number of frames, that allocated
+template <typename Processor>
+size_t runScene(const std::string &name, size_t threadCount)
+{
+    PhysicalWorldPointer worldPtr = std::make_shared<PhysicalWorld>();
+    createScene(worldPtr);
+
+    PhysicalEnginePointer enginePtr = std::make_shared<PhysicalEngine>();
+    std::shared_ptr<CountingProcessor<Processor> > processorPtr
+            = std::make_shared<CountingProcessor<Processor> >(enginePtr.get());
+
+    enginePtr->setWorldPtr(worldPtr);
+    enginePtr->setCollisionProcessorPtr(processorPtr);
+    enginePtr->setThreadCount(threadCount);
+
+    // resting contacts are solved & fast boxes split steps, so all paths run
+    enginePtr->setContactIterationCount(4);
+    enginePtr->setMaxSubStepDistance(4);
+    worldPtr->setEnginePtr(enginePtr);
+
+    // buffers of the processors grow during the warm-up only
+    for (size_t frameNum = 0; frameNum < WARM_UP_FRAME_COUNT; ++frameNum)
+        enginePtr->processWorld();
+
+    size_t allocatingFrameCount = 0;
+    size_t totalAllocationCount = 0;
+
+    for (size_t frameNum = 0; frameNum < FRAME_COUNT; ++frameNum)
+    {
+        processorPtr->resetCountedAllocations();
+        enginePtr->processWorld();
+
+        if (processorPtr->getCountedAllocations() != 0 && allocatingFrameCount++ == 0)
+            std::cerr << name << ", threads " << threadCount << ": frame " << WARM_UP_FRAME_COUNT + frameNum
+                      << " allocated " << processorPtr->getCountedAllocations() << " times" << std::endl;
+
+        totalAllocationCount += processorPtr->getCountedAllocations();
+    }
+
+    std::cout << name << ", threads " << threadCount << ": allocating frames " << allocatingFrameCount
+              << ", allocations " << totalAllocationCount << std::endl;
+
+    return allocatingFrameCount;
+}
+
+
+}  // namespace
+
+
+// Collision processing mustn't allocate on the heap in steady-state frames.
+int main(int argc, char *argv[])
+{
+    std::shared_ptr<HeadlessPlatformManager> managerPtr(new HeadlessPlatformManager(argc, argv));
+    Platform::instance()->initialize(managerPtr);
+    Platform::instance()->setFPS(60);
+
+    size_t allocatingFrameCount = 0;
+    allocatingFrameCount += runScene<StrictCollisionProcessor>("strict", 1);
+    allocatingFrameCount += runScene<StrictCollisionProcessor>("strict", 2);
+    allocatingFrameCount += runScene<KineticCollisionProcessor>("kinetic", 1);
+
+    return allocatingFrameCount == 0 ? 0 : 1;
+}
@@ -0,0 +1,222 @@
+// ContactCacheTest.cpp
+
+#include <iostream>
+#include <random>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <utility>
+
+#include "physics/BodyStore.h"
+#include "physics/ContactCache.h"
+#include "physics/TestObject.h"
+
+using namespace Platformer;
+
+
+namespace
+{
+
+
+const size_t BODY_COUNT = 48;
+const size_t ROUND_COUNT = 200;
+
+// the table of a few contacts has the minimum slot count, the probe run of
+// the pairs goes from its last slots over the end to the first ones
+const size_t SLOT_COUNT = 64;
+const size_t RUN_HOME_SLOT_NUMS[] = {62, 63, 0, 1};
+const size_t PAIRS_PER_HOME_SLOT = 4;
+
+
+using BodyPair = std::pair<size_t, size_t>;
+
+
+// the same hashing of the handle slot numbers as in the cache
+size_t getHomeSlotNum(const BodyStore &bodyStore, const BodyPair &pair)
+{
+    const uint64_t firstSlotNum  = bodyStore.getHandle(pair.first)._slotNum;
+    const uint64_t secondSlotNum = bodyStore.getHandle(pair.second)._slotNum;
+    const uint64_t key = (std::min(firstSlotNum, secondSlotNum) << 32) | std::max(firstSlotNum, secondSlotNum);
+
+    return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & (SLOT_COUNT - 1);
+}
+
+
+std::vector<BodyPair> findCollidingPairs(const BodyStore &bodyStore)
+{
+    std::vector<BodyPair> pairs;
+
+    for (size_t homeSlotNum : RUN_HOME_SLOT_NUMS)
+    {
+        size_t pairCount = 0;
+
+        for (size_t firstNum = 0; firstNum < BODY_COUNT && pairCount < PAIRS_PER_HOME_SLOT; ++firstNum)
+            for (size_t secondNum = firstNum + 1; secondNum < BODY_COUNT && pairCount < PAIRS_PER_HOME_SLOT; ++secondNum)
+                if (getHomeSlotNum(bodyStore, BodyPair(firstNum, secondNum)) == homeSlotNum)
+                {
+                    pairs.emplace_back(firstNum, secondNum);
+                    ++pairCount;
+                }
+    }
+
+    return pairs;
+}
+
+
+// the impulse marks the contact of the pair
+bool isContactFound(const ContactCache &contactCache, const BodyStore &bodyStore,
+                    const BodyPair &pair, double impulse)
+{
+    const ContactCache::Contact *contactPtr = contactCache.findContact(pair.second, pair.first);
+
+    return contactPtr != nullptr
+        && contactPtr->_firstHandle == bodyStore.getHandle(pair.first)
+        && contactPtr->_secondHandle == bodyStore.getHandle(pair.second)
+        && contactPtr->_impulse == impulse;
+}
+
+
+// Pairs are inserted & erased in random orders, contacts of a frame, which
+// aren't refreshed, are erased at its end. Remaining keys have to be found
+// after every erase, so slots shifted back by it are still on their runs.
+size_t testErase(ContactCache &contactCache, const BodyStore &bodyStore, std::vector<BodyPair> pairs)
+{
+    std::mt19937 random(1);
+    size_t failureCount = 0;
+
+    for (size_t roundNum = 0; roundNum < ROUND_COUNT; ++roundNum)
+    {
+        contactCache.clear();
+        contactCache.beginFrame();
+        std::shuffle(pairs.begin(), pairs.end(), random);
+
+        for (size_t pairNum = 0; pairNum < pairs.size(); ++pairNum)
+            contactCache.refreshContact(pairs[pairNum].first, pairs[pairNum].second, Down)._impulse = pairs[pairNum].first + 1;
+
+        std::shuffle(pairs.begin(), pairs.end(), random);
+
+        for (size_t erasedCount = 1; erasedCount <= pairs.size(); ++erasedCount)
+        {
+            contactCache.beginFrame();
+
+            for (size_t pairNum = erasedCount; pairNum < pairs.size(); ++pairNum)
+                contactCache.refreshContact(pairs[pairNum].first, pairs[pairNum].second, Down);
+
+            contactCache.removeStaleContacts();
+
+            const BodyPair &erasedPair = pairs[erasedCount - 1];
+
+            if (contactCache.findContact(erasedPair.first, erasedPair.second) != nullptr)
+            {
+                std::cerr << "round " << roundNum << ": the erased pair " << erasedPair.first
+                          << ", " << erasedPair.second << " is found" << std::endl;
+                ++failureCount;
+            }
+
+            for (size_t pairNum = erasedCount; pairNum < pairs.size(); ++pairNum)
+                if (!isContactFound(contactCache, bodyStore, pairs[pairNum], pairs[pairNum].first + 1))
+                {
+                    std::cerr << "round " << roundNum << ": the pair " << pairs[pairNum].first << ", "
+                              << pairs[pairNum].second << " is lost after " << erasedCount << " erases" << std::endl;
+                    ++failureCount;
+                }
+
+            if (contactCache.getContactCount() != pairs.size() - erasedCount)
+            {
+                std::cerr << "round " << roundNum << ": " << contactCache.getContactCount()
+                          << " contacts instead of " << pairs.size() - erasedCount << std::endl;
+                ++failureCount;
+            }
+        }
+    }
+
+    return failureCount;
+}
+
+
+// the body, which takes the handle slot of a removed one, has the same key,
+// but another generation, so the old contact isn't continued
+size_t testGeneration(ContactCache &contactCache, BodyStore &bodyStore,
+                      std::vector<std::unique_ptr<TestObject>> &objectPtrs)
+{
+    size_t failureCount = 0;
+    const size_t firstNum = 0;
+    const size_t secondNum = 1;
+
+    contactCache.clear();
+    contactCache.beginFrame();
+    ContactCache::Contact &contact = contactCache.refreshContact(firstNum, secondNum, Down);
+    contact._impulse = 1;
+
+    const BodyStore::Handle firstHandle = bodyStore.getHandle(firstNum);
+    const BodyStore::Handle removedHandle = bodyStore.getHandle(secondNum);
+    bodyStore.remove(secondNum);
+
+    objectPtrs.emplace_back(new TestObject());
+    const size_t newNum = bodyStore.attach(objectPtrs.back().get());
+    const BodyStore::Handle newHandle = bodyStore.getHandle(newNum);
+
+    if (newHandle._slotNum != removedHandle._slotNum || newHandle == removedHandle)
+    {
+        std::cerr << "the new body doesn't reuse the handle slot" << std::endl;
+        return 1;
+    }
+
+    contactCache.beginFrame();
+
+    if (contactCache.findContact(bodyStore.getBodyNum(firstHandle), newNum) != nullptr)
+    {
+        std::cerr << "the contact of the removed body is found for the new one" << std::endl;
+        ++failureCount;
+    }
+
+    const ContactCache::Contact &newContact = contactCache.refreshContact(bodyStore.getBodyNum(firstHandle), newNum, Down);
+
+    if (newContact._impulse != 0 || newContact._age != 0 || newContact._secondHandle != newHandle)
+    {
+        std::cerr << "the contact of the removed body isn't reset for the new one" << std::endl;
+        ++failureCount;
+    }
+
+    if (contactCache.getContactCount() != 1)
+    {
+        std::cerr << contactCache.getContactCount() << " contacts instead of one" << std::endl;
+        ++failureCount;
+    }
+
+    return failureCount;
+}
+
+
+}  // namespace
+
+
+
+int main()
+{
+    std::vector<std::unique_ptr<TestObject>> objectPtrs;
+    BodyStore bodyStore;
+    ContactCache contactCache(bodyStore);
+
+    for (size_t bodyNum = 0; bodyNum < BODY_COUNT; ++bodyNum)
+    {
+        objectPtrs.emplace_back(new TestObject());
+        bodyStore.attach(objectPtrs.back().get());
+    }
+
+    const std::vector<BodyPair> pairs = findCollidingPairs(bodyStore);
+
+    if (pairs.size() != PAIRS_PER_HOME_SLOT * sizeof(RUN_HOME_SLOT_NUMS) / sizeof(RUN_HOME_SLOT_NUMS[0]))
+    {
+        std::cerr << "only " << pairs.size() << " colliding pairs are found" << std::endl;
+        return 1;
+    }
+
+    size_t failureCount = testErase(contactCache, bodyStore, pairs);
+    failureCount += testGeneration(contactCache, bodyStore, objectPtrs);
+
+    std::cout << "pairs " << pairs.size() << ", rounds " << ROUND_COUNT
+              << ", failures " << failureCount << std::endl;
+
+    return failureCount == 0 ? 0 : 1;
+}
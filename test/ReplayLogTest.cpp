@@ -0,0 +1,214 @@
+// ReplayLogTest.cpp
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include "platform/ReplayLog.h"
+
+using namespace Platformer;
+
+
+namespace
+{
+
+
+const size_t HEADER_SIZE = 5;
+const size_t MANY_EVENT_COUNT = 200;
+
+
+ReplayLog::KeyEvent makeCharEvent(char ch, bool isPressed)
+{
+    ReplayLog::KeyEvent event;
+    event._char = ch;
+    event._isPressed = isPressed;
+    return event;
+}
+
+
+ReplayLog::KeyEvent makeKeyIdEvent(Key::KeyId keyId, bool isPressed)
+{
+    ReplayLog::KeyEvent event;
+    event._keyId = keyId;
+    event._isPressed = isPressed;
+    return event;
+}
+
+
+// Frame times are odd doubles, so the test fails if any bit is lost. The
+// frame with many events takes two bytes of the event count.
+ReplayLog makeLog()
+{
+    ReplayLog log;
+
+    log.addFrame(1.0 / 60);
+
+    log.addKeyEvent(makeCharEvent('d', true));
+    log.addKeyEvent(makeKeyIdEvent(Key::Right, true));
+    log.addFrame(0.1);
+
+    log.addKeyEvent(makeCharEvent(static_cast<char>(0xE9), true));
+    log.addKeyEvent(makeKeyIdEvent(Key::Down, false));
+    log.addKeyEvent(makeCharEvent('d', false));
+    log.addFrame(std::numeric_limits<double>::denorm_min());
+
+    for (size_t eventNum = 0; eventNum < MANY_EVENT_COUNT; ++eventNum)
+        log.addKeyEvent(makeKeyIdEvent(static_cast<Key::KeyId>(eventNum % (Key::Down + 1)), eventNum % 2 == 0));
+
+    log.addFrame(1e300);
+    log.addFrame(-0.0);
+
+    return log;
+}
+
+
+std::string writeLog(const ReplayLog &log)
+{
+    std::ostringstream stream(std::ios::binary);
+    log.write(stream);
+    return stream.str();
+}
+
+
+bool isReadFailed(const std::string &data)
+{
+    std::istringstream stream(data, std::ios::binary);
+    ReplayLog log;
+
+    try
+    {
+        log.read(stream);
+    }
+    catch (const std::runtime_error &)
+    {
+        return true;
+    }
+
+    return false;
+}
+
+
+bool isSameEvent(const ReplayLog::KeyEvent &event, const ReplayLog::KeyEvent &otherEvent)
+{
+    return event._char == otherEvent._char && event._keyId == otherEvent._keyId
+        && event._isPressed == otherEvent._isPressed;
+}
+
+
+bool isSameLog(const ReplayLog &log, const ReplayLog &otherLog)
+{
+    if (log.getFrameCount() != otherLog.getFrameCount())
+        return false;
+
+    for (size_t frameNum = 0; frameNum < log.getFrameCount(); ++frameNum)
+    {
+        // doubles are compared by bits, so a sign of zero differs too
+        const double frameTime = log.getFrameTime(frameNum);
+        const double otherFrameTime = otherLog.getFrameTime(frameNum);
+
+        if (std::memcmp(&frameTime, &otherFrameTime, sizeof(double)) != 0
+                || log.getKeyEventCount(frameNum) != otherLog.getKeyEventCount(frameNum))
+            return false;
+
+        for (size_t eventNum = 0; eventNum < log.getKeyEventCount(frameNum); ++eventNum)
+            if (!isSameEvent(log.getKeyEvent(frameNum, eventNum), otherLog.getKeyEvent(frameNum, eventNum)))
+                return false;
+    }
+
+    return true;
+}
+
+
+// stream sizes of the header & the log prefixes of whole frames, where
+// reading stops without errors
+std::vector<size_t> getFrameEndSizes(const ReplayLog &log)
+{
+    std::vector<size_t> sizes = {HEADER_SIZE};
+
+    for (size_t frameNum = 0; frameNum < log.getFrameCount(); ++frameNum)
+    {
+        const size_t eventCount = log.getKeyEventCount(frameNum);
+        const size_t countSize = eventCount < 0x80 ? 1 : 2;
+        sizes.push_back(sizes.back() + sizeof(double) + countSize + 2 * eventCount);
+    }
+
+    return sizes;
+}
+
+
+}  // namespace
+
+
+
+int main()
+{
+    size_t failureCount = 0;
+    const ReplayLog log = makeLog();
+    const std::string data = writeLog(log);
+
+    // round trip
+    std::istringstream stream(data, std::ios::binary);
+    ReplayLog readLog;
+    readLog.read(stream);
+
+    if (!isSameLog(log, readLog))
+    {
+        std::cerr << "the read log differs from the written one" << std::endl;
+        ++failureCount;
+    }
+
+    // a log cut inside the header or a frame is an error, a log cut between
+    // frames is a shorter session
+    const std::vector<size_t> frameEndSizes = getFrameEndSizes(log);
+
+    if (frameEndSizes.back() != data.size())
+    {
+        std::cerr << "the log takes " << data.size() << " bytes instead of " << frameEndSizes.back() << std::endl;
+        ++failureCount;
+    }
+
+    size_t frameCount = 0;
+
+    for (size_t size = 0; size < data.size(); ++size)
+    {
+        const bool isFrameEnd = size == frameEndSizes[frameCount];
+
+        if (isFrameEnd)
+            ++frameCount;
+
+        if (isReadFailed(data.substr(0, size)) == isFrameEnd)
+        {
+            std::cerr << "the log cut to " << size << " bytes is "
+                      << (isFrameEnd ? "rejected" : "accepted") << std::endl;
+            ++failureCount;
+        }
+    }
+
+    // wrong magic number & version
+    std::string badData = data;
+    badData[0] = 'X';
+
+    if (!isReadFailed(badData))
+    {
+        std::cerr << "the log with a wrong magic number is accepted" << std::endl;
+        ++failureCount;
+    }
+
+    badData = data;
+    badData[HEADER_SIZE - 1] = static_cast<char>(badData[HEADER_SIZE - 1] + 1);
+
+    if (!isReadFailed(badData))
+    {
+        std::cerr << "the log with a wrong version is accepted" << std::endl;
+        ++failureCount;
+    }
+
+    std::cout << "frames " << log.getFrameCount() << ", bytes " << data.size()
+              << ", failures " << failureCount << std::endl;
+
+    return failureCount == 0 ? 0 : 1;
+}
@@ -0,0 +1,341 @@
+// SoftwareVisualizerTest.cpp
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "platform/headless/SoftwareVisualizer.h"
+
+using namespace Platformer;
+
+
+namespace
+{
+
+
+// rows of the PNG take more than a stored deflate block
+const size_t WIDTH = 200;
+const size_t HEIGHT = 100;
+const size_t MAX_BLOCK_SIZE = 65535;
+
+
+uint32_t makeColor(uint8_t red, uint8_t green, uint8_t blue)
+{
+    return static_cast<uint32_t>(red) | static_cast<uint32_t>(green) << 8
+         | static_cast<uint32_t>(blue) << 16 | 0xFF000000u;
+}
+
+
+const uint32_t BACKGROUND_COLOR = makeColor(192, 192, 192);
+const uint32_t MOVABLE_COLOR    = makeColor(255, 255, 255);
+const uint32_t STATIC_COLOR     = makeColor(160, 160, 164);
+const uint32_t PEN_COLOR        = makeColor(0, 0, 0);
+
+
+struct PixelCheck
+{
+    size_t _x;
+    size_t _y;
+    uint32_t _color;
+};
+
+
+size_t checkPixels(const SoftwareVisualizer &visualizer, const char *caseName,
+                   std::initializer_list<PixelCheck> checks)
+{
+    size_t failureCount = 0;
+
+    for (const PixelCheck &check : checks)
+    {
+        const uint32_t pixel = visualizer.getPixel(check._x, check._y);
+
+        if (pixel != check._color)
+        {
+            std::cerr << caseName << ": pixel " << check._x << ", " << check._y << " is " << std::hex << pixel
+                      << " instead of " << check._color << std::dec << std::endl;
+            ++failureCount;
+        }
+    }
+
+    return failureCount;
+}
+
+
+// corners are inclusive, the pen goes inside of them
+size_t testRects(SoftwareVisualizer &visualizer)
+{
+    size_t failureCount = 0;
+
+    visualizer.clear();
+    visualizer.drawRect(Rectangle(10, 10, 10, 8), true, false, false);
+    visualizer.drawRect(Rectangle(30, 10, 10, 10), false, true, true);
+    visualizer.drawRect(Rectangle(50, 10, 10, 10), true, true, false);
+    visualizer.drawRect(Rectangle(70, 10, 0, 0), true, false, false);
+    visualizer.drawRect(Rectangle(90.4, 9.6, 4.2, 3.8), false, true, false);
+
+    failureCount += checkPixels(visualizer, "movable", {
+        {10, 10, PEN_COLOR}, {20, 18, PEN_COLOR}, {15, 10, PEN_COLOR}, {20, 14, PEN_COLOR},
+        {11, 11, MOVABLE_COLOR}, {19, 17, MOVABLE_COLOR},
+        {9, 10, BACKGROUND_COLOR}, {21, 18, BACKGROUND_COLOR}, {15, 19, BACKGROUND_COLOR}});
+
+    failureCount += checkPixels(visualizer, "stand", {
+        {30, 10, PEN_COLOR}, {31, 11, PEN_COLOR}, {39, 19, PEN_COLOR}, {35, 19, PEN_COLOR},
+        {32, 12, STATIC_COLOR}, {38, 18, STATIC_COLOR}, {41, 15, BACKGROUND_COLOR}});
+
+    failureCount += checkPixels(visualizer, "crossed", {
+        {53, 13, PEN_COLOR}, {57, 17, PEN_COLOR}, {53, 17, PEN_COLOR}, {57, 13, PEN_COLOR},
+        {54, 13, MOVABLE_COLOR}, {55, 12, MOVABLE_COLOR}});
+
+    failureCount += checkPixels(visualizer, "zero size", {
+        {70, 10, PEN_COLOR}, {71, 10, BACKGROUND_COLOR}, {69, 10, BACKGROUND_COLOR},
+        {70, 9, BACKGROUND_COLOR}, {70, 11, BACKGROUND_COLOR}});
+
+    failureCount += checkPixels(visualizer, "rounded", {
+        {90, 10, PEN_COLOR}, {95, 13, PEN_COLOR}, {91, 11, STATIC_COLOR}, {94, 12, STATIC_COLOR},
+        {96, 13, BACKGROUND_COLOR}, {95, 14, BACKGROUND_COLOR}});
+
+    return failureCount;
+}
+
+
+// only the parts inside of the framebuffer are drawn, far rectangles are
+// clamped
+size_t testClippedRects(SoftwareVisualizer &visualizer)
+{
+    size_t failureCount = 0;
+
+    visualizer.clear();
+    visualizer.drawRect(Rectangle(-5, -5, 10, 10), true, false, false);
+    visualizer.drawRect(Rectangle(WIDTH - 5, HEIGHT - 5, 10, 10), false, true, true);
+    visualizer.drawRect(Rectangle(-1000, 40, 20, 10), true, false, false);
+
+    failureCount += checkPixels(visualizer, "clipped top left", {
+        {0, 0, MOVABLE_COLOR}, {4, 4, MOVABLE_COLOR}, {5, 0, PEN_COLOR}, {0, 5, PEN_COLOR},
+        {6, 0, BACKGROUND_COLOR}, {0, 6, BACKGROUND_COLOR}});
+
+    failureCount += checkPixels(visualizer, "clipped bottom right", {
+        {WIDTH - 5, HEIGHT - 5, PEN_COLOR}, {WIDTH - 4, HEIGHT - 4, PEN_COLOR},
+        {WIDTH - 3, HEIGHT - 3, STATIC_COLOR}, {WIDTH - 1, HEIGHT - 1, STATIC_COLOR},
+        {WIDTH - 6, HEIGHT - 1, BACKGROUND_COLOR}});
+
+    failureCount += checkPixels(visualizer, "outside", {{0, 45, BACKGROUND_COLOR}});
+
+    // the crosses of the far corners go through the framebuffer diagonal
+    visualizer.clear();
+    visualizer.drawRect(Rectangle(-1e12, -1e12, 2e12, 2e12), true, true, false);
+
+    failureCount += checkPixels(visualizer, "far crossed", {
+        {0, 0, PEN_COLOR}, {50, 50, PEN_COLOR}, {HEIGHT - 1, HEIGHT - 1, PEN_COLOR},
+        {51, 50, MOVABLE_COLOR}, {WIDTH - 1, 0, MOVABLE_COLOR}});
+
+    return failureCount;
+}
+
+
+uint32_t readBigEndian(const std::string &data, size_t pos)
+{
+    uint32_t number = 0;
+
+    for (size_t byteNum = 0; byteNum < 4; ++byteNum)
+        number = number << 8 | static_cast<uint8_t>(data[pos + byteNum]);
+
+    return number;
+}
+
+
+// bitwise CRC-32, so it doesn't share the table with the visualizer
+uint32_t getCrc(const std::string &data, size_t pos, size_t size)
+{
+    uint32_t crc = 0xFFFFFFFF;
+
+    for (size_t num = pos; num < pos + size; ++num)
+    {
+        crc ^= static_cast<uint8_t>(data[num]);
+
+        for (int bitNum = 0; bitNum < 8; ++bitNum)
+            crc = (crc & 1) != 0 ? 0xEDB88320 ^ (crc >> 1) : crc >> 1;
+    }
+
+    return crc ^ 0xFFFFFFFF;
+}
+
+
+uint32_t getAdler(const std::string &data)
+{
+    uint32_t adlerLow = 1, adlerHigh = 0;
+
+    for (char byte : data)
+    {
+        adlerLow = (adlerLow + static_cast<uint8_t>(byte)) % 65521;
+        adlerHigh = (adlerHigh + adlerLow) % 65521;
+    }
+
+    return adlerHigh << 16 | adlerLow;
+}
+
+
+size_t testPpm(const SoftwareVisualizer &visualizer)
+{
+    std::ostringstream stream(std::ios::binary);
+    visualizer.writeImage(stream, SoftwareVisualizer::PpmFormat);
+    const std::string data = stream.str();
+
+    std::ostringstream header;
+    header << "P6\n" << WIDTH << " " << HEIGHT << "\n255\n";
+
+    std::string pixels;
+
+    for (size_t y = 0; y < HEIGHT; ++y)
+        for (size_t x = 0; x < WIDTH; ++x)
+            for (int shift = 0; shift < 24; shift += 8)
+                pixels.push_back(static_cast<char>(visualizer.getPixel(x, y) >> shift));
+
+    if (data != header.str() + pixels)
+    {
+        std::cerr << "the PPM image differs from the framebuffer" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+
+// chunks are parsed by their lengths, the stored blocks of IDAT have to
+// give the filtered rows back
+size_t testPng(const SoftwareVisualizer &visualizer)
+{
+    std::ostringstream stream(std::ios::binary);
+    visualizer.writeImage(stream, SoftwareVisualizer::PngFormat);
+    const std::string data = stream.str();
+
+    if (data.compare(0, 8, "\x89PNG\r\n\x1A\n") != 0)
+    {
+        std::cerr << "wrong PNG signature" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> types;
+    std::string header, imageData;
+    size_t failureCount = 0;
+
+    for (size_t pos = 8; pos < data.size(); )
+    {
+        if (pos + 12 > data.size() || pos + 12 + readBigEndian(data, pos) > data.size())
+        {
+            std::cerr << "the PNG chunk at " << pos << " is cut" << std::endl;
+            return failureCount + 1;
+        }
+
+        const size_t size = readBigEndian(data, pos);
+        types.push_back(data.substr(pos + 4, 4));
+
+        if (getCrc(data, pos + 4, size + 4) != readBigEndian(data, pos + 8 + size))
+        {
+            std::cerr << "wrong CRC of the PNG chunk " << types.back() << std::endl;
+            ++failureCount;
+        }
+
+        if (types.back() == "IHDR")
+            header = data.substr(pos + 8, size);
+        else if (types.back() == "IDAT")
+            imageData += data.substr(pos + 8, size);
+
+        pos += size + 12;
+    }
+
+    if (types != std::vector<std::string>({"IHDR", "IDAT", "IEND"}))
+    {
+        std::cerr << "wrong PNG chunks" << std::endl;
+        return failureCount + 1;
+    }
+
+    const std::string expectedHeader("\0\0\0\xC8\0\0\0\x64\x08\x06\0\0\0", 13);
+
+    if (header != expectedHeader)
+    {
+        std::cerr << "wrong PNG header" << std::endl;
+        ++failureCount;
+    }
+
+    std::string rows;
+
+    for (size_t y = 0; y < HEIGHT; ++y)
+    {
+        rows.push_back(0);
+
+        for (size_t x = 0; x < WIDTH; ++x)
+            for (int shift = 0; shift < 32; shift += 8)
+                rows.push_back(static_cast<char>(visualizer.getPixel(x, y) >> shift));
+    }
+
+    // zlib header, stored blocks & the Adler-32
+    if (imageData.size() < 6 || (static_cast<uint8_t>(imageData[0]) << 8 | static_cast<uint8_t>(imageData[1])) % 31 != 0
+            || (imageData[0] & 0x0F) != 8)
+    {
+        std::cerr << "wrong zlib header" << std::endl;
+        return failureCount + 1;
+    }
+
+    std::string inflatedRows;
+    size_t pos = 2;
+    bool isLast = false;
+
+    while (!isLast)
+    {
+        if (pos + 5 > imageData.size())
+        {
+            std::cerr << "the deflate block at " << pos << " is cut" << std::endl;
+            return failureCount + 1;
+        }
+
+        const uint8_t blockHeader = static_cast<uint8_t>(imageData[pos]);
+        const size_t size = static_cast<uint8_t>(imageData[pos + 1]) | static_cast<uint8_t>(imageData[pos + 2]) << 8;
+        const size_t complement = static_cast<uint8_t>(imageData[pos + 3]) | static_cast<uint8_t>(imageData[pos + 4]) << 8;
+        isLast = (blockHeader & 1) != 0;
+
+        if ((blockHeader & 0x06) != 0 || (size ^ complement) != 0xFFFF || pos + 5 + size > imageData.size()
+                || (!isLast && size != MAX_BLOCK_SIZE))
+        {
+            std::cerr << "wrong stored block at " << pos << std::endl;
+            return failureCount + 1;
+        }
+
+        inflatedRows += imageData.substr(pos + 5, size);
+        pos += 5 + size;
+    }
+
+    if (inflatedRows != rows)
+    {
+        std::cerr << "PNG rows differ from the framebuffer" << std::endl;
+        ++failureCount;
+    }
+
+    if (pos + 4 != imageData.size() || readBigEndian(imageData, pos) != getAdler(rows))
+    {
+        std::cerr << "wrong Adler-32 of the PNG rows" << std::endl;
+        ++failureCount;
+    }
+
+    return failureCount;
+}
+
+
+}  // namespace
+
+
+
+int main()
+{
+    SoftwareVisualizer visualizer(WIDTH, HEIGHT);
+
+    size_t failureCount = testRects(visualizer);
+    failureCount += testPpm(visualizer);
+    failureCount += testPng(visualizer);
+    failureCount += testClippedRects(visualizer);
+
+    std::cout << "frame " << WIDTH << "x" << HEIGHT << ", failures " << failureCount << std::endl;
+
+    return failureCount == 0 ? 0 : 1;
+}
@@ -0,0 +1,169 @@
+// TimeOfImpactKernelTest.cpp
+
+#include <iostream>
+#include <random>
+#include <cstring>
+
+#include "physics/TimeOfImpactKernel.h"
+
+using namespace Platformer;
+
+
+namespace
+{
+
+
+const size_t BATCH_COUNT = 300000;
+const size_t MAX_BATCH_SIZE = 19;
+const double FRAME_TIME_SEC = 1.0 / 60;
+const double ABSOLUTE_TIME_ERROR = 0.0001;
+
+
+struct TestCase
+{
+    Rectangle _rect;
+    Point _speed;
+    PackedRectangles _batchRects;
+    Point _batchSpeed;
+    double _minCollisionTime = 1;
+    bool _isHorizontalCollision = false;
+};
+
+
+struct TestResult
+{
+    double _minCollisionTime = 1;
+    bool _isHorizontalCollision = false;
+
+    // doubles are compared by bits, so a sign of zero differs too
+    bool operator==(const TestResult &other) const
+    {
+        return std::memcmp(&_minCollisionTime, &other._minCollisionTime, sizeof(double)) == 0
+            && _isHorizontalCollision == other._isHorizontalCollision;
+    }
+};
+
+
+// Half of the values are on an integer grid, so rectangles touch by edges
+// & hit at equal times, the rest are random. Speeds are often zero or
+// equal on one axis.
+double makeCoordinate(std::mt19937 &random)
+{
+    std::uniform_int_distribution<int> gridDistribution(-8, 8);
+    std::uniform_real_distribution<double> realDistribution(-8, 8);
+
+    return random() % 2 ? gridDistribution(random) * 4 : realDistribution(random);
+}
+
+
+double makeSize(std::mt19937 &random)
+{
+    std::uniform_int_distribution<int> gridDistribution(0, 4);
+    std::uniform_real_distribution<double> realDistribution(0, 16);
+
+    return random() % 2 ? gridDistribution(random) * 4 : realDistribution(random);
+}
+
+
+double makeSpeed(std::mt19937 &random)
+{
+    std::uniform_int_distribution<int> gridDistribution(-2, 2);
+    std::uniform_real_distribution<double> realDistribution(-1200, 1200);
+
+    switch (random() % 3)
+    {
+    case 0:
+        return 0;
+    case 1:
+        return gridDistribution(random) * 240;
+    default:
+        return realDistribution(random);
+    }
+}
+
+
+void makeTestCase(std::mt19937 &random, TestCase &testCase)
+{
+    testCase._rect = Rectangle(makeCoordinate(random), makeCoordinate(random), makeSize(random), makeSize(random));
+    testCase._speed = Point(makeSpeed(random), makeSpeed(random));
+    testCase._batchSpeed = random() % 2 ? Point(0, 0) : Point(makeSpeed(random), makeSpeed(random));
+    testCase._batchRects.clear();
+
+    const size_t rectCount = 1 + random() % MAX_BATCH_SIZE;
+
+    for (size_t rectNum = 0; rectNum < rectCount; ++rectNum)
+        testCase._batchRects.addRectangle(Rectangle(makeCoordinate(random), makeCoordinate(random),
+                                                    makeSize(random), makeSize(random)));
+
+    std::uniform_real_distribution<double> timeDistribution(0, 1);
+    testCase._minCollisionTime = random() % 2 ? 1 : timeDistribution(random);
+    testCase._isHorizontalCollision = random() % 2 != 0;
+}
+
+
+TestResult runTestCase(const TestCase &testCase, TimeOfImpactKernel::InstructionSet instructionSet)
+{
+    TestResult result;
+    result._minCollisionTime = testCase._minCollisionTime;
+    result._isHorizontalCollision = testCase._isHorizontalCollision;
+
+    TimeOfImpactKernel::setInstructionSet(instructionSet);
+    TimeOfImpactKernel::findEarliestHit(testCase._rect, testCase._speed,
+                                        testCase._batchRects.getBatch(), testCase._batchSpeed,
+                                        FRAME_TIME_SEC, ABSOLUTE_TIME_ERROR,
+                                        result._minCollisionTime, result._isHorizontalCollision);
+    return result;
+}
+
+
+}  // namespace
+
+
+// Vector paths of the kernel must give the same bits as the scalar one
+// on random batches, unsupported instruction sets are skipped.
+int main()
+{
+    const TimeOfImpactKernel::InstructionSet instructionSets[] = {TimeOfImpactKernel::Sse2Instructions,
+                                                                  TimeOfImpactKernel::Avx2Instructions};
+    const char *instructionSetNames[] = {"sse2", "avx2"};
+    const TimeOfImpactKernel::InstructionSet defaultInstructionSet = TimeOfImpactKernel::getInstructionSet();
+
+    std::mt19937 random(1);
+    TestCase testCase;
+    size_t mismatchCounts[2] = {0, 0};
+    size_t hitCount = 0;
+
+    for (size_t batchNum = 0; batchNum < BATCH_COUNT; ++batchNum)
+    {
+        makeTestCase(random, testCase);
+        const TestResult scalarResult = runTestCase(testCase, TimeOfImpactKernel::ScalarInstructions);
+
+        if (scalarResult._minCollisionTime < testCase._minCollisionTime)
+            ++hitCount;
+
+        for (size_t setNum = 0; setNum < 2; ++setNum)
+        {
+            if (!TimeOfImpactKernel::isSupported(instructionSets[setNum]))
+                continue;
+
+            const TestResult result = runTestCase(testCase, instructionSets[setNum]);
+
+            if (!(result == scalarResult) && mismatchCounts[setNum]++ == 0)
+                std::cerr << instructionSetNames[setNum] << " batch " << batchNum
+                          << ": time " << result._minCollisionTime << " instead of " << scalarResult._minCollisionTime
+                          << ", horizontal " << result._isHorizontalCollision
+                          << " instead of " << scalarResult._isHorizontalCollision << std::endl;
+        }
+    }
+
+    TimeOfImpactKernel::setInstructionSet(defaultInstructionSet);
+    std::cout << "batches " << BATCH_COUNT << ", hits " << hitCount << std::endl;
+
+    for (size_t setNum = 0; setNum < 2; ++setNum)
+        if (TimeOfImpactKernel::isSupported(instructionSets[setNum]))
+            std::cout << instructionSetNames[setNum] << " mismatches " << mismatchCounts[setNum] << std::endl;
+        else
+            std::cout << instructionSetNames[setNum] << " isn't supported" << std::endl;
+
+    return mismatchCounts[0] == 0 && mismatchCounts[1] == 0 ? 0 : 1;
+}